@@ -0,0 +1,120 @@
+/*  -*- c++ -*-
+ *  C++ VCD Tracer Library Benchmark Helpers
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#ifndef VCD_BENCH_COMMON_HPP
+#define VCD_BENCH_COMMON_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <streambuf>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "../src/vcd_tracer.hpp"
+
+namespace vcd_bench {
+
+    /** A stream buffer that discards all output, but counts the bytes written.
+        This removes file system noise from measurements of the tracer.
+    */
+    class counting_streambuf : public std::streambuf {
+      public:
+        //! Number of bytes written since construction or the last reset().
+        [[nodiscard]] std::uint64_t bytes(void) const { return _bytes; }
+        //! Restart the byte count.
+        void reset(void) { _bytes = 0; }
+
+      protected:
+        int_type overflow(int_type ch) override {
+            _bytes++;
+            return traits_type::not_eof(ch);
+        }
+        std::streamsize xsputn(const char_type *s, std::streamsize count) override {
+            (void)s;
+            _bytes += static_cast<std::uint64_t>(count);
+            return count;
+        }
+
+      private:
+        std::uint64_t _bytes{ 0 };
+    };
+
+    /** An output stream that discards its output and counts the bytes written.
+     */
+    class null_ostream : public std::ostream {
+      public:
+        null_ostream(void)
+            : std::ostream(&_buf) {
+        }
+        //! Number of bytes written since construction or the last reset().
+        [[nodiscard]] std::uint64_t bytes(void) const { return _buf.bytes(); }
+        //! Restart the byte count.
+        void reset(void) { _buf.reset(); }
+
+      private:
+        counting_streambuf _buf;
+    };
+
+    /** The peak resident set size of this process.
+        @retval Peak RSS in bytes, or 0 if it is not available.
+    */
+    inline std::uint64_t peak_rss_bytes(void) {
+        struct rusage usage {};
+        if (::getrusage(RUSAGE_SELF, &usage) != 0) {
+            return 0;
+        }
+        // Linux reports kilobytes.
+        return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+    }
+
+    /** The current resident set size of this process.
+        @retval RSS in bytes, or 0 if it is not available.
+    */
+    inline std::uint64_t current_rss_bytes(void) {
+        std::ifstream statm("/proc/self/statm");
+        std::uint64_t size = 0;
+        std::uint64_t resident = 0;
+        if (!(statm >> size >> resident)) {
+            return 0;
+        }
+        return resident * static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    }
+
+    /** Capture the dumper function of a single value without a top scope.
+        This is the same scaffolding the unit tests use, and allows a value to be
+        formatted in isolation.
+    */
+    struct dumper_capture {
+        vcd_tracer::scope_fn::dumper_fn dumper = vcd_tracer::scope_fn::nop_dump;
+
+        [[nodiscard]] vcd_tracer::scope_fn::add_fn add_fn(void) {
+            return [this](const std::string_view full_path,
+                          const std::string_view var_type,
+                          unsigned int bit_size,
+                          vcd_tracer::scope_fn::dumper_fn fn) {
+                (void)full_path;
+                (void)var_type;
+                (void)bit_size;
+                dumper = fn;
+                return vcd_tracer::value_context{ "!", [this](vcd_tracer::scope_fn::dumper_fn update) {
+                                                     dumper = update;
+                                                 } };
+            };
+        }
+    };
+
+}// namespace vcd_bench
+
+#endif// VCD_BENCH_COMMON_HPP
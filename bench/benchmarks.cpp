@@ -0,0 +1,465 @@
+/*
+ *  C++ VCD Tracer Library Benchmarks
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Results can be exported for regression tracking with:
+ *
+ *    benchmarks --benchmark_out=bench_output.json --benchmark_out_format=json
+ *
+ * Set VCD_BENCH_PERF=1 to also report hardware counters (cycles, instructions,
+ * branch and LLC misses) per change. The counters are enabled only around the
+ * phase being measured, this adds two ioctl() calls per phase.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../src/vcd_reader.hpp"
+#include "../src/vcd_tsc.hpp"
+#if defined(VCD_BENCH_SINKS)
+#include "../src/vcd_mmap_sink.hpp"
+#include "../src/vcd_uring_sink.hpp"
+#endif
+#include "bench_common.hpp"
+#include "perf_counters.hpp"
+
+// Global sequence used by buffered values.
+static vcd_tracer::scope_fn::sequence_t bench_seq = 0;
+
+/** Generate a sequence of values for a type that changes on each call.
+ */
+template<typename T>
+static T bench_value(std::uint64_t i) {
+    if constexpr (std::is_same_v<T, bool>) {
+        return (i & 0x1) != 0;
+    }
+    else if constexpr (std::is_floating_point_v<T>) {
+        return static_cast<T>(i) * static_cast<T>(0.3125);
+    }
+    else {
+        return static_cast<T>(i * 0x9E3779B97F4A7C15ULL);
+    }
+}
+
+/** Select the value type for a trace depth, unbuffered values have no sequence.
+ */
+template<typename T, int TRACE_DEPTH>
+using bench_value_t = std::conditional_t<TRACE_DEPTH == 1,
+                                         vcd_tracer::value<T>,
+                                         vcd_tracer::value<T, vcd_tracer::bit_size<T>::value, TRACE_DEPTH, &bench_seq>>;
+
+/** Report hardware counters as per change user counters.
+    Nothing is reported if the counters are not available.
+    @param changes The number of changes recorded while counting.
+*/
+static void report_perf(benchmark::State &state,
+                        const vcd_bench::perf_counters &perf,
+                        benchmark::IterationCount changes) {
+    if (!perf.available() || (changes == 0)) {
+        return;
+    }
+    for (unsigned int c = 0; c < vcd_bench::perf_counters::COUNTER_COUNT; c++) {
+        const auto counter = static_cast<vcd_bench::perf_counters::counter>(c);
+        if (perf.available(counter)) {
+            state.counters[std::string(vcd_bench::perf_counters::names[c]) + "_per_change"] =
+                benchmark::Counter(static_cast<double>(perf.read(counter)) / static_cast<double>(changes));
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+// value<>::set()
+
+template<typename T, int TRACE_DEPTH>
+static void BM_value_set(benchmark::State &state) {
+    vcd_bench::dumper_capture capture;
+    vcd_bench::null_ostream out;
+    bench_value_t<T, TRACE_DEPTH> var;
+    var.elaborate(capture.add_fn(), "v");
+    vcd_bench::perf_counters perf(vcd_bench::perf_counters::requested());
+    perf.resume();
+    std::uint64_t i = 0;
+    for (auto _ : state) {
+        // Fill the trace buffer, each set is a change.
+        for (int d = 0; d < TRACE_DEPTH; d++) {
+            var.set(bench_value<T>(i++));
+            bench_seq++;
+        }
+        if constexpr (TRACE_DEPTH > 1) {
+            // Drain the buffer outside of the measurement.
+            state.PauseTiming();
+            perf.pause();
+            auto status = capture.dumper(out, true);
+            while (status.next.has_value()) {
+                status = capture.dumper(out, false);
+            }
+            perf.resume();
+            state.ResumeTiming();
+        }
+    }
+    perf.pause();
+    state.SetItemsProcessed(state.iterations() * TRACE_DEPTH);
+    report_perf(state, perf, state.iterations() * TRACE_DEPTH);
+}
+
+BENCHMARK_TEMPLATE(BM_value_set, bool, 1);
+BENCHMARK_TEMPLATE(BM_value_set, std::uint8_t, 1);
+BENCHMARK_TEMPLATE(BM_value_set, std::uint32_t, 1);
+BENCHMARK_TEMPLATE(BM_value_set, std::uint64_t, 1);
+BENCHMARK_TEMPLATE(BM_value_set, double, 1);
+BENCHMARK_TEMPLATE(BM_value_set, bool, 64);
+BENCHMARK_TEMPLATE(BM_value_set, std::uint32_t, 64);
+BENCHMARK_TEMPLATE(BM_value_set, std::uint64_t, 64);
+BENCHMARK_TEMPLATE(BM_value_set, double, 64);
+BENCHMARK_TEMPLATE(BM_value_set, bool, 1024);
+BENCHMARK_TEMPLATE(BM_value_set, std::uint32_t, 1024);
+BENCHMARK_TEMPLATE(BM_value_set, std::uint64_t, 1024);
+BENCHMARK_TEMPLATE(BM_value_set, double, 1024);
+
+// ------------------------------------------------------------------------
+// top::time_update_abs()
+
+/** Trace a number of signals, where a percentage of them change on each time step.
+    @param state.range(0) Number of signals.
+    @param state.range(1) Percentage of signals that change per time step.
+*/
+static void BM_time_update_abs(benchmark::State &state) {
+    const auto signal_count = static_cast<std::size_t>(state.range(0));
+    const auto change_count = std::max<std::size_t>(1, signal_count * static_cast<std::size_t>(state.range(1)) / 100);
+
+    vcd_bench::null_ostream out;
+    vcd_tracer::top dumper("root");
+    std::vector<std::unique_ptr<vcd_tracer::value<std::uint32_t>>> values;
+    {
+        vcd_tracer::module mod(dumper.root, "mod");
+        for (std::size_t i = 0; i < signal_count; i++) {
+            values.push_back(std::make_unique<vcd_tracer::value<std::uint32_t>>(0U));
+            mod.elaborate(*values.back(), "sig" + std::to_string(i));
+        }
+    }
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    out.reset();
+
+    // Only the time update, and so time_update_core(), is counted.
+    vcd_bench::perf_counters perf(vcd_bench::perf_counters::requested());
+    std::uint64_t timestamp = 1;
+    std::size_t next = 0;
+    for (auto _ : state) {
+        // Spread the changes over all signals
+        for (std::size_t c = 0; c < change_count; c++) {
+            values[next]->set(static_cast<std::uint32_t>(timestamp));
+            next = (next + 1) % signal_count;
+        }
+        perf.resume();
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ timestamp++ });
+        perf.pause();
+    }
+    const auto changes = state.iterations() * static_cast<benchmark::IterationCount>(change_count);
+    state.SetItemsProcessed(changes);
+    state.counters["bytes_per_change"] = benchmark::Counter(
+        static_cast<double>(out.bytes()) / static_cast<double>(changes));
+    report_perf(state, perf, changes);
+}
+
+BENCHMARK(BM_time_update_abs)
+    ->ArgNames({ "signals", "change_pct" })
+    ->ArgsProduct({ { 16, 256, 4096 }, { 1, 10, 100 } });
+
+// ------------------------------------------------------------------------
+// Event timestamps
+
+/** Read steady_clock for each event, as passed to time_update_abs().
+ */
+static void BM_timestamp_steady(benchmark::State &state) {
+    const auto start = std::chrono::steady_clock::now();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(std::chrono::duration_cast<vcd_tracer::top::time_base>(std::chrono::steady_clock::now() - start));
+    }
+}
+
+BENCHMARK(BM_timestamp_steady);
+
+/** Read the cycle counter for each event, the conversion is left to when the time is formatted.
+ */
+static void BM_timestamp_tsc(benchmark::State &state) {
+    const vcd_tracer::tsc_clock clock;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(clock.ticks());
+    }
+    state.counters["hardware"] = clock.hardware() ? 1.0 : 0.0;
+}
+
+BENCHMARK(BM_timestamp_tsc);
+
+// ------------------------------------------------------------------------
+// value_base::dump() formatting
+
+/** Format a value directly through it's dumper function.
+ */
+template<typename T, unsigned int BIT_SIZE>
+static void BM_value_dump(benchmark::State &state) {
+    vcd_bench::dumper_capture capture;
+    vcd_bench::null_ostream out;
+    vcd_tracer::value<T, BIT_SIZE> var;
+    var.elaborate(capture.add_fn(), "v");
+    // The set() is counted with the formatting, it is small in comparison.
+    vcd_bench::perf_counters perf(vcd_bench::perf_counters::requested());
+    perf.resume();
+    std::uint64_t i = 0;
+    for (auto _ : state) {
+        var.set(bench_value<T>(i++));
+        benchmark::DoNotOptimize(capture.dumper(out, true));
+    }
+    perf.pause();
+    state.SetItemsProcessed(state.iterations());
+    report_perf(state, perf, state.iterations());
+    state.SetBytesProcessed(static_cast<std::int64_t>(out.bytes()));
+}
+
+BENCHMARK_TEMPLATE(BM_value_dump, bool, 1);
+BENCHMARK_TEMPLATE(BM_value_dump, std::uint8_t, 4);
+BENCHMARK_TEMPLATE(BM_value_dump, std::uint8_t, 8);
+BENCHMARK_TEMPLATE(BM_value_dump, std::uint16_t, 16);
+BENCHMARK_TEMPLATE(BM_value_dump, std::uint32_t, 32);
+BENCHMARK_TEMPLATE(BM_value_dump, std::uint64_t, 64);
+BENCHMARK_TEMPLATE(BM_value_dump, float, 32);
+BENCHMARK_TEMPLATE(BM_value_dump, double, 64);
+
+// ------------------------------------------------------------------------
+// top::finalize_header()
+
+/** Write the header of a design with a number of signals.
+    @param state.range(0) Number of signals.
+    @param state.range(1) Number of signals per module.
+*/
+static void BM_finalize_header(benchmark::State &state) {
+    const auto signal_count = static_cast<std::size_t>(state.range(0));
+    const auto per_module = static_cast<std::size_t>(state.range(1));
+    vcd_bench::null_ostream out;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<std::unique_ptr<vcd_tracer::value<std::uint32_t>>> values;
+        auto dumper = std::make_unique<vcd_tracer::top>("root");
+        {
+            std::vector<std::unique_ptr<vcd_tracer::module>> modules;
+            for (std::size_t i = 0; i < signal_count; i++) {
+                if ((i % per_module) == 0) {
+                    modules.push_back(std::make_unique<vcd_tracer::module>(dumper->root, "mod" + std::to_string(modules.size())));
+                }
+                values.push_back(std::make_unique<vcd_tracer::value<std::uint32_t>>());
+                modules.back()->elaborate(*values.back(), "sig" + std::to_string(i));
+            }
+        }
+        state.ResumeTiming();
+        dumper->finalize_header(out, std::chrono::system_clock::from_time_t(0));
+        state.PauseTiming();
+        values.clear();
+        dumper.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<benchmark::IterationCount>(signal_count));
+}
+
+BENCHMARK(BM_finalize_header)
+    ->ArgNames({ "signals", "per_module" })
+    ->ArgsProduct({ { 1000, 100000 }, { 16, 1024 } })
+    ->Unit(benchmark::kMillisecond);
+
+// ------------------------------------------------------------------------
+// reader::trace
+
+/** Write a trace of a number of signals with a mix of types.
+ */
+static std::string bench_trace(std::size_t signal_count, std::uint64_t cycles) {
+    std::ostringstream out;
+    vcd_tracer::top dumper("root");
+    std::vector<std::unique_ptr<vcd_tracer::value<bool>>> flags;
+    std::vector<std::unique_ptr<vcd_tracer::value<std::uint32_t>>> words;
+    {
+        vcd_tracer::module mod(dumper.root, "mod");
+        for (std::size_t i = 0; i < signal_count; i++) {
+            flags.push_back(std::make_unique<vcd_tracer::value<bool>>());
+            words.push_back(std::make_unique<vcd_tracer::value<std::uint32_t>>());
+            mod.elaborate(*flags.back(), "f" + std::to_string(i));
+            mod.elaborate(*words.back(), "w" + std::to_string(i));
+        }
+    }
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    for (std::uint64_t t = 1; t <= cycles; t++) {
+        for (std::size_t i = 0; i < signal_count; i++) {
+            flags[i]->set(((t + i) & 0x1) != 0);
+            words[i]->set(bench_value<std::uint32_t>(t * signal_count + i));
+        }
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+    }
+    return out.str();
+}
+
+/** Stream every value change of an in memory trace.
+ */
+static void BM_reader_changes(benchmark::State &state) {
+    const std::string data = bench_trace(256, 1000);
+    const vcd_tracer::reader::trace t(data);
+    std::uint64_t changes = 0;
+    for (auto _ : state) {
+        t.for_each_change([&](const vcd_tracer::reader::value_change &change) {
+            benchmark::DoNotOptimize(change.value.data());
+            changes++;
+        });
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(t.body().size()));
+    state.SetItemsProcessed(static_cast<std::int64_t>(changes));
+}
+
+BENCHMARK(BM_reader_changes)->Unit(benchmark::kMillisecond);
+
+/** Group every change by signal, with a number of threads.
+    @param state.range(0) Number of threads, 1 is a sequential parse.
+*/
+static void BM_reader_histories(benchmark::State &state) {
+    const std::string data = bench_trace(256, 1000);
+    const vcd_tracer::reader::trace t(data);
+    for (auto _ : state) {
+        auto histories = vcd_tracer::reader::load_histories(t, static_cast<unsigned int>(state.range(0)));
+        benchmark::DoNotOptimize(histories.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(t.body().size()));
+}
+
+BENCHMARK(BM_reader_histories)
+    ->ArgName("threads")
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// ------------------------------------------------------------------------
+// Output sinks
+
+// The tracer writes a line at a time, replay a trace in pieces of this size.
+static constexpr std::size_t sink_chunk = 64;
+static constexpr std::size_t sink_buffer = 1024 * 1024;
+static const char *const sink_path = "bench_sink.vcd";
+
+/** Write a trace to a file with std::ofstream.
+ */
+static void BM_sink_ofstream(benchmark::State &state) {
+    const std::string data = bench_trace(256, 1000);
+    for (auto _ : state) {
+        std::ofstream out(sink_path, std::ios::binary);
+        for (std::size_t i = 0; i < data.size(); i += sink_chunk) {
+            out.write(data.data() + i, static_cast<std::streamsize>(std::min(sink_chunk, data.size() - i)));
+        }
+    }
+    std::remove(sink_path);
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(data.size()));
+}
+
+BENCHMARK(BM_sink_ofstream)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/** Write a trace to a file with write() of a buffer the size of a uring_sink buffer.
+ */
+static void BM_sink_write(benchmark::State &state) {
+    const std::string data = bench_trace(256, 1000);
+    std::string buffer;
+    buffer.reserve(sink_buffer);
+    const auto flush = [&](int fd) {
+        if (::write(fd, buffer.data(), buffer.size()) != static_cast<ssize_t>(buffer.size())) {
+            state.SkipWithError("write failed");
+        }
+        buffer.clear();
+    };
+    for (auto _ : state) {
+        const int fd = ::open(sink_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        for (std::size_t i = 0; i < data.size(); i += sink_chunk) {
+            const std::size_t size = std::min(sink_chunk, data.size() - i);
+            if ((buffer.size() + size) > sink_buffer) {
+                flush(fd);
+            }
+            buffer.append(data, i, size);
+        }
+        flush(fd);
+        ::close(fd);
+    }
+    std::remove(sink_path);
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(data.size()));
+}
+
+BENCHMARK(BM_sink_write)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+#if defined(VCD_BENCH_SINKS)
+/** Write a trace to a file with a uring_sink.
+    @param state.range(0) 1 to open the file with O_DIRECT.
+    @param state.range(1) 0 for the pwrite() fallback.
+*/
+static void BM_sink_uring(benchmark::State &state) {
+    const std::string data = bench_trace(256, 1000);
+    vcd_tracer::uring_sink_options options;
+    options.buffer_size = sink_buffer;
+    options.direct = (state.range(0) != 0);
+    options.uring = (state.range(1) != 0);
+    for (auto _ : state) {
+        vcd_tracer::uring_sink sink(sink_path, options);
+        std::ostream out(&sink);
+        for (std::size_t i = 0; i < data.size(); i += sink_chunk) {
+            out.write(data.data() + i, static_cast<std::streamsize>(std::min(sink_chunk, data.size() - i)));
+        }
+        sink.close();
+    }
+    std::remove(sink_path);
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(data.size()));
+}
+
+BENCHMARK(BM_sink_uring)
+    ->ArgNames({ "direct", "uring" })
+    ->Args({ 0, 1 })
+    ->Args({ 1, 1 })
+    ->Args({ 0, 0 })
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+#endif
+
+#if defined(VCD_BENCH_SINKS)
+/** Write a trace to a file with a mmap_sink.
+ */
+static void BM_sink_mmap(benchmark::State &state) {
+    const std::string data = bench_trace(256, 1000);
+    for (auto _ : state) {
+        vcd_tracer::mmap_sink sink(sink_path);
+        std::ostream out(&sink);
+        for (std::size_t i = 0; i < data.size(); i += sink_chunk) {
+            out.write(data.data() + i, static_cast<std::streamsize>(std::min(sink_chunk, data.size() - i)));
+        }
+        sink.close();
+    }
+    std::remove(sink_path);
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(data.size()));
+}
+
+BENCHMARK(BM_sink_mmap)->Unit(benchmark::kMillisecond)->UseRealTime();
+#endif
+
+BENCHMARK_MAIN();
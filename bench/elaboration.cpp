@@ -0,0 +1,180 @@
+/*
+ *  C++ VCD Tracer Library Elaboration Benchmark
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Measure the time from process start to the first traced cycle for a large design.
+ *
+ *    elaboration [--signals=N] [--shape=deep|wide] [--fanout=N]
+ *
+ * Each phase is reported with it's time, the change in resident memory and
+ * the peak resident memory at the end of the phase:
+ *
+ *  - modules   Creation of the module hierarchy.
+ *  - values    Construction of the (unelaborated) trace values.
+ *  - register  Elaboration of values into modules, generating identifiers.
+ *  - header    top::finalize_header(), including the initial values.
+ *  - first     The first time_update_abs() with every value changed.
+ *
+ * A deep design is a tree with the given fanout (default 2), a wide design
+ * has a single level of modules. Both have the same number of signals per
+ * leaf module. Run each size in a new process so peak memory is not shared.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench_common.hpp"
+
+namespace {
+
+    const auto process_start = std::chrono::steady_clock::now();
+
+    //! Number of signals in each leaf module.
+    constexpr std::size_t SIGNALS_PER_LEAF = 64;
+
+    void usage(const char *name) {
+        std::cerr << "usage: " << name << " [--signals=N] [--shape=deep|wide] [--fanout=N]\n";
+    }
+
+    /** Report the cost of a phase.
+     */
+    class phase_reporter {
+      public:
+        phase_reporter(void) {
+            std::cout << std::left << std::setw(10) << "phase"
+                      << std::right << std::setw(14) << "seconds"
+                      << std::setw(16) << "rss_delta_MB"
+                      << std::setw(14) << "peak_rss_MB"
+                      << "\n";
+            restart();
+        }
+        //! Start timing the next phase.
+        void restart(void) {
+            _rss = vcd_bench::current_rss_bytes();
+            _start = std::chrono::steady_clock::now();
+        }
+        //! Report the phase that has just finished, and start the next one.
+        void report(std::string_view phase) {
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _start;
+            const double rss_delta = static_cast<double>(vcd_bench::current_rss_bytes()) - static_cast<double>(_rss);
+            std::cout << std::left << std::setw(10) << phase
+                      << std::right << std::setw(14) << std::fixed << std::setprecision(6) << elapsed.count()
+                      << std::setw(16) << std::setprecision(2) << rss_delta / MB
+                      << std::setw(14) << static_cast<double>(vcd_bench::peak_rss_bytes()) / MB
+                      << "\n";
+            restart();
+        }
+
+      private:
+        static constexpr double MB = 1024.0 * 1024.0;
+        std::chrono::steady_clock::time_point _start;
+        std::uint64_t _rss{ 0 };
+    };
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    std::size_t signal_count = 100000;
+    bool deep = true;
+    std::size_t fanout = 0;
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg{ argv[i] };
+            if (arg.substr(0, 10) == "--signals=") {
+                signal_count = std::stoull(std::string(arg.substr(10)));
+            }
+            else if (arg == "--shape=deep") {
+                deep = true;
+            }
+            else if (arg == "--shape=wide") {
+                deep = false;
+            }
+            else if (arg.substr(0, 9) == "--fanout=") {
+                fanout = std::stoull(std::string(arg.substr(9)));
+            }
+            else {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "invalid argument: " << e.what() << "\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::size_t leaf_count = std::max<std::size_t>(1, (signal_count + SIGNALS_PER_LEAF - 1) / SIGNALS_PER_LEAF);
+    if (fanout < 2) {
+        fanout = deep ? 2 : leaf_count;
+    }
+
+    std::cout << "signals: " << signal_count
+              << " shape: " << (deep ? "deep" : "wide")
+              << " fanout: " << fanout
+              << " leaves: " << leaf_count << "\n";
+
+    vcd_bench::null_ostream out;
+    phase_reporter phases;
+
+    // Modules, built breadth first until there are enough leaves.
+    vcd_tracer::top dumper("root");
+    std::vector<std::unique_ptr<vcd_tracer::module>> modules;
+    std::vector<vcd_tracer::module *> level{ &dumper.root };
+    unsigned int depth = 0;
+    while (level.size() < leaf_count || depth == 0) {
+        std::vector<vcd_tracer::module *> next;
+        for (auto *parent : level) {
+            for (std::size_t f = 0; (f < fanout) && (next.size() < leaf_count); f++) {
+                modules.push_back(std::make_unique<vcd_tracer::module>(*parent, "m" + std::to_string(f)));
+                next.push_back(modules.back().get());
+            }
+        }
+        level.swap(next);
+        depth++;
+    }
+    phases.report("modules");
+
+    std::vector<std::unique_ptr<vcd_tracer::value<std::uint32_t>>> values;
+    values.reserve(signal_count);
+    for (std::size_t i = 0; i < signal_count; i++) {
+        values.push_back(std::make_unique<vcd_tracer::value<std::uint32_t>>());
+    }
+    phases.report("values");
+
+    for (std::size_t i = 0; i < signal_count; i++) {
+        level[i / SIGNALS_PER_LEAF % level.size()]->elaborate(*values[i], "s" + std::to_string(i % SIGNALS_PER_LEAF));
+    }
+    // The module hierarchy is no longer needed once registered.
+    modules.clear();
+    phases.report("register");
+
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    phases.report("header");
+
+    for (std::size_t i = 0; i < signal_count; i++) {
+        values[i]->set(static_cast<std::uint32_t>(i));
+    }
+    dumper.time_update_abs(out, std::chrono::nanoseconds{ 1 });
+    phases.report("first");
+
+    const std::chrono::duration<double> total = std::chrono::steady_clock::now() - process_start;
+    std::cout << "depth: " << depth
+              << " header_bytes+first: " << out.bytes()
+              << " start_to_first_cycle_s: " << total.count() << "\n";
+    return EXIT_SUCCESS;
+}
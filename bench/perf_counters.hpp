@@ -0,0 +1,180 @@
+/*  -*- c++ -*-
+ *  C++ VCD Tracer Library Hardware Performance Counters
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#ifndef VCD_BENCH_PERF_COUNTERS_HPP
+#define VCD_BENCH_PERF_COUNTERS_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace vcd_bench {
+
+    /** Collect hardware performance counters of this thread using perf_event_open().
+
+        The counters are opened as one group, so they are scheduled together,
+        and are only counted between resume() and pause(). If perf events are
+        not permitted (e.g. by /proc/sys/kernel/perf_event_paranoid or in a
+        container) or not supported, then the collector is unavailable and
+        all operations do nothing. Individual counters the CPU does not
+        support are skipped.
+    */
+    class perf_counters {
+      public:
+        //! The counters that are collected.
+        enum counter : unsigned int {
+            cycles,
+            instructions,
+            branch_misses,
+            llc_misses,
+            COUNTER_COUNT
+        };
+
+        //! Names of the counters, indexed by counter.
+        static constexpr std::array<std::string_view, COUNTER_COUNT> names{
+            "cycles",
+            "instructions",
+            "branch_misses",
+            "llc_misses"
+        };
+
+        /** Open the counters.
+            @param enable When false no counters are opened.
+        */
+        explicit perf_counters(bool enable) {
+            _fd.fill(-1);
+            if (enable) {
+                open();
+            }
+        }
+        perf_counters(perf_counters &&) = delete;
+        perf_counters(const perf_counters &) = delete;
+        perf_counters &operator=(perf_counters &&) = delete;
+        perf_counters &operator=(const perf_counters &) = delete;
+
+        ~perf_counters(void) {
+#if defined(__linux__)
+            for (const int fd : _fd) {
+                if (fd >= 0) {
+                    ::close(fd);
+                }
+            }
+#endif
+        }
+
+        /** Check if the counters can be used.
+            @retval true The counter group was opened.
+        */
+        [[nodiscard]] bool available(void) const { return _fd[cycles] >= 0; }
+
+        /** Check if a single counter is supported.
+            @retval true The counter is part of the group.
+        */
+        [[nodiscard]] bool available(counter c) const { return _fd[c] >= 0; }
+
+        //! Start, or continue, counting.
+        void resume(void) { group_ioctl(group_op::enable); }
+
+        //! Stop counting, the totals are kept.
+        void pause(void) { group_ioctl(group_op::disable); }
+
+        //! Clear the totals.
+        void reset(void) { group_ioctl(group_op::reset); }
+
+        /** Read the total of a counter.
+            @retval The count, or 0 if the counter is not available.
+        */
+        [[nodiscard]] std::uint64_t read(counter c) const {
+            std::uint64_t count = 0;
+#if defined(__linux__)
+            if (_fd[c] >= 0) {
+                if (::read(_fd[c], &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+                    count = 0;
+                }
+            }
+#endif
+            return count;
+        }
+
+        /** Check if collection is requested through the VCD_BENCH_PERF environment variable.
+            @retval true VCD_BENCH_PERF is set and is not "0".
+        */
+        static bool requested(void) {
+            const char *env = std::getenv("VCD_BENCH_PERF");
+            return (env != nullptr) && (std::strcmp(env, "0") != 0);
+        }
+
+      private:
+        std::array<int, COUNTER_COUNT> _fd{};
+
+        enum class group_op {
+            enable,
+            disable,
+            reset
+        };
+
+        void group_ioctl(group_op op) {
+#if defined(__linux__)
+            if (available()) {
+                const unsigned long request = (op == group_op::enable)    ? PERF_EVENT_IOC_ENABLE
+                                              : (op == group_op::disable) ? PERF_EVENT_IOC_DISABLE
+                                                                          : PERF_EVENT_IOC_RESET;
+                ::ioctl(_fd[cycles], request, PERF_IOC_FLAG_GROUP);
+            }
+#else
+            (void)op;
+#endif
+        }
+
+        void open(void) {
+#if defined(__linux__)
+            static constexpr std::array<std::uint64_t, COUNTER_COUNT> configs{
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_BRANCH_MISSES,
+                // Usually mapped to last level cache misses.
+                PERF_COUNT_HW_CACHE_MISSES
+            };
+            for (unsigned int c = 0; c < COUNTER_COUNT; c++) {
+                struct perf_event_attr attr {};
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = configs[c];
+                // Only the group leader starts disabled, members follow the leader.
+                attr.disabled = (c == cycles) ? 1 : 0;
+                // Only count user space, this is allowed at the default paranoid level.
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                const int group = (c == cycles) ? -1 : _fd[cycles];
+                _fd[c] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+                if ((c == cycles) && (_fd[c] < 0)) {
+                    // No leader, so no group.
+                    return;
+                }
+            }
+#endif
+        }
+    };
+
+}// namespace vcd_bench
+
+#endif// VCD_BENCH_PERF_COUNTERS_HPP
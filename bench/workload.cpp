@@ -0,0 +1,153 @@
+/*
+ *  C++ VCD Tracer Library Scaling Workload
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Drive a synthetic design through vcd_tracer::top and report the cost of tracing it.
+ *
+ *    workload [--signals=N] [--depth=N] [--fanout=N] [--mix=b,8,16,32,64,r]
+ *             [--toggle-min=P] [--toggle-max=P] [--clocks=N] [--cycles=N]
+ *             [--buffered] [--seed=N] [--out=FILE]
+ *
+ * Without --out the trace is discarded, and only it's size is counted.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "bench_common.hpp"
+#include "workload.hpp"
+
+namespace {
+
+    void usage(const char *name) {
+        std::cerr << "usage: " << name
+                  << " [--signals=N] [--depth=N] [--fanout=N] [--mix=b,8,16,32,64,r]"
+                     " [--toggle-min=P] [--toggle-max=P] [--clocks=N] [--cycles=N]"
+                     " [--buffered] [--seed=N] [--out=FILE]\n";
+    }
+
+    bool parse_args(int argc, const char **argv, vcd_bench::workload_config &config, std::string &out_name) {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg{ argv[i] };
+            const auto eq = arg.find('=');
+            const std::string_view key = arg.substr(0, eq);
+            const std::string val{ (eq == std::string_view::npos) ? std::string_view{} : arg.substr(eq + 1) };
+            if (key == "--signals") {
+                config.signals = std::stoull(val);
+            }
+            else if (key == "--depth") {
+                config.depth = static_cast<unsigned int>(std::stoul(val));
+            }
+            else if (key == "--fanout") {
+                config.fanout = static_cast<unsigned int>(std::stoul(val));
+            }
+            else if (key == "--mix") {
+                std::istringstream mix(val);
+                std::string weight;
+                for (auto &w : config.type_mix) {
+                    if (!std::getline(mix, weight, ',')) {
+                        return false;
+                    }
+                    w = static_cast<unsigned int>(std::stoul(weight));
+                }
+            }
+            else if (key == "--toggle-min") {
+                config.toggle_min = std::stod(val);
+            }
+            else if (key == "--toggle-max") {
+                config.toggle_max = std::stod(val);
+            }
+            else if (key == "--clocks") {
+                config.clocks = std::stoull(val);
+            }
+            else if (key == "--cycles") {
+                config.cycles = std::stoull(val);
+            }
+            else if (key == "--buffered") {
+                config.buffered = true;
+            }
+            else if (key == "--seed") {
+                config.seed = static_cast<std::uint32_t>(std::stoul(val));
+            }
+            else if (key == "--out") {
+                out_name = val;
+            }
+            else {
+                return false;
+            }
+        }
+        return (config.fanout > 0) && (config.toggle_min <= config.toggle_max);
+    }
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    vcd_bench::workload_config config;
+    std::string out_name;
+    try {
+        if (!parse_args(argc, argv, config, out_name)) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "invalid argument: " << e.what() << "\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    using clock = std::chrono::steady_clock;
+    vcd_bench::null_ostream null_out;
+    std::ofstream file_out;
+    if (!out_name.empty()) {
+        file_out.open(out_name);
+    }
+    std::ostream &out = out_name.empty() ? static_cast<std::ostream &>(null_out) : file_out;
+
+    vcd_bench::workload_result result;
+    vcd_tracer::top dumper("root");
+    vcd_bench::workload design(config);
+
+    auto t0 = clock::now();
+    design.elaborate(dumper);
+    auto t1 = clock::now();
+    dumper.finalize_header(out, std::chrono::system_clock::now());
+    auto t2 = clock::now();
+    const auto header_bytes = out_name.empty() ? null_out.bytes() : static_cast<std::uint64_t>(file_out.tellp());
+    result.changes = design.run(dumper, out);
+    auto t3 = clock::now();
+    out.flush();
+    const auto total_bytes = out_name.empty() ? null_out.bytes() : static_cast<std::uint64_t>(file_out.tellp());
+
+    result.elaboration = t1 - t0;
+    result.header = t2 - t1;
+    result.trace = t3 - t2;
+    result.body_bytes = total_bytes - header_bytes;
+
+    const double changes = static_cast<double>(std::max<std::uint64_t>(1, result.changes));
+    std::cout << "signals:          " << config.signals << "\n"
+              << "modules:          " << design.module_count() << "\n"
+              << "cycles:           " << config.cycles << "\n"
+              << "buffered:         " << (config.buffered ? "yes" : "no") << "\n"
+              << "elaboration_s:    " << result.elaboration.count() << "\n"
+              << "header_s:         " << result.header.count() << "\n"
+              << "trace_s:          " << result.trace.count() << "\n"
+              << "peak_rss_bytes:   " << vcd_bench::peak_rss_bytes() << "\n"
+              << "changes:          " << result.changes << "\n"
+              << "ns_per_change:    " << (result.trace.count() * 1e9) / changes << "\n"
+              << "bytes_per_change: " << static_cast<double>(result.body_bytes) / changes << "\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,235 @@
+/*  -*- c++ -*-
+ *  C++ VCD Tracer Library Synthetic Workload Generator
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#ifndef VCD_BENCH_WORKLOAD_HPP
+#define VCD_BENCH_WORKLOAD_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/vcd_tracer.hpp"
+
+namespace vcd_bench {
+
+    /** Parameters of a synthetic design.
+        The design is a tree of modules, with signals spread evenly over the leaf modules.
+    */
+    struct workload_config {
+        //! Total number of traced signals, including clocks.
+        std::size_t signals{ 100000 };
+        //! Number of module levels below the root.
+        unsigned int depth{ 4 };
+        //! Number of child modules in each module.
+        unsigned int fanout{ 8 };
+        //! Relative weights of the signal types: bool, 8, 16, 32, 64 bit, real.
+        std::array<unsigned int, 6> type_mix{ 4, 1, 1, 2, 1, 1 };
+        //! Lowest per cycle toggle probability of a data signal.
+        double toggle_min{ 0.001 };
+        //! Highest per cycle toggle probability of a data signal.
+        double toggle_max{ 0.1 };
+        //! Number of clock signals, these toggle on every cycle.
+        std::size_t clocks{ 1 };
+        //! Use buffered values, flushing to the trace every trace_depth cycles.
+        bool buffered{ false };
+        //! Number of simulated cycles.
+        std::uint64_t cycles{ 1000 };
+        //! Seed of the pseudo random design.
+        std::uint32_t seed{ 1 };
+    };
+
+    /** Measurements made while running a workload.
+     */
+    struct workload_result {
+        //! Time taken to build modules and elaborate signals.
+        std::chrono::duration<double> elaboration{ 0 };
+        //! Time taken to write the header and initial values.
+        std::chrono::duration<double> header{ 0 };
+        //! Time taken to trace all cycles.
+        std::chrono::duration<double> trace{ 0 };
+        //! Number of value changes made by the workload.
+        std::uint64_t changes{ 0 };
+        //! Number of bytes in the trace body.
+        std::uint64_t body_bytes{ 0 };
+    };
+
+    //! Sequence counter for buffered workload values.
+    inline vcd_tracer::scope_fn::sequence_t workload_seq = 0;
+
+    /** A synthetic design that drives a vcd_tracer::top end to end.
+
+        Signals are toggled with a fixed period derived from their toggle
+        probability, and signals are bucketed by period and phase so each
+        cycle only visits the signals that change.
+     */
+    class workload {
+      public:
+        //! Depth of the trace buffer of buffered values.
+        static constexpr int TRACE_DEPTH = 16;
+
+        explicit workload(const workload_config &config)
+            : _config(config) {
+        }
+
+        /** Build the module hierarchy and elaborate every signal.
+            @param dumper The top scope to elaborate into.
+        */
+        void elaborate(vcd_tracer::top &dumper) {
+            std::mt19937 rng(_config.seed);
+            create_signals(rng);
+            std::size_t leaves = 1;
+            for (unsigned int i = 0; i < _config.depth; i++) {
+                leaves *= _config.fanout;
+            }
+            std::size_t leaf = 0;
+            build(dumper.root, 0, leaves, leaf);
+        }
+
+        /** Run the design for the configured number of cycles.
+            @param dumper The top scope the design was elaborated into.
+            @param out    Trace output.
+            @retval The number of value changes made.
+        */
+        std::uint64_t run(vcd_tracer::top &dumper, std::ostream &out) {
+            std::uint64_t changes = 0;
+            const std::uint64_t flush_interval = _config.buffered ? TRACE_DEPTH : 1;
+            for (std::uint64_t cycle = 1; cycle <= _config.cycles; cycle++) {
+                for (std::size_t c = 0; c < _clocks.size(); c++) {
+                    _clocks[c]->set_uint64(cycle & 0x1);
+                }
+                changes += _clocks.size();
+                for (auto &bucket : _buckets) {
+                    const auto phase = bucket.phases.find(cycle % bucket.period);
+                    if (phase == bucket.phases.end()) {
+                        continue;
+                    }
+                    for (const auto idx : phase->second) {
+                        auto &sig = _signals[idx];
+                        sig.state++;
+                        if (sig.real) {
+                            sig.var->set_double(static_cast<double>(sig.state) * 0.5);
+                        }
+                        else {
+                            sig.var->set_uint64(sig.state);
+                        }
+                        changes++;
+                    }
+                }
+                workload_seq++;
+                if ((cycle % flush_interval) == 0) {
+                    dumper.time_update_abs(out, std::chrono::nanoseconds{ cycle });
+                }
+            }
+            dumper.finalize_trace(out);
+            return changes;
+        }
+
+        //! Number of module instances created during elaboration.
+        [[nodiscard]] std::size_t module_count(void) const { return _modules; }
+
+      private:
+        struct signal {
+            std::unique_ptr<vcd_tracer::value_base> var;
+            bool real{ false };
+            std::uint64_t state{ 0 };
+        };
+        struct toggle_bucket {
+            std::uint64_t period;
+            //! Signals by phase, only phases with signals are stored as periods can be very long.
+            std::map<std::uint64_t, std::vector<std::size_t>> phases;
+        };
+
+        workload_config _config;
+        std::vector<std::unique_ptr<vcd_tracer::value_base>> _clocks;
+        std::vector<signal> _signals;
+        std::vector<toggle_bucket> _buckets;
+        std::size_t _modules{ 0 };
+
+        template<typename T, unsigned int BIT_SIZE>
+        [[nodiscard]] std::unique_ptr<vcd_tracer::value_base> make_value(void) const {
+            if (_config.buffered) {
+                return std::make_unique<vcd_tracer::value<T, BIT_SIZE, TRACE_DEPTH, &workload_seq>>();
+            }
+            return std::make_unique<vcd_tracer::value<T, BIT_SIZE>>();
+        }
+
+        void create_signals(std::mt19937 &rng) {
+            const std::size_t clocks = std::min(_config.clocks, _config.signals);
+            for (std::size_t i = 0; i < clocks; i++) {
+                _clocks.push_back(make_value<bool, 1>());
+            }
+            std::discrete_distribution<unsigned int> type_dist(_config.type_mix.begin(), _config.type_mix.end());
+            std::uniform_real_distribution<double> toggle_dist(_config.toggle_min, _config.toggle_max);
+            std::map<std::uint64_t, std::size_t> bucket_of_period;
+            _signals.resize(_config.signals - clocks);
+            for (std::size_t i = 0; i < _signals.size(); i++) {
+                auto &sig = _signals[i];
+                switch (type_dist(rng)) {
+                case 0: sig.var = make_value<bool, 1>(); break;
+                case 1: sig.var = make_value<std::uint8_t, 8>(); break;
+                case 2: sig.var = make_value<std::uint16_t, 16>(); break;
+                case 3: sig.var = make_value<std::uint32_t, 32>(); break;
+                case 4: sig.var = make_value<std::uint64_t, 64>(); break;
+                default:
+                    sig.var = make_value<double, 64>();
+                    sig.real = true;
+                    break;
+                }
+                // Convert a toggle probability to a fixed toggle period
+                const double probability = std::clamp(toggle_dist(rng), 1e-9, 1.0);
+                const auto period = static_cast<std::uint64_t>(std::max(1.0, std::round(1.0 / probability)));
+                auto [it, inserted] = bucket_of_period.try_emplace(period, _buckets.size());
+                if (inserted) {
+                    _buckets.push_back({ period, {} });
+                }
+                std::uniform_int_distribution<std::uint64_t> phase_dist(0, period - 1);
+                _buckets[it->second].phases[phase_dist(rng)].push_back(i);
+            }
+        }
+
+        void build(vcd_tracer::module &parent, unsigned int level, std::size_t leaves, std::size_t &leaf) {
+            if (level == 0) {
+                // Clocks are at the top of the design.
+                for (std::size_t c = 0; c < _clocks.size(); c++) {
+                    parent.elaborate(*_clocks[c], "clk" + std::to_string(c));
+                }
+            }
+            if (level == _config.depth) {
+                // Elaborate this leaf's share of signals.
+                const std::size_t first = (leaf * _signals.size()) / leaves;
+                const std::size_t last = ((leaf + 1) * _signals.size()) / leaves;
+                for (std::size_t i = first; i < last; i++) {
+                    parent.elaborate(*_signals[i].var, "s" + std::to_string(i - first));
+                }
+                leaf++;
+                return;
+            }
+            for (unsigned int f = 0; f < _config.fanout; f++) {
+                vcd_tracer::module child(parent, "m" + std::to_string(f));
+                _modules++;
+                build(child, level + 1, leaves, leaf);
+            }
+        }
+    };
+
+}// namespace vcd_bench
+
+#endif// VCD_BENCH_WORKLOAD_HPP
@@ -11,6 +11,7 @@ class SimpleVcd(ConanFile):
     name = "SimpleVcd"
     version = "0.1"
     requires = (
+        "benchmark/1.6.1",
         "catch2/2.13.7",
         "docopt.cpp/0.6.2",
         "fmt/8.0.1",
@@ -0,0 +1,95 @@
+/*
+ *  C++ VCD Tracer Library Live Ring Viewer Example.
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Follow a running trace published to shared memory, printing each change.
+ *
+ *    signals signals.vcd /signals &
+ *    ring_viewer /signals
+ */
+
+#include "../src/vcd_ring_reader.hpp"
+#include "../src/vcd_index.hpp"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    std::string format(const vcd_tracer::reader::ring_value &v) {
+        if (v.is_real) {
+            return std::to_string(v.real());
+        }
+        if (v.state == vcd_tracer::index_format::state_x) {
+            return "x";
+        }
+        if (v.state == vcd_tracer::index_format::state_z) {
+            return "z";
+        }
+        if (v.state == vcd_tracer::index_format::state_none) {
+            return "-";
+        }
+        std::array<char, 24> buf;
+        ::snprintf(buf.data(), buf.size(), "0x%llx", static_cast<unsigned long long>(v.bits));
+        return buf.data();
+    }
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " NAME\n";
+        return 1;
+    }
+    const std::string name{ argv[1] };
+
+    // Wait for the simulation to publish it's header.
+    std::unique_ptr<vcd_tracer::reader::ring_reader> ring;
+    for (int attempt = 0; !ring; attempt++) {
+        try {
+            ring = std::make_unique<vcd_tracer::reader::ring_reader>(name);
+        }
+        catch (const std::exception &e) {
+            if (attempt == 100) {
+                std::cerr << "error: " << e.what() << "\n";
+                return 1;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+
+    for (std::size_t i = 0; i < ring->paths().size(); i++) {
+        std::cout << ring->paths()[i] << " = " << format(ring->values()[i]) << "\n";
+    }
+    std::vector<vcd_tracer::reader::ring_change> changes;
+    auto resyncs = ring->resync_count();
+    while (!ring->finished()) {
+        changes.clear();
+        if (ring->read(changes) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (ring->resync_count() != resyncs) {
+            // Changes were missed, show where the reader picked up again.
+            resyncs = ring->resync_count();
+            std::cout << "# resynced at " << ring->time() << "\n";
+        }
+        for (const auto &c : changes) {
+            std::cout << "#" << c.time << " " << ring->paths()[c.signal] << " = " << format(c.value) << "\n";
+        }
+    }
+    return 0;
+}
@@ -13,10 +13,12 @@
 
 
 #include "../src/vcd_tracer.hpp"
+#include "../src/vcd_shm_ring.hpp"
 #include <array>
 #include <cmath>
 #include <string>
 #include <fstream>
+#include <memory>
 
 std::array<uint32_t, 8192> memory {0};
 static constexpr double WAVE_FREQ_HZ=1e6;
@@ -28,6 +30,8 @@ static constexpr unsigned int TICK_NS = 1;
 int main(int argc, const char **argv) {
 
     const std::string fout_name{ (argc > 1) ? argv[1] : "signals.vcd" };
+    // Optionally publish the changes live, see ring_viewer.
+    const std::string shm_name{ (argc > 2) ? argv[2] : "" };
 
     // Define the signals we want to trace. Only one sample is
     // buffered, so each interation needs to write to disk.
@@ -64,6 +68,12 @@ int main(int argc, const char **argv) {
         bus.elaborate(wr_rd_n, "wr_strb");
     }
 
+    std::unique_ptr<vcd_tracer::shm_ring_writer> ring;
+    if (!shm_name.empty()) {
+        ring = std::make_unique<vcd_tracer::shm_ring_writer>(shm_name);
+        dumper.add_observer(ring->observer());
+    }
+
     // Open a file for output
     {
         std::ofstream fout(fout_name);
@@ -108,6 +118,8 @@ int main(int argc, const char **argv) {
             dumper.time_update_abs(fout, std::chrono::nanoseconds{ TICK_NS * i });
             
         }
+        // Flush the last values, and let any viewer know the trace is complete.
+        dumper.finalize_trace(fout);
 
     }
 
@@ -0,0 +1,97 @@
+/*
+ *  C++ VCD Tracer Library - Byte Order and System Error Helpers
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#ifndef VCD_BYTES_HPP
+#define VCD_BYTES_HPP
+
+// Internal to the tracer and reader libraries.
+namespace vcd_tracer::detail {
+
+    /** Store the low bytes of a value, least significant first, as the sidecar files do.
+        @param out   Where to store the bytes.
+        @param v     The value.
+        @param bytes The number of bytes to store.
+    */
+    inline void store_le(char *out, std::uint64_t v, std::size_t bytes) {
+        for (std::size_t i = 0; i < bytes; i++) {
+            out[i] = static_cast<char>(v & 0xFF);
+            v >>= 8;
+        }
+    }
+
+    /** Load a value stored least significant byte first.
+        @param in    The first byte.
+        @param bytes The number of bytes to load.
+    */
+    inline std::uint64_t load_le(const char *in, std::size_t bytes) {
+        std::uint64_t v = 0;
+        for (std::size_t i = bytes; i > 0; i--) {
+            v = (v << 8) | static_cast<unsigned char>(in[i - 1]);
+        }
+        return v;
+    }
+
+    //! The 8 bytes of a value, least significant first.
+    inline std::array<char, 8> le_u64(std::uint64_t v) {
+        std::array<char, 8> bytes;
+        store_le(bytes.data(), v, bytes.size());
+        return bytes;
+    }
+
+    //! The 4 bytes of a value, least significant first.
+    inline std::array<char, 4> le_u32(std::uint32_t v) {
+        std::array<char, 4> bytes;
+        store_le(bytes.data(), v, bytes.size());
+        return bytes;
+    }
+
+    //! Append the 8 bytes of a value, least significant first.
+    inline void append_u64(std::string &out, std::uint64_t v) {
+        const auto bytes = le_u64(v);
+        out.append(bytes.data(), bytes.size());
+    }
+
+    //! Append the 4 bytes of a value, least significant first.
+    inline void append_u32(std::string &out, std::uint32_t v) {
+        const auto bytes = le_u32(v);
+        out.append(bytes.data(), bytes.size());
+    }
+
+    //! Read 8 bytes at an offset, least significant first. The caller checks the size.
+    inline std::uint64_t get_u64(std::string_view data, std::uint64_t offset) {
+        return load_le(data.data() + offset, 8);
+    }
+
+    //! Read 4 bytes at an offset, least significant first. The caller checks the size.
+    inline std::uint32_t get_u32(std::string_view data, std::uint64_t offset) {
+        return static_cast<std::uint32_t>(load_le(data.data() + offset, 4));
+    }
+
+    /** Throw the error of a failed system call.
+        @param what The operation that failed.
+    */
+    [[noreturn]] inline void throw_errno(const char *what) {
+        throw std::system_error(errno, std::system_category(), what);
+    }
+
+}// namespace vcd_tracer::detail
+
+#endif
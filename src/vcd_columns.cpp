@@ -0,0 +1,237 @@
+/*
+ *  C++ VCD Tracer Library - Columnar Export
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "vcd_bytes.hpp"
+#include "vcd_columns.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+
+        using vcd_tracer::detail::get_u32;
+        using vcd_tracer::detail::get_u64;
+        using vcd_tracer::detail::append_u32;
+        using vcd_tracer::detail::append_u64;
+
+        /** Write blocks to the output, padding each to the alignment.
+         */
+        class aligned_writer {
+          public:
+            explicit aligned_writer(std::ostream &out)
+                : _out(out) {
+            }
+
+            //! Write a block, returning it's offset.
+            std::uint64_t write(const std::string &block) {
+                const auto offset = _written;
+                _out.write(block.data(), static_cast<std::streamsize>(block.size()));
+                _written += block.size();
+                const auto pad = (columns_format::alignment - (_written % columns_format::alignment)) % columns_format::alignment;
+                static const std::array<char, columns_format::alignment> zeros{};
+                _out.write(zeros.data(), static_cast<std::streamsize>(pad));
+                _written += pad;
+                return offset;
+            }
+
+          private:
+            std::ostream &_out;
+            std::uint64_t _written{ 0 };
+        };
+
+        struct column_offsets {
+            std::uint64_t count{ 0 };
+            std::uint64_t times{ 0 };
+            std::uint64_t values{ 0 };
+            std::uint64_t states{ 0 };
+        };
+
+    }// namespace
+
+    std::size_t export_columns(const trace &t, std::ostream &out, unsigned int threads) {
+        const auto &hdr = t.get_header();
+        // The header is written again once the directory is placed.
+        const auto start = out.tellp();
+        if (start < 0) {
+            throw std::runtime_error("vcd_tracer::reader::export_columns: the output does not report it's position");
+        }
+        const auto histories = load_histories(t, threads);
+        aligned_writer writer(out);
+        writer.write(std::string(columns_format::alignment, '\0'));
+
+        std::vector<column_offsets> offsets(hdr.signals.size());
+        std::string block;
+        for (std::size_t s = 0; s < hdr.signals.size(); s++) {
+            const auto &history = histories[s];
+            auto &o = offsets[s];
+            o.count = history.size();
+            block.clear();
+            for (const auto &change : history) {
+                append_u64(block, change.time);
+            }
+            o.times = writer.write(block);
+            block.clear();
+            std::string states;
+            for (const auto &change : history) {
+                std::uint64_t bits = 0;
+                std::uint8_t state = columns_format::state_known;
+                if (hdr.signals[s].real) {
+                    double real = 0;
+                    if (!decode_real(change.value, real)) {
+                        throw parse_error("invalid real value '" + std::string(change.value) + "'", hdr.body_offset);
+                    }
+                    std::memcpy(&bits, &real, sizeof(bits));
+                }
+                else if (!decode_bits(change.value, bits)) {
+                    // Any bit that is not 0 or 1 makes the value unknown, 'z' if all are.
+                    const auto v = ((change.value[0] == 'b') || (change.value[0] == 'B')) ? change.value.substr(1) : change.value;
+                    const bool all_z = v.find_first_not_of("zZ") == std::string_view::npos;
+                    state = all_z ? columns_format::state_z : columns_format::state_x;
+                }
+                append_u64(block, bits);
+                states.push_back(static_cast<char>(state));
+            }
+            o.values = writer.write(block);
+            if (!hdr.signals[s].real) {
+                o.states = writer.write(states);
+            }
+        }
+
+        std::string directory;
+        append_u32(directory, static_cast<std::uint32_t>(hdr.timescale.size()));
+        directory += hdr.timescale;
+        append_u64(directory, hdr.vars.size());
+        for (std::size_t v = 0; v < hdr.vars.size(); v++) {
+            const auto path = hdr.path(v);
+            const auto &sig = hdr.signals[hdr.vars[v].signal];
+            const auto &o = offsets[hdr.vars[v].signal];
+            append_u32(directory, static_cast<std::uint32_t>(path.size()));
+            directory += path;
+            append_u32(directory, sig.bit_size);
+            append_u32(directory, sig.real ? columns_format::real : 0);
+            append_u64(directory, o.count);
+            append_u64(directory, o.times);
+            append_u64(directory, o.values);
+            append_u64(directory, o.states);
+        }
+        const auto directory_offset = writer.write(directory);
+
+        std::string header(columns_format::magic.data(), columns_format::magic.size());
+        append_u64(header, directory_offset);
+        append_u64(header, directory.size());
+        const auto end = out.tellp();
+        out.seekp(start);
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.seekp(end);
+        if (!out) {
+            throw std::runtime_error("vcd_tracer::reader::export_columns: the output can not be written");
+        }
+        return hdr.vars.size();
+    }
+
+    trace_columns::trace_columns(mapped_file file)
+        : _file(std::move(file)),
+          _data(_file->data()) {
+        parse();
+    }
+
+    trace_columns::trace_columns(std::string_view data)
+        : _data(data) {
+        parse();
+    }
+
+    void trace_columns::parse(void) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+        throw parse_error("columns are only read in place on a little endian host", 0);
+#endif
+        const auto magic_size = columns_format::magic.size();
+        if ((_data.size() < columns_format::alignment)
+            || (_data.substr(0, magic_size) != std::string_view(columns_format::magic.data(), magic_size))) {
+            throw parse_error("not a columns file", 0);
+        }
+        if ((reinterpret_cast<std::uintptr_t>(_data.data()) % alignof(std::uint64_t)) != 0) {
+            throw parse_error("columns data is not aligned", 0);
+        }
+        const auto directory = get_u64(_data, magic_size);
+        const auto directory_size = get_u64(_data, magic_size + 8);
+        if ((directory > _data.size()) || (directory_size > (_data.size() - directory))) {
+            throw parse_error("invalid columns directory", magic_size);
+        }
+        const auto end = directory + directory_size;
+        std::uint64_t pos = directory;
+        const auto text = [&](void) {
+            if ((pos + 4) > end) {
+                throw parse_error("truncated columns directory", pos);
+            }
+            const auto length = get_u32(_data, pos);
+            pos += 4;
+            if ((pos + length) > end) {
+                throw parse_error("truncated columns directory", pos);
+            }
+            std::string s(_data.substr(pos, length));
+            pos += length;
+            return s;
+        };
+        // An array must lie before the directory, and be aligned.
+        const auto array = [&](std::uint64_t offset, std::uint64_t count, std::uint64_t size) {
+            if ((offset % columns_format::alignment) != 0) {
+                throw parse_error("columns array is not aligned", pos);
+            }
+            if ((offset > directory) || (count > ((directory - offset) / size))) {
+                throw parse_error("columns array is out of range", pos);
+            }
+            return _data.data() + offset;
+        };
+        _timescale = text();
+        if ((pos + 8) > end) {
+            throw parse_error("truncated columns directory", pos);
+        }
+        const auto count = get_u64(_data, pos);
+        pos += 8;
+        for (std::uint64_t n = 0; n < count; n++) {
+            column c;
+            c.path = text();
+            if ((pos + 40) > end) {
+                throw parse_error("truncated columns directory", pos);
+            }
+            c.bit_size = get_u32(_data, pos);
+            c.real = (get_u32(_data, pos + 4) & columns_format::real) != 0;
+            const auto changes = get_u64(_data, pos + 8);
+            c.count = static_cast<std::size_t>(changes);
+            c.times = reinterpret_cast<const std::uint64_t *>(array(get_u64(_data, pos + 16), changes, 8));
+            const char *values = array(get_u64(_data, pos + 24), changes, 8);
+            if (c.real) {
+                c.reals = reinterpret_cast<const double *>(values);
+            }
+            else {
+                c.bits = reinterpret_cast<const std::uint64_t *>(values);
+                c.states = reinterpret_cast<const std::uint8_t *>(array(get_u64(_data, pos + 32), changes, 1));
+            }
+            pos += 40;
+            _columns.push_back(std::move(c));
+        }
+    }
+
+    const column *trace_columns::find(std::string_view path) const {
+        for (const auto &c : _columns) {
+            if (c.path == path) {
+                return &c;
+            }
+        }
+        return nullptr;
+    }
+
+}// namespace vcd_tracer::reader
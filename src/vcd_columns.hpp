@@ -0,0 +1,130 @@
+/*
+ *  C++ VCD Tracer Library - Columnar Export
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vcd_reader.hpp"
+
+#ifndef VCD_COLUMNS_HPP
+#define VCD_COLUMNS_HPP
+
+/**
+   Columnar export:
+
+   The changes of each signal are stored as separate, contiguous arrays, so
+   an analysis can map the file and read only the columns it needs.
+
+   File layout, all integers are little endian and every array starts on a
+   64 byte boundary:
+
+   - Header:    "VCDCOLS1", u64 directory offset, u64 directory size, padding to 64 bytes.
+   - Columns:   per signal, u64 times, then u64 values (the low 64 bits) or f64 values for reals,
+                then for non real signals a u8 state per change (0 known, 1 'x', 2 'z').
+   - Directory: u32 length and the timescale, u64 column count, then per variable
+                u32 length and the hierarchical path, u32 bit size, u32 flags (1 real),
+                u64 change count, u64 times offset, u64 values offset, u64 states offset.
+                Variables that share a signal share the arrays.
+ */
+namespace vcd_tracer::reader::columns_format {
+    //! Magic at the start of a columns file.
+    constexpr std::array<char, 8> magic{ 'V', 'C', 'D', 'C', 'O', 'L', 'S', '1' };
+    //! Alignment of the header and arrays.
+    constexpr std::size_t alignment = 64;
+    //! Column flag, the values are reals.
+    constexpr std::uint32_t real = 1;
+    //! State of a known value.
+    constexpr std::uint8_t state_known = 0;
+    //! State of an 'x' value.
+    constexpr std::uint8_t state_x = 1;
+    //! State of a 'z' value.
+    constexpr std::uint8_t state_z = 2;
+}// namespace vcd_tracer::reader::columns_format
+
+namespace vcd_tracer::reader {
+
+    /** Write the changes of a trace as columns.
+        The trace is parsed in parallel chunks, see load_histories().
+        @param t       The trace.
+        @param out     The columns output, opened in binary mode.
+        @param threads Number of threads, 0 to use the hardware concurrency.
+        @retval The number of columns written.
+        @throw parse_error If the trace is malformed.
+    */
+    std::size_t export_columns(const trace &t, std::ostream &out, unsigned int threads = 0);
+
+    /** The change arrays of a variable.
+        The arrays point into the columns file.
+     */
+    struct column {
+        //! The hierarchical path of the variable.
+        std::string path;
+        //! The size, in bits.
+        unsigned int bit_size{ 0 };
+        //! Set if the values are reals.
+        bool real{ false };
+        //! The number of changes.
+        std::size_t count{ 0 };
+        //! The time of each change.
+        const std::uint64_t *times{ nullptr };
+        //! The low 64 bits of each value, if not real.
+        const std::uint64_t *bits{ nullptr };
+        //! Each value, if real.
+        const double *reals{ nullptr };
+        //! The state of each value, if not real.
+        const std::uint8_t *states{ nullptr };
+    };
+
+    /** A columns file written by export_columns().
+        The arrays are used in place, so this needs a little endian host.
+     */
+    class trace_columns {
+      public:
+        /** Read columns from a mapped file.
+            @throw parse_error If the file is not a columns file.
+        */
+        explicit trace_columns(mapped_file file);
+        /** Read columns from a buffer, the buffer must be 8 byte aligned and outlive this object.
+            @throw parse_error If the data is not a columns file.
+        */
+        explicit trace_columns(std::string_view data);
+        trace_columns(trace_columns &&) = default;
+        trace_columns(const trace_columns &) = delete;
+        trace_columns &operator=(const trace_columns &) = delete;
+
+        //! The timescale of the trace, such as "1ns".
+        [[nodiscard]] const std::string &timescale(void) const { return _timescale; }
+        //! The columns, in declaration order.
+        [[nodiscard]] const std::vector<column> &columns(void) const { return _columns; }
+
+        /** Find a column by the hierarchical path of a variable.
+            @retval nullptr If the path is not in the file.
+        */
+        [[nodiscard]] const column *find(std::string_view path) const;
+
+      private:
+        void parse(void);
+        std::optional<mapped_file> _file;
+        std::string_view _data;
+        std::string _timescale;
+        std::vector<column> _columns;
+    };
+
+}// namespace vcd_tracer::reader
+
+#endif
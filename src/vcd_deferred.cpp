@@ -0,0 +1,210 @@
+/*
+ *  C++ VCD Tracer Library - Deferred Header Files
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vcd_bytes.hpp"
+#include "vcd_deferred.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        using detail::throw_errno;
+
+        /** Close a file descriptor when it goes out of scope.
+         */
+        class file_descriptor {
+          public:
+            explicit file_descriptor(int fd)
+                : _fd(fd) {
+            }
+            file_descriptor(const file_descriptor &) = delete;
+            file_descriptor(file_descriptor &&) = delete;
+            file_descriptor &operator=(const file_descriptor &) = delete;
+            file_descriptor &operator=(file_descriptor &&) = delete;
+            ~file_descriptor(void) {
+                if (_fd >= 0) {
+                    ::close(_fd);
+                }
+            }
+            [[nodiscard]] int get(void) const { return _fd; }
+            //! Close now, to see the error.
+            void close(void) {
+                if (::close(std::exchange(_fd, -1)) != 0) {
+                    throw_errno("deferred_file close");
+                }
+            }
+
+          private:
+            int _fd;
+        };
+
+        void write_all(int fd, const char *data, std::size_t size) {
+            std::size_t done = 0;
+            while (done < size) {
+                const auto n = ::write(fd, data + done, size - done);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_errno("deferred_file write");
+                }
+                done += static_cast<std::size_t>(n);
+            }
+        }
+
+        // Errors meaning the call does not work for these files.
+        bool unsupported(int error) {
+            return (error == EOPNOTSUPP) || (error == ENOTTY) || (error == EXDEV) || (error == EINVAL) || (error == ENOSYS);
+        }
+
+        /** Pad the header with a comment before $enddefinitions, so it ends on a block boundary.
+         */
+        std::string pad_header(const std::string &header, std::size_t block) {
+            const std::string open = "$comment\n";
+            const std::string close = "$end\n";
+            const auto at = header.rfind("$enddefinitions");
+            const std::size_t size = header.size() + open.size() + close.size();
+            std::string fill((block - (size % block)) % block, ' ');
+            if (!fill.empty()) {
+                fill.back() = '\n';
+            }
+            return header.substr(0, at) + open + fill + close + header.substr(at);
+        }
+    }// namespace
+
+    deferred_file::deferred_file(top &dumper, std::string path, deferred_options options)
+        : _dumper(dumper), _path(std::move(path)), _body_path(_path + ".body"), _options(options) {
+        _body.open(_body_path, std::ios::binary | std::ios::trunc);
+        if (!_body.is_open()) {
+            throw_errno("deferred_file open");
+        }
+    }
+
+    deferred_file::~deferred_file(void) {
+        try {
+            finish();
+        }
+        catch (const std::system_error &) {
+            // Call finish() to see errors.
+        }
+    }
+
+    trace_observer deferred_file::observer(void) {
+        trace_observer o;
+        o.on_finalize = [this](std::ostream &) { finish(); };
+        return o;
+    }
+
+    void deferred_file::finish(void) {
+        if (_method != stitch_method::none) {
+            return;
+        }
+        _body.close();
+        if (_body.fail()) {
+            throw std::system_error(std::make_error_code(std::errc::io_error), "deferred_file body");
+        }
+        std::ostringstream header_text;
+        _dumper.write_deferred_header(header_text);
+        const std::string header = header_text.str();
+
+        file_descriptor in(::open(_body_path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (in.get() < 0) {
+            throw_errno("deferred_file open");
+        }
+        file_descriptor out(::open(_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (out.get() < 0) {
+            throw_errno("deferred_file open");
+        }
+
+        if (_options.reflink) {
+            struct stat st {};
+            if (::fstat(out.get(), &st) != 0) {
+                throw_errno("deferred_file fstat");
+            }
+            const std::string padded = pad_header(header, static_cast<std::size_t>(st.st_blksize));
+            write_all(out.get(), padded.data(), padded.size());
+            // A zero length clones to the end of the body.
+            file_clone_range range{};
+            range.src_fd = in.get();
+            range.dest_offset = padded.size();
+            if (::ioctl(out.get(), FICLONERANGE, &range) == 0) {
+                _method = stitch_method::reflink;
+            }
+            else if (!unsupported(errno)) {
+                throw_errno("deferred_file reflink");
+            }
+            else if ((::ftruncate(out.get(), 0) != 0) || (::lseek(out.get(), 0, SEEK_SET) != 0)) {
+                throw_errno("deferred_file ftruncate");
+            }
+        }
+
+        if (_method == stitch_method::none) {
+            write_all(out.get(), header.data(), header.size());
+            if (_options.copy_file_range) {
+                std::size_t copied = 0;
+                for (;;) {
+                    const auto n = ::copy_file_range(in.get(), nullptr, out.get(), nullptr, 1U << 30U, 0);
+                    if (n > 0) {
+                        copied += static_cast<std::size_t>(n);
+                        continue;
+                    }
+                    if (n == 0) {
+                        _method = stitch_method::copy_file_range;
+                        break;
+                    }
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    // Nothing copied yet, so the plain copy can still start from the beginning.
+                    if ((copied > 0) || !unsupported(errno)) {
+                        throw_errno("deferred_file copy_file_range");
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (_method == stitch_method::none) {
+            std::array<char, 65536> buffer{};
+            for (;;) {
+                const auto n = ::read(in.get(), buffer.data(), buffer.size());
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw_errno("deferred_file read");
+                }
+                if (n == 0) {
+                    break;
+                }
+                write_all(out.get(), buffer.data(), static_cast<std::size_t>(n));
+            }
+            _method = stitch_method::copy;
+        }
+        out.close();
+        std::remove(_body_path.c_str());
+    }
+
+}// namespace vcd_tracer
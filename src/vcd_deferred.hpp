@@ -0,0 +1,110 @@
+/*
+ *  C++ VCD Tracer Library - Deferred Header Files
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <fstream>
+#include <string>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_DEFERRED_HPP
+#define VCD_DEFERRED_HPP
+
+namespace vcd_tracer {
+
+    /** Options to control how a deferred_file is put together.
+     */
+    struct deferred_options {
+        //! Try to share the body blocks with a reflink (FICLONERANGE) rather than copy them.
+        bool reflink{ true };
+        //! Try to copy the body in the kernel with copy_file_range().
+        bool copy_file_range{ true };
+    };
+
+    /** How the body of a deferred_file was put behind the header.
+     */
+    enum class stitch_method {
+        //! Not yet done.
+        none,
+        //! The body blocks are shared with a reflink.
+        reflink,
+        //! The body was copied with copy_file_range().
+        copy_file_range,
+        //! The body was copied with read() and write().
+        copy
+    };
+
+    /** A trace file with a deferred header, so trace variables can be added after tracing starts.
+
+        @code
+        vcd_tracer::deferred_file file(dumper, "trace.vcd");
+        dumper.add_observer(file.observer());
+        dumper.start_deferred(file.body(), std::chrono::system_clock::now());
+        ...
+        core.elaborate(late_value, "late");
+        ...
+        dumper.finalize_trace(file.body());
+        @endcode
+
+        The body is written to PATH.body. When the trace is finalized the
+        header is written to PATH, and the body is put behind it without
+        reading it back through user space: with a reflink if the file
+        system supports one, else with copy_file_range(), else with a plain
+        copy. A reflink needs the body to start on a block boundary, so the
+        header is padded with a $comment. PATH.body is then removed.
+
+        Modules that trace variables are added to later must still exist.
+        The header length is not known while the body is traced, so sidecar
+        writers that record trace offsets, such as index_writer, can not be
+        used and start_deferred() throws.
+     */
+    class deferred_file {
+      public:
+        /** @param dumper  The top scope of the trace, it must outlive the file.
+            @param path    The trace file to create.
+            @param options Controls how the file is put together.
+        */
+        deferred_file(top &dumper, std::string path, deferred_options options = {});
+        deferred_file(const deferred_file &) = delete;
+        deferred_file(deferred_file &&) = delete;
+        deferred_file &operator=(const deferred_file &) = delete;
+        deferred_file &operator=(deferred_file &&) = delete;
+        ~deferred_file(void);
+
+        /** The stream to trace the body to.
+         */
+        std::ostream &body(void) { return _body; }
+
+        /** The functions to add to the top scope with top::add_observer(),
+            to write the file when the trace is finalized.
+         */
+        trace_observer observer(void);
+
+        /** Write the header and put the body behind it.
+         */
+        void finish(void);
+
+        //! How the body was put behind the header.
+        [[nodiscard]] stitch_method method(void) const { return _method; }
+
+      private:
+        top &_dumper;
+        std::string _path;
+        std::string _body_path;
+        deferred_options _options;
+        std::ofstream _body;
+        stitch_method _method{ stitch_method::none };
+    };
+
+}// namespace vcd_tracer
+
+#endif
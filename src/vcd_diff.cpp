@@ -0,0 +1,385 @@
+/*
+ *  C++ VCD Tracer Library - Trace Comparison
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+
+#include "vcd_diff.hpp"
+#include "vcd_parallel.hpp"
+#include "vcd_query.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+
+        //! A pair of signals that are compared, and the variables that use them.
+        struct signal_pair {
+            std::size_t a;
+            std::size_t b;
+            std::vector<std::size_t> vars;
+        };
+
+        //! The first difference of a signal pair.
+        struct first_difference {
+            std::uint64_t time;
+            std::string_view a;
+            std::string_view b;
+        };
+
+        /** A change read from a chunk, bucketed by the partition of its signal.
+         */
+        struct chunk_change {
+            std::size_t signal;
+            std::uint64_t time;
+            std::string_view value;
+        };
+
+        //! The buckets of each chunk of a trace, by chunk then partition.
+        using chunk_buckets = std::vector<std::vector<std::vector<chunk_change>>>;
+
+        /** Read the changes of one partition from the buckets of each chunk, in trace order.
+            A bucket is released once it has been read.
+         */
+        class bucket_cursor {
+          public:
+            bucket_cursor(chunk_buckets &parsed, std::size_t partition)
+                : _parsed(parsed), _partition(partition) {
+            }
+
+            bool next(value_change &change) {
+                while (_chunk < _parsed.size()) {
+                    auto &bucket = _parsed[_chunk][_partition];
+                    if (_pos < bucket.size()) {
+                        const auto &c = bucket[_pos++];
+                        change.time = c.time;
+                        change.signal = c.signal;
+                        change.value = c.value;
+                        return true;
+                    }
+                    std::vector<chunk_change>().swap(bucket);
+                    _chunk++;
+                    _pos = 0;
+                }
+                return false;
+            }
+
+          private:
+            chunk_buckets &_parsed;
+            std::size_t _partition;
+            std::size_t _chunk{ 0 };
+            std::size_t _pos{ 0 };
+        };
+
+        /** Compare a range of the signal pairs through a single pass over the changes of both traces.
+            Changes of the signals of other pairs are skipped.
+            @param a_cursor The changes of the first trace, in trace order.
+            @param b_cursor The changes of the second trace, in trace order.
+            @param begin    The first pair to compare.
+            @param end      One past the last pair to compare.
+         */
+        template<typename Cursor>
+        void compare_streaming(const trace &a,
+                               const trace &b,
+                               Cursor a_cursor,
+                               Cursor b_cursor,
+                               const std::vector<signal_pair> &pairs,
+                               std::size_t begin,
+                               std::size_t end,
+                               std::vector<std::optional<first_difference>> &first) {
+            std::vector<std::vector<std::size_t>> a_pairs(a.get_header().signals.size());
+            std::vector<std::vector<std::size_t>> b_pairs(b.get_header().signals.size());
+            for (std::size_t p = begin; p < end; p++) {
+                a_pairs[pairs[p].a].push_back(p);
+                b_pairs[pairs[p].b].push_back(p);
+            }
+            std::vector<std::string_view> a_values(pairs.size());
+            std::vector<std::string_view> b_values(pairs.size());
+            std::vector<bool> is_touched(pairs.size(), false);
+            std::vector<std::size_t> touched;
+
+            value_change a_change;
+            value_change b_change;
+            bool a_more = a_cursor.next(a_change);
+            bool b_more = b_cursor.next(b_change);
+            constexpr auto never = std::numeric_limits<std::uint64_t>::max();
+            while (a_more || b_more) {
+                const std::uint64_t time = std::min(a_more ? a_change.time : never, b_more ? b_change.time : never);
+                // Apply every change at this time, then compare what changed.
+                const auto apply = [&](Cursor &cursor, value_change &change, bool &more, const auto &signal_pairs, auto &values) {
+                    while (more && (change.time == time)) {
+                        for (const auto p : signal_pairs[change.signal]) {
+                            values[p] = change.value;
+                            if (!is_touched[p]) {
+                                is_touched[p] = true;
+                                touched.push_back(p);
+                            }
+                        }
+                        more = cursor.next(change);
+                    }
+                };
+                apply(a_cursor, a_change, a_more, a_pairs, a_values);
+                apply(b_cursor, b_change, b_more, b_pairs, b_values);
+                for (const auto p : touched) {
+                    is_touched[p] = false;
+                    if (!first[p] && !same_value(a_values[p], b_values[p])) {
+                        first[p] = first_difference{ time, a_values[p], b_values[p] };
+                    }
+                }
+                touched.clear();
+            }
+        }
+
+        /** The partitions with a pair that uses each signal of a trace.
+            @param signals The number of signals in the trace.
+            @param side    The signal of a pair in the trace.
+         */
+        template<typename Side>
+        std::vector<std::vector<std::size_t>> signal_partitions(std::size_t signals,
+                                                                const std::vector<signal_pair> &pairs,
+                                                                std::size_t partitions,
+                                                                Side side) {
+            std::vector<std::vector<std::size_t>> result(signals);
+            for (std::size_t part = 0; part < partitions; part++) {
+                const std::size_t begin = (part * pairs.size()) / partitions;
+                const std::size_t end = ((part + 1) * pairs.size()) / partitions;
+                for (std::size_t p = begin; p < end; p++) {
+                    auto &of = result[side(pairs[p])];
+                    if (of.empty() || (of.back() != part)) {
+                        of.push_back(part);
+                    }
+                }
+            }
+            return result;
+        }
+
+        /** Compare the signal pairs in partitions, on a number of threads.
+            Each trace is parsed once, in chunks, and the changes of each chunk are
+            bucketed by the partitions of the pairs that use their signal. Then
+            each partition merges its own buckets of both traces. Until a bucket
+            is merged it holds 32 bytes per compared change on a 64 bit target.
+         */
+        void compare_partitioned(const trace &a,
+                                 const trace &b,
+                                 const std::vector<signal_pair> &pairs,
+                                 std::size_t partitions,
+                                 unsigned int threads,
+                                 std::vector<std::optional<first_difference>> &first) {
+            // Several chunks per thread balances the load.
+            const auto a_parts = signal_partitions(a.get_header().signals.size(), pairs, partitions, [](const signal_pair &p) { return p.a; });
+            const auto b_parts = signal_partitions(b.get_header().signals.size(), pairs, partitions, [](const signal_pair &p) { return p.b; });
+            const auto a_chunks = split_body(a, static_cast<std::size_t>(threads) * 4);
+            const auto b_chunks = split_body(b, static_cast<std::size_t>(threads) * 4);
+            chunk_buckets a_parsed(a_chunks.size());
+            chunk_buckets b_parsed(b_chunks.size());
+            detail::parallel_for(a_chunks.size() + b_chunks.size(), threads, [&](std::size_t c) {
+                const bool is_a = (c < a_chunks.size());
+                const trace &t = is_a ? a : b;
+                const auto chunk = is_a ? a_chunks[c] : b_chunks[c - a_chunks.size()];
+                const auto &parts = is_a ? a_parts : b_parts;
+                auto &buckets = is_a ? a_parsed[c] : b_parsed[c - a_chunks.size()];
+                buckets.resize(partitions);
+                for (auto &bucket : buckets) {
+                    bucket.reserve(chunk.size() / (8 * partitions));
+                }
+                change_cursor cursor(t.get_header(), chunk.data(), chunk.data() + chunk.size(), 0, t.data().data());
+                value_change change;
+                while (cursor.next(change)) {
+                    for (const auto part : parts[change.signal]) {
+                        buckets[part].push_back({ change.signal, change.time, change.value });
+                    }
+                }
+            });
+
+            // Each partition merges its own buckets of both traces, keeping only the values of its own pairs.
+            detail::parallel_for(partitions, static_cast<unsigned int>(partitions), [&](std::size_t part) {
+                const std::size_t begin = (part * pairs.size()) / partitions;
+                const std::size_t end = ((part + 1) * pairs.size()) / partitions;
+                compare_streaming(a, b, bucket_cursor(a_parsed, part), bucket_cursor(b_parsed, part), pairs, begin, end, first);
+            });
+        }
+
+        /** Compare the histories of two signals.
+            @param a_value The value in the first trace before the history.
+            @param b_value The value in the second trace before the history.
+         */
+        std::optional<first_difference> compare_histories(const signal_history &a,
+                                                          const signal_history &b,
+                                                          std::string_view a_value = {},
+                                                          std::string_view b_value = {}) {
+            std::size_t i = 0;
+            std::size_t j = 0;
+            constexpr auto never = std::numeric_limits<std::uint64_t>::max();
+            while ((i < a.size()) || (j < b.size())) {
+                const std::uint64_t time = std::min((i < a.size()) ? a[i].time : never, (j < b.size()) ? b[j].time : never);
+                for (; (i < a.size()) && (a[i].time == time); i++) {
+                    a_value = a[i].value;
+                }
+                for (; (j < b.size()) && (b[j].time == time); j++) {
+                    b_value = b[j].value;
+                }
+                if (!same_value(a_value, b_value)) {
+                    return first_difference{ time, a_value, b_value };
+                }
+            }
+            return std::nullopt;
+        }
+
+        /** Match the variables of two traces by path.
+         */
+        void match_vars(const header &a_hdr, const header &b_hdr, diff_result &result, std::vector<signal_pair> &pairs) {
+            std::map<std::pair<std::size_t, std::size_t>, std::size_t> pair_index;
+            for (std::size_t v = 0; v < a_hdr.vars.size(); v++) {
+                auto path = a_hdr.path(v);
+                const auto bv = b_hdr.find_var(path);
+                if (bv == npos) {
+                    result.only_a.push_back(std::move(path));
+                    continue;
+                }
+                const auto key = std::make_pair(a_hdr.vars[v].signal, b_hdr.vars[bv].signal);
+                const auto [it, added] = pair_index.emplace(key, pairs.size());
+                if (added) {
+                    pairs.push_back({ key.first, key.second, {} });
+                }
+                pairs[it->second].vars.push_back(v);
+                result.compared++;
+            }
+            for (std::size_t v = 0; v < b_hdr.vars.size(); v++) {
+                auto path = b_hdr.path(v);
+                if (a_hdr.find_var(path) == npos) {
+                    result.only_b.push_back(std::move(path));
+                }
+            }
+        }
+
+        void check_timescales(const header &a_hdr, const header &b_hdr) {
+            if (timescale_fs(a_hdr.timescale) != timescale_fs(b_hdr.timescale)) {
+                throw parse_error("the timescales differ, " + a_hdr.timescale + " and " + b_hdr.timescale, b_hdr.body_offset);
+            }
+        }
+
+        /** Report the first differences, by time then path.
+         */
+        void report(const header &a_hdr,
+                    const std::vector<signal_pair> &pairs,
+                    const std::vector<std::optional<first_difference>> &first,
+                    diff_result &result) {
+            for (std::size_t p = 0; p < pairs.size(); p++) {
+                if (first[p]) {
+                    for (const auto v : pairs[p].vars) {
+                        result.divergences.push_back({ a_hdr.path(v), first[p]->time, std::string(first[p]->a), std::string(first[p]->b) });
+                    }
+                }
+            }
+            std::sort(result.divergences.begin(), result.divergences.end(), [](const divergence &x, const divergence &y) {
+                return (x.time < y.time) || ((x.time == y.time) && (x.path < y.path));
+            });
+        }
+
+    }// namespace
+
+    diff_result diff(const trace &a, const trace &b, unsigned int threads) {
+        const auto &a_hdr = a.get_header();
+        const auto &b_hdr = b.get_header();
+        check_timescales(a_hdr, b_hdr);
+        diff_result result;
+        std::vector<signal_pair> pairs;
+        match_vars(a_hdr, b_hdr, result, pairs);
+
+        std::vector<std::optional<first_difference>> first(pairs.size());
+        threads = detail::thread_count(threads);
+        const std::size_t partitions = std::max<std::size_t>(1, std::min<std::size_t>(pairs.size(), threads));
+        if (partitions == 1) {
+            // A single pass over both traces, nothing is held but the current values.
+            compare_streaming(a, b, a.changes(), b.changes(), pairs, 0, pairs.size(), first);
+        }
+        else {
+            compare_partitioned(a, b, pairs, partitions, threads, first);
+        }
+
+        report(a_hdr, pairs, first, result);
+        return result;
+    }
+
+    diff_result diff_windows(const trace &a,
+                             const trace_index *a_index,
+                             const trace &b,
+                             const trace_index *b_index,
+                             const std::vector<hash_difference> &differences) {
+        const auto &a_hdr = a.get_header();
+        const auto &b_hdr = b.get_header();
+        check_timescales(a_hdr, b_hdr);
+        diff_result result;
+        std::vector<signal_pair> pairs;
+        match_vars(a_hdr, b_hdr, result, pairs);
+
+        // The pairs of each group, by the scope of the first variable.
+        std::map<std::string, std::vector<std::size_t>> group_pairs;
+        for (std::size_t p = 0; p < pairs.size(); p++) {
+            group_pairs[a_hdr.scope_path(a_hdr.vars[pairs[p].vars.front()].scope)].push_back(p);
+        }
+
+        std::vector<std::optional<first_difference>> first(pairs.size());
+        // Values are kept until the differences are reported, a deque does not move them.
+        std::deque<window> kept;
+        const query a_query(a, a_index);
+        const query b_query(b, b_index);
+        for (std::size_t d = 0; d < differences.size();) {
+            // Every group that differs in this window.
+            const auto begin = differences[d].begin;
+            const auto end = differences[d].end;
+            std::set<std::size_t> selected;
+            for (; (d < differences.size()) && (differences[d].begin == begin); d++) {
+                const auto it = group_pairs.find(differences[d].group);
+                if (it != group_pairs.end()) {
+                    for (const auto p : it->second) {
+                        if (!first[p]) {
+                            selected.insert(p);
+                        }
+                    }
+                }
+            }
+            if (selected.empty()) {
+                continue;
+            }
+            std::vector<std::size_t> a_signals;
+            std::vector<std::size_t> b_signals;
+            for (const auto p : selected) {
+                a_signals.push_back(pairs[p].a);
+                b_signals.push_back(pairs[p].b);
+            }
+            kept.push_back(a_query.changes(a_signals, begin, end - 1));
+            kept.push_back(b_query.changes(b_signals, begin, end - 1));
+            const auto &a_window = kept[kept.size() - 2];
+            const auto &b_window = kept.back();
+            std::size_t k = 0;
+            for (const auto p : selected) {
+                if (!same_value(a_window.before[k], b_window.before[k])) {
+                    first[p] = first_difference{ begin, a_window.before[k], b_window.before[k] };
+                }
+                else {
+                    first[p] = compare_histories(a_window.changes[k], b_window.changes[k], a_window.before[k], b_window.before[k]);
+                }
+                k++;
+            }
+        }
+
+        report(a_hdr, pairs, first, result);
+        return result;
+    }
+
+}// namespace vcd_tracer::reader
@@ -0,0 +1,104 @@
+/*
+ *  C++ VCD Tracer Library - Trace Comparison
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vcd_hash_reader.hpp"
+#include "vcd_index_reader.hpp"
+#include "vcd_reader.hpp"
+
+#ifndef VCD_DIFF_HPP
+#define VCD_DIFF_HPP
+
+namespace vcd_tracer::reader {
+
+    /** The first difference of a variable.
+     */
+    struct divergence {
+        //! The hierarchical path of the variable.
+        std::string path;
+        //! The first time the values differ.
+        std::uint64_t time{ 0 };
+        //! The value in the first trace at that time, empty before it's first change.
+        std::string a;
+        //! The value in the second trace at that time, empty before it's first change.
+        std::string b;
+    };
+
+    /** The differences between two traces.
+     */
+    struct diff_result {
+        //! Paths of variables that are only in the first trace.
+        std::vector<std::string> only_a;
+        //! Paths of variables that are only in the second trace.
+        std::vector<std::string> only_b;
+        //! The first difference of each variable that differs, by time then path.
+        std::vector<divergence> divergences;
+        //! The number of variables compared.
+        std::size_t compared{ 0 };
+
+        //! True if the traces are the same.
+        [[nodiscard]] bool same(void) const { return only_a.empty() && only_b.empty() && divergences.empty(); }
+    };
+
+    /** Compare two traces by what they record rather than how it is written.
+
+        Variables are matched by hierarchical path, so the identifier
+        assignment does not matter. Only the value of each variable at the
+        end of each timestamp is compared, so the order of the changes within
+        a timestamp does not matter, nor do repeated values or how a value is
+        formatted (see same_value()).
+
+        Both traces are streamed side by side in a single pass, holding only
+        the current value of each variable. With more threads the variables
+        are split into partitions. Each trace is split at timestamps and the
+        chunks are parsed once in parallel, bucketing the changes by
+        partition, then each thread merges the buckets of it's own partition.
+        Until a bucket is merged it holds 32 bytes per compared change.
+
+        Both traces must use the same timescale.
+
+        @param a       The first, such as golden, trace.
+        @param b       The second trace.
+        @param threads Number of threads, 0 to use the hardware concurrency.
+        @throw parse_error If a trace is malformed or the timescales differ.
+    */
+    [[nodiscard]] diff_result diff(const trace &a, const trace &b, unsigned int threads = 0);
+
+    /** Compare two traces only where their window hashes differ.
+
+        The window hashes (see vcd_tracer::hash_writer) say which groups of
+        signals changed differently in which windows. Only the variables of
+        those groups are compared, and only within those windows, using the
+        sidecar indexes to seek to each window when they are given. Before
+        the first differing window of a group it's variables are taken to be
+        the same, so the result is that of diff() unless the hashes collide.
+
+        @param a           The first, such as golden, trace.
+        @param a_index     An index of the first trace, or nullptr.
+        @param b           The second trace.
+        @param b_index     An index of the second trace, or nullptr.
+        @param differences The differing windows, from compare_hashes().
+        @throw parse_error If a trace is malformed or the timescales differ.
+    */
+    [[nodiscard]] diff_result diff_windows(const trace &a,
+                                           const trace_index *a_index,
+                                           const trace &b,
+                                           const trace_index *b_index,
+                                           const std::vector<hash_difference> &differences);
+
+}// namespace vcd_tracer::reader
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ *  C++ VCD Tracer Library - Fan-out to Multiple Outputs
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+#include "vcd_fanout.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        // Room for the longest change line, so the buffer rarely grows.
+        constexpr std::size_t INITIAL_BUFFER = 4096;
+
+        /** The identifier of a "$var type size identifier name $end" line, empty for other lines.
+         */
+        std::string_view var_identifier(std::string_view line) {
+            if (line.rfind("$var ", 0) != 0) {
+                return {};
+            }
+            std::size_t at = 0;
+            for (int field = 0; field < 3; field++) {
+                at = line.find(' ', at);
+                if (at == std::string_view::npos) {
+                    return {};
+                }
+                at = line.find_first_not_of(' ', at);
+            }
+            const auto end = line.find(' ', at);
+            return (end == std::string_view::npos) ? std::string_view{} : line.substr(at, end - at);
+        }
+    }// namespace
+
+    fanout::fanout(void)
+        : _buffer(INITIAL_BUFFER) {
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+    }
+
+    void fanout::add_output(std::ostream &out, fanout_options options) {
+        output o{};
+        o.out = &out;
+        o.options = std::move(options);
+        _outputs.push_back(std::move(o));
+    }
+
+    trace_observer fanout::observer(void) {
+        trace_observer o;
+        o.on_header = [this](std::ostream &, const std::vector<std::string> &identifiers, const std::vector<std::string> &paths) {
+            on_header(identifiers, paths);
+        };
+        o.on_time = [this](std::ostream &, scope_fn::sequence_t time) { on_time(time); };
+        o.on_change = [this](const raw_change &change) { on_change(change.index); };
+        o.on_finalize = [this](std::ostream &) { on_finalize(); };
+        return o;
+    }
+
+    fanout::int_type fanout::overflow(int_type ch) {
+        const auto used = static_cast<std::size_t>(pptr() - pbase());
+        if (_mark > 0) {
+            // Only the line being formatted is kept.
+            std::memmove(_buffer.data(), _buffer.data() + _mark, used - _mark);
+        }
+        const auto kept = used - _mark;
+        _mark = 0;
+        if (kept == _buffer.size()) {
+            _buffer.resize(_buffer.size() * 2);
+        }
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+        pbump(static_cast<int>(kept));
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int fanout::sync(void) {
+        // Lines are routed as they are formatted, only the outputs need a flush.
+        if (_body) {
+            for (auto &o : _outputs) {
+                o.out->flush();
+            }
+        }
+        return 0;
+    }
+
+    void fanout::on_header(const std::vector<std::string> &identifiers, const std::vector<std::string> &paths) {
+        std::map<std::string_view, std::uint32_t> index;
+        for (std::size_t i = 0; i < identifiers.size(); i++) {
+            index.emplace(identifiers[i], static_cast<std::uint32_t>(i));
+        }
+        for (auto &o : _outputs) {
+            o.selected.resize(paths.size());
+            o.held.resize(paths.size());
+            for (std::size_t i = 0; i < paths.size(); i++) {
+                o.selected[i] = !o.options.filter || o.options.filter(paths[i]);
+            }
+        }
+        // Write the header to each output, with only the $var lines of it's variables.
+        const std::string_view header(pbase() + _mark, static_cast<std::size_t>(pptr() - pbase()) - _mark);
+        std::size_t at = 0;
+        while (at < header.size()) {
+            auto end = header.find('\n', at);
+            end = (end == std::string_view::npos) ? header.size() : end + 1;
+            const auto line = header.substr(at, end - at);
+            const auto identifier = var_identifier(line);
+            const auto var = identifier.empty() ? index.end() : index.find(identifier);
+            for (auto &o : _outputs) {
+                if ((var == index.end()) || o.selected[var->second]) {
+                    write(o, line);
+                }
+            }
+            at = end;
+        }
+        _bytes_in += header.size();
+        _body = true;
+        consume();
+    }
+
+    void fanout::on_time(scope_fn::sequence_t time) {
+        take_time_line();
+        consume();
+        _time_line = true;
+        _time = time;
+    }
+
+    void fanout::on_change(std::uint32_t index) {
+        take_time_line();
+        const std::string_view pending(pbase() + _mark, static_cast<std::size_t>(pptr() - pbase()) - _mark);
+        // The change is the last line, anything before it is from a variable that is not followed.
+        const auto start = (pending.size() < 2) ? std::string_view::npos : pending.rfind('\n', pending.size() - 2);
+        const auto line = (start == std::string_view::npos) ? pending : pending.substr(start + 1);
+        _bytes_in += line.size();
+        for (auto &o : _outputs) {
+            if ((index >= o.selected.size()) || !o.selected[index]) {
+                continue;
+            }
+            if (o.options.interval.count() == 0) {
+                write(o, line);
+            }
+            else {
+                auto &held = o.held[index];
+                if (held.empty()) {
+                    o.changed.push_back(index);
+                }
+                held.assign(line);
+            }
+        }
+        consume();
+    }
+
+    void fanout::on_finalize(void) {
+        take_time_line();
+        consume();
+        for (auto &o : _outputs) {
+            if (!o.open && !o.changed.empty()) {
+                // The state at the end of the trace.
+                write(o, "#" + std::to_string(_time) + "\n");
+            }
+            release_held(o);
+            o.open = false;
+            o.out->flush();
+        }
+    }
+
+    void fanout::take_time_line(void) {
+        if (!_time_line) {
+            return;
+        }
+        const std::string_view pending(pbase() + _mark, static_cast<std::size_t>(pptr() - pbase()) - _mark);
+        const auto end = pending.find('\n');
+        if (end == std::string_view::npos) {
+            return;
+        }
+        _time_line = false;
+        const auto line = pending.substr(0, end + 1);
+        _bytes_in += line.size();
+        _mark += line.size();
+        for (auto &o : _outputs) {
+            if (o.options.interval.count() == 0) {
+                write(o, line);
+                continue;
+            }
+            // The held changes are the state at the time point written before.
+            if (o.open) {
+                release_held(o);
+            }
+            o.open = !o.started || (_time >= o.next);
+            if (o.open) {
+                write(o, line);
+                o.started = true;
+                o.next = _time + static_cast<scope_fn::sequence_t>(o.options.interval.count());
+            }
+        }
+    }
+
+    void fanout::consume(void) {
+        _mark = 0;
+        setp(_buffer.data(), _buffer.data() + _buffer.size());
+    }
+
+    void fanout::write(output &o, std::string_view data) {
+        o.out->write(data.data(), static_cast<std::streamsize>(data.size()));
+        o.bytes += data.size();
+    }
+
+    void fanout::release_held(output &o) {
+        for (const auto index : o.changed) {
+            write(o, o.held[index]);
+            o.held[index].clear();
+        }
+        o.changed.clear();
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,138 @@
+/*
+ *  C++ VCD Tracer Library - Fan-out to Multiple Outputs
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_FANOUT_HPP
+#define VCD_FANOUT_HPP
+
+namespace vcd_tracer {
+
+    /** Options to control what is written to one output of a fanout.
+     */
+    struct fanout_options {
+        //! Select the variables to write by hierarchical path, empty for every variable.
+        std::function<bool(std::string_view path)> filter;
+        //! The shortest time between time points written, 0 for every time point.
+        top::time_base interval{ 0 };
+    };
+
+    /** A stream buffer that writes one trace to several outputs, each with it's own variables and rate.
+
+        @code
+        vcd_tracer::fanout fan;
+        fan.add_output(full_file);
+        fan.add_output(slow_file, { [](std::string_view path) { return path.rfind("top.bus.", 0) == 0; },
+                                    std::chrono::microseconds(10) });
+        std::ostream out(&fan);
+        dumper.add_observer(fan.observer());
+        dumper.finalize_header(out, std::chrono::system_clock::now());
+        @endcode
+
+        The design is elaborated once and changes are found and formatted
+        once. The observer tells the fanout which variable each formatted
+        line is for, and the same bytes are written to every output that
+        selects it. Each output gets a header with only the $var lines of
+        it's variables.
+
+        An output with an interval only writes a time point once the
+        interval has passed since the last one it wrote. It holds the last
+        change of each variable in between, and writes them at the next
+        time point it does write, so it shows the state at each of it's time
+        points.
+
+        A deferred header is not supported.
+        The outputs must outlive the fanout.
+     */
+    class fanout : public std::streambuf {
+      public:
+        fanout(void);
+        fanout(const fanout &) = delete;
+        fanout(fanout &&) = delete;
+        fanout &operator=(const fanout &) = delete;
+        fanout &operator=(fanout &&) = delete;
+        ~fanout(void) override = default;
+
+        /** Add an output, before the header is written.
+            @param out     The stream to write the output trace to.
+            @param options Controls what is written to it.
+        */
+        void add_output(std::ostream &out, fanout_options options = {});
+
+        /** The functions to add to the top scope with top::add_observer(),
+            to route the trace to the outputs.
+         */
+        trace_observer observer(void);
+
+        //! The number of bytes formatted by the tracer.
+        [[nodiscard]] std::uint64_t bytes_in(void) const { return _bytes_in; }
+        //! The number of bytes written to an output.
+        [[nodiscard]] std::uint64_t bytes_out(std::size_t n) const { return _outputs[n].bytes; }
+
+      protected:
+        int_type overflow(int_type ch) override;
+        int sync(void) override;
+
+      private:
+        struct output {
+            std::ostream *out;
+            fanout_options options;
+            // Set for each selected variable, by index.
+            std::vector<bool> selected;
+            // The last change of each variable since the last time point written, by index.
+            std::vector<std::string> held;
+            // The indexes with a held change, in order of change.
+            std::vector<std::uint32_t> changed;
+            // The next time a time point can be written.
+            scope_fn::sequence_t next{ 0 };
+            // Set if a time point has been written.
+            bool started{ false };
+            // Set if the changes being traced are for a time point written.
+            bool open{ false };
+            std::uint64_t bytes{ 0 };
+        };
+
+        void on_header(const std::vector<std::string> &identifiers, const std::vector<std::string> &paths);
+        void on_time(scope_fn::sequence_t time);
+        void on_change(std::uint32_t index);
+        void on_finalize(void);
+        // Route the time point at the mark, if one was written.
+        void take_time_line(void);
+        // Drop the routed bytes, so the buffer only holds the line being formatted.
+        void consume(void);
+        void write(output &o, std::string_view data);
+        void release_held(output &o);
+
+        std::vector<char> _buffer;
+        // The start of the bytes not yet routed.
+        std::size_t _mark{ 0 };
+        // Set when the next line in the buffer is a time point.
+        bool _time_line{ false };
+        scope_fn::sequence_t _time{ 0 };
+        bool _body{ false };
+        std::vector<output> _outputs;
+        std::uint64_t _bytes_in{ 0 };
+    };
+
+}// namespace vcd_tracer
+
+#endif
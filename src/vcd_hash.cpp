@@ -0,0 +1,126 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Window Hashes
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <map>
+
+#include "vcd_bytes.hpp"
+#include "vcd_hash.hpp"
+#include "vcd_index.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        //! FNV-1a of a string.
+        std::uint64_t hash_string(const std::string &s) {
+            std::uint64_t h = 0xcbf29ce484222325ULL;
+            for (const auto c : s) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 0x100000001b3ULL;
+            }
+            return h;
+        }
+    }// namespace
+
+    hash_writer::hash_writer(std::ostream &hash, hash_options options)
+        : _hash(hash), _options(options) {
+        _options.window = std::max<std::uint64_t>(1, _options.window);
+    }
+
+    trace_observer hash_writer::observer(void) {
+        trace_observer o;
+        o.on_header = [this](std::ostream &, const std::vector<std::string> &, const std::vector<std::string> &paths) {
+            on_header(paths);
+        };
+        o.on_time = [this](std::ostream &, scope_fn::sequence_t time) { on_time(time); };
+        o.on_change = [this](const raw_change &change) { on_change(change); };
+        o.on_finalize = [this](std::ostream &) { on_finalize(); };
+        return o;
+    }
+
+    void hash_writer::put_bytes(const char *data, std::size_t size) {
+        _hash.write(data, static_cast<std::streamsize>(size));
+    }
+
+    void hash_writer::put_u64(std::uint64_t v) {
+        const auto bytes = detail::le_u64(v);
+        put_bytes(bytes.data(), bytes.size());
+    }
+
+    void hash_writer::on_header(const std::vector<std::string> &paths) {
+        // Group by the declaring scope, with the groups in path order.
+        std::map<std::string, std::uint32_t> groups;
+        for (const auto &path : paths) {
+            const auto dot = path.find_last_of('.');
+            groups.emplace((dot == std::string::npos) ? std::string() : path.substr(0, dot), 0);
+        }
+        std::uint32_t n = 0;
+        for (auto &g : groups) {
+            g.second = n++;
+        }
+        _group.clear();
+        _key.clear();
+        for (const auto &path : paths) {
+            const auto dot = path.find_last_of('.');
+            _group.push_back(groups[(dot == std::string::npos) ? std::string() : path.substr(0, dot)]);
+            _key.push_back(hash_string(path));
+        }
+        _sums.assign(groups.size(), 0);
+
+        put_bytes(hash_format::header_magic.data(), hash_format::header_magic.size());
+        put_u64(_options.window);
+        put_u64(groups.size());
+        for (const auto &g : groups) {
+            const auto length = detail::le_u32(static_cast<std::uint32_t>(g.first.size()));
+            put_bytes(length.data(), length.size());
+            put_bytes(g.first.data(), g.first.size());
+        }
+    }
+
+    void hash_writer::flush_window(void) {
+        if (!_changed) {
+            return;
+        }
+        put_u64(_window);
+        for (auto &sum : _sums) {
+            put_u64(sum);
+            sum = 0;
+        }
+        _records++;
+        _changed = false;
+    }
+
+    void hash_writer::on_time(scope_fn::sequence_t time) {
+        const auto window = time / _options.window;
+        if (window != _window) {
+            flush_window();
+            _window = window;
+        }
+        _time = time;
+    }
+
+    void hash_writer::on_change(const raw_change &change) {
+        const auto value = index_format::encode_change(change);
+        const auto at = hash_format::mix(_key[change.index] ^ hash_format::mix(_time + (std::uint64_t{ value.state } << 62U)));
+        _sums[_group[change.index]] += hash_format::mix(at ^ value.bits);
+        _changed = true;
+    }
+
+    void hash_writer::on_finalize(void) {
+        flush_window();
+        put_u64(_records);
+        put_bytes(hash_format::footer_magic.data(), hash_format::footer_magic.size());
+        _hash.flush();
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,132 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Window Hashes
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_HASH_HPP
+#define VCD_HASH_HPP
+
+/**
+   Sidecar window hashes:
+
+   A hash file is written alongside a trace, so that two runs can be
+   compared without reading the traces. Time is split into fixed windows,
+   and the signals are grouped by the scope that declares them. For each
+   window with changes a record holds one hash per group, of the value
+   changes of the group's signals in that window.
+
+   - A change is hashed from the signal's hierarchical path, the time, the
+     state and the value, so the hashes do not depend on the identifiers.
+   - The change hashes of a window are summed, so the order of the changes
+     within a timestamp does not matter.
+   - A group without changes in a window has a hash of 0.
+
+   File layout, all integers are little endian:
+
+   - Header:  "VCDHASH1", u64 window length in timescale units, u64 group count,
+              then per group a u32 length and the scope path.
+   - Records: per window with changes, u64 window number (time / window length),
+              then a u64 hash per group, in header order.
+   - Footer:  u64 record count, "VCDHASHE".
+ */
+namespace vcd_tracer::hash_format {
+    //! Magic at the start of a hash file.
+    constexpr std::array<char, 8> header_magic{ 'V', 'C', 'D', 'H', 'A', 'S', 'H', '1' };
+    //! Magic at the end of a complete hash file.
+    constexpr std::array<char, 8> footer_magic{ 'V', 'C', 'D', 'H', 'A', 'S', 'H', 'E' };
+    //! Bytes in the footer.
+    constexpr std::size_t footer_size = 16;
+
+    //! A 64 bit finalizer, from MurmurHash3.
+    constexpr std::uint64_t mix(std::uint64_t v) {
+        v ^= v >> 33;
+        v *= 0xff51afd7ed558ccdULL;
+        v ^= v >> 33;
+        v *= 0xc4ceb9fe1a85ec53ULL;
+        v ^= v >> 33;
+        return v;
+    }
+}// namespace vcd_tracer::hash_format
+
+namespace vcd_tracer {
+
+    /** Options to control the hashes.
+     */
+    struct hash_options {
+        //! The window length, in timescale units.
+        std::uint64_t window{ 1000000 };
+    };
+
+    /** Write sidecar window hashes of a trace as it is written.
+
+        @code
+        std::ofstream hash("trace.vcd.hash", std::ios::binary);
+        vcd_tracer::hash_writer hashes(hash);
+        dumper.add_observer(hashes.observer());
+        @endcode
+
+        The cost per change is a few multiplies and an add, and a record is
+        written per window, so it can be left on. The hash writer must
+        outlive the tracing, the hashes are complete once
+        top::finalize_trace() has been called.
+     */
+    class hash_writer {
+      public:
+        /** @param hash    The hash output, opened in binary mode.
+            @param options Controls the window length.
+        */
+        explicit hash_writer(std::ostream &hash, hash_options options = {});
+        hash_writer(const hash_writer &) = delete;
+        hash_writer(hash_writer &&) = delete;
+        hash_writer &operator=(const hash_writer &) = delete;
+        hash_writer &operator=(hash_writer &&) = delete;
+        ~hash_writer(void) = default;
+
+        /** The functions to add to the top scope with top::add_observer().
+         */
+        trace_observer observer(void);
+
+        //! The number of records written.
+        [[nodiscard]] std::size_t record_count(void) const { return _records; }
+
+      private:
+        void on_header(const std::vector<std::string> &paths);
+        void on_time(scope_fn::sequence_t time);
+        void on_change(const raw_change &change);
+        void on_finalize(void);
+        void flush_window(void);
+        void put_u64(std::uint64_t v);
+        void put_bytes(const char *data, std::size_t size);
+
+        std::ostream &_hash;
+        hash_options _options;
+        // Per signal, the group and a hash of the path.
+        std::vector<std::uint32_t> _group;
+        std::vector<std::uint64_t> _key;
+        // The hash of each group in the current window.
+        std::vector<std::uint64_t> _sums;
+        scope_fn::sequence_t _time{ 0 };
+        std::uint64_t _window{ 0 };
+        bool _changed{ false };
+        std::size_t _records{ 0 };
+    };
+
+}// namespace vcd_tracer
+
+#endif
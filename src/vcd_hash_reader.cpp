@@ -0,0 +1,123 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Window Hash Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "vcd_bytes.hpp"
+#include "vcd_hash.hpp"
+#include "vcd_hash_reader.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+        using vcd_tracer::detail::get_u32;
+        using vcd_tracer::detail::get_u64;
+    }// namespace
+
+    trace_hashes::trace_hashes(mapped_file file)
+        : _file(std::move(file)),
+          _data(_file->data()) {
+        parse();
+    }
+
+    trace_hashes::trace_hashes(std::string_view data)
+        : _data(data) {
+        parse();
+    }
+
+    void trace_hashes::parse(void) {
+        const auto magic_size = hash_format::header_magic.size();
+        if ((_data.size() < (magic_size + 16 + hash_format::footer_size))
+            || (_data.substr(0, magic_size) != std::string_view(hash_format::header_magic.data(), magic_size))) {
+            throw parse_error("not trace hashes", 0);
+        }
+        const std::size_t footer = _data.size() - hash_format::footer_size;
+        if (_data.substr(footer + 8, magic_size) != std::string_view(hash_format::footer_magic.data(), magic_size)) {
+            throw parse_error("incomplete trace hashes", footer);
+        }
+        std::uint64_t pos = magic_size;
+        _window = get_u64(_data, pos);
+        const auto groups = get_u64(_data, pos + 8);
+        pos += 16;
+        for (std::uint64_t g = 0; g < groups; g++) {
+            if ((pos + 4) > footer) {
+                throw parse_error("truncated trace hashes groups", pos);
+            }
+            const auto length = get_u32(_data, pos);
+            pos += 4;
+            if ((pos + length) > footer) {
+                throw parse_error("truncated trace hashes groups", pos);
+            }
+            _groups.emplace_back(_data.substr(pos, length));
+            pos += length;
+        }
+        _records_offset = pos;
+        const auto count = get_u64(_data, footer);
+        const auto record_size = 8 * (1 + _groups.size());
+        if ((_window == 0) || (count != ((footer - pos) / record_size)) || (((footer - pos) % record_size) != 0)) {
+            throw parse_error("invalid trace hashes records", footer);
+        }
+        _record_count = static_cast<std::size_t>(count);
+    }
+
+    std::uint64_t trace_hashes::record_window(std::size_t n) const {
+        return get_u64(_data, _records_offset + (n * 8 * (1 + _groups.size())));
+    }
+
+    std::uint64_t trace_hashes::record_hash(std::size_t n, std::size_t group) const {
+        return get_u64(_data, _records_offset + (n * 8 * (1 + _groups.size())) + (8 * (1 + group)));
+    }
+
+    std::vector<hash_difference> compare_hashes(const trace_hashes &a, const trace_hashes &b) {
+        if (a.window() != b.window()) {
+            throw parse_error("the hash windows differ, " + std::to_string(a.window()) + " and " + std::to_string(b.window()), 0);
+        }
+        // The groups of both, in path order, with their place in each.
+        std::vector<std::string> groups(a.groups());
+        groups.insert(groups.end(), b.groups().begin(), b.groups().end());
+        std::sort(groups.begin(), groups.end());
+        groups.erase(std::unique(groups.begin(), groups.end()), groups.end());
+        const auto place = [&groups](const std::vector<std::string> &of) {
+            std::vector<std::size_t> at(groups.size(), npos);
+            for (std::size_t g = 0; g < of.size(); g++) {
+                at[static_cast<std::size_t>(std::lower_bound(groups.begin(), groups.end(), of[g]) - groups.begin())] = g;
+            }
+            return at;
+        };
+        const auto a_at = place(a.groups());
+        const auto b_at = place(b.groups());
+
+        std::vector<hash_difference> differences;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        constexpr auto never = std::numeric_limits<std::uint64_t>::max();
+        while ((i < a.record_count()) || (j < b.record_count())) {
+            const auto a_window = (i < a.record_count()) ? a.record_window(i) : never;
+            const auto b_window = (j < b.record_count()) ? b.record_window(j) : never;
+            const auto window = std::min(a_window, b_window);
+            for (std::size_t g = 0; g < groups.size(); g++) {
+                const auto a_hash = ((a_window == window) && (a_at[g] != npos)) ? a.record_hash(i, a_at[g]) : 0;
+                const auto b_hash = ((b_window == window) && (b_at[g] != npos)) ? b.record_hash(j, b_at[g]) : 0;
+                if (a_hash != b_hash) {
+                    differences.push_back({ window * a.window(), (window + 1) * a.window(), groups[g] });
+                }
+            }
+            i += (a_window == window) ? 1 : 0;
+            j += (b_window == window) ? 1 : 0;
+        }
+        return differences;
+    }
+
+}// namespace vcd_tracer::reader
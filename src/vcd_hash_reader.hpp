@@ -0,0 +1,86 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Window Hash Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vcd_reader.hpp"
+
+#ifndef VCD_HASH_READER_HPP
+#define VCD_HASH_READER_HPP
+
+namespace vcd_tracer::reader {
+
+    /** Sidecar window hashes written by vcd_tracer::hash_writer.
+     */
+    class trace_hashes {
+      public:
+        /** Read hashes from a mapped file.
+            @throw parse_error If the file is not complete window hashes.
+        */
+        explicit trace_hashes(mapped_file file);
+        /** Read hashes from a buffer, the buffer must outlive this object.
+            @throw parse_error If the data is not complete window hashes.
+        */
+        explicit trace_hashes(std::string_view data);
+        trace_hashes(trace_hashes &&) = default;
+        trace_hashes(const trace_hashes &) = delete;
+        trace_hashes &operator=(const trace_hashes &) = delete;
+
+        //! The window length, in timescale units.
+        [[nodiscard]] std::uint64_t window(void) const { return _window; }
+        //! The scope path of each group, in path order.
+        [[nodiscard]] const std::vector<std::string> &groups(void) const { return _groups; }
+        //! The number of windows with changes.
+        [[nodiscard]] std::size_t record_count(void) const { return _record_count; }
+        //! The window number of a record, windows are in increasing order.
+        [[nodiscard]] std::uint64_t record_window(std::size_t n) const;
+        //! The hash of a group in a record.
+        [[nodiscard]] std::uint64_t record_hash(std::size_t n, std::size_t group) const;
+
+      private:
+        void parse(void);
+        std::optional<mapped_file> _file;
+        std::string_view _data;
+        std::uint64_t _window{ 0 };
+        std::vector<std::string> _groups;
+        std::uint64_t _records_offset{ 0 };
+        std::size_t _record_count{ 0 };
+    };
+
+    /** A window in which the changes of a group of signals differ.
+     */
+    struct hash_difference {
+        //! The first time of the window.
+        std::uint64_t begin{ 0 };
+        //! The first time after the window.
+        std::uint64_t end{ 0 };
+        //! The scope path of the group.
+        std::string group;
+    };
+
+    /** Find the windows and groups whose hashes differ.
+        Groups are matched by scope path, a group in only one of them differs
+        in every window that it changes in.
+        @retval The differences, by window then group path. Empty if the traces are
+                the same, within the odds of a hash collision.
+        @throw parse_error If the window lengths differ.
+    */
+    [[nodiscard]] std::vector<hash_difference> compare_hashes(const trace_hashes &a, const trace_hashes &b);
+
+}// namespace vcd_tracer::reader
+
+#endif
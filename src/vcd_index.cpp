@@ -0,0 +1,121 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Timestamp Index
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "vcd_bytes.hpp"
+#include "vcd_index.hpp"
+
+namespace vcd_tracer {
+
+    index_writer::index_writer(std::ostream &index, index_options options)
+        : _index(index), _options(options) {
+        _options.entry_changes = std::max<std::uint64_t>(1, _options.entry_changes);
+    }
+
+    trace_observer index_writer::observer(void) {
+        trace_observer o;
+        o.on_header = [this](std::ostream &, const std::vector<std::string> &identifiers, const std::vector<std::string> &) {
+            on_header(identifiers);
+        };
+        o.on_time = [this](std::ostream &out, scope_fn::sequence_t time) { on_time(out, time); };
+        o.on_change = [this](const raw_change &change) { on_change(change); };
+        o.on_finalize = [this](std::ostream &) { on_finalize(); };
+        o.uses_offsets = true;
+        return o;
+    }
+
+    void index_writer::put_bytes(const char *data, std::size_t size) {
+        _index.write(data, static_cast<std::streamsize>(size));
+        _written += size;
+    }
+
+    void index_writer::put_u64(std::uint64_t v) {
+        const auto bytes = detail::le_u64(v);
+        put_bytes(bytes.data(), bytes.size());
+    }
+
+    void index_writer::on_header(const std::vector<std::string> &identifiers) {
+        put_bytes(index_format::header_magic.data(), index_format::header_magic.size());
+        put_u64(identifiers.size());
+        for (const auto &identifier : identifiers) {
+            const auto length = detail::le_u32(static_cast<std::uint32_t>(identifier.size()));
+            put_bytes(length.data(), length.size());
+            put_bytes(identifier.data(), identifier.size());
+        }
+        _values.assign(identifiers.size(), slot{});
+        // A checkpoint costs a slot per signal, so space them out by at
+        // least several changes per signal.
+        _checkpoint_interval = (_options.checkpoint_changes != 0)
+                                   ? _options.checkpoint_changes
+                                   : std::max<std::uint64_t>(16 * _options.entry_changes, 64 * identifiers.size());
+        _checkpoint_interval = std::max(_checkpoint_interval, _options.entry_changes);
+    }
+
+    void index_writer::on_time(std::ostream &out, scope_fn::sequence_t time) {
+        if (!_entries.empty() && (_changes_since_entry < _options.entry_changes)) {
+            return;
+        }
+        const auto pos = out.tellp();
+        if (pos < 0) {
+            throw std::runtime_error("vcd_tracer::index_writer: the trace output does not report it's position");
+        }
+        const auto offset = static_cast<std::uint64_t>(pos);
+        if (_entries.empty() || (_changes_since_checkpoint >= _checkpoint_interval)) {
+            // Values are the state before the changes at this time.
+            _checkpoint = _written;
+            if (_checkpoint_count == 0) {
+                _first_checkpoint = _checkpoint;
+            }
+            put_u64(time);
+            put_u64(offset);
+            for (const auto &v : _values) {
+                std::array<char, index_format::slot_size> buf{};
+                buf[0] = static_cast<char>(v.state);
+                buf[1] = static_cast<char>(v.is_real);
+                detail::store_le(buf.data() + 8, v.bits, 8);
+                put_bytes(buf.data(), buf.size());
+            }
+            _checkpoint_count++;
+            _changes_since_checkpoint = 0;
+        }
+        _entries.push_back(entry{ time, offset, _checkpoint });
+        _changes_since_entry = 0;
+    }
+
+    void index_writer::on_change(const raw_change &change) {
+        auto &v = _values[change.index];
+        const auto value = index_format::encode_change(change);
+        v.state = value.state;
+        v.is_real = change.is_real ? 1 : 0;
+        v.bits = value.bits;
+        _changes_since_entry++;
+        _changes_since_checkpoint++;
+    }
+
+    void index_writer::on_finalize(void) {
+        const auto entries_offset = _written;
+        for (const auto &e : _entries) {
+            put_u64(e.time);
+            put_u64(e.offset);
+            put_u64(e.checkpoint);
+        }
+        put_u64(entries_offset);
+        put_u64(_entries.size());
+        put_u64(_first_checkpoint);
+        put_bytes(index_format::footer_magic.data(), index_format::footer_magic.size());
+        _index.flush();
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,177 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Timestamp Index
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_INDEX_HPP
+#define VCD_INDEX_HPP
+
+/**
+   Sidecar index:
+
+   An index file is written alongside a trace, so that a reader can seek to
+   any time without scanning the trace from the start.
+
+   - Entries map sampled timestamps to the byte offset of the "#time" line in the trace.
+   - Checkpoints hold the value of every signal at the start of an entry.
+   - To find the values at time T, binary search the entries, load the
+     checkpoint of the entry and apply the value changes from the checkpoint
+     offset until T.
+
+   File layout, all integers are little endian:
+
+   - Header:     "VCDINDX1", u64 signal count, then per signal a u32 length and the identifier.
+   - Checkpoints: u64 time, u64 trace offset, then per signal (in header order) a
+                  16 byte slot: u8 state, u8 is_real, 6 bytes padding, u64 bits or double.
+   - Entries:    per entry u64 time, u64 trace offset, u64 index file offset of the checkpoint.
+   - Footer:     u64 entries offset, u64 entry count, u64 first checkpoint offset, "VCDINDXE".
+ */
+namespace vcd_tracer::index_format {
+    //! Magic at the start of an index file.
+    constexpr std::array<char, 8> header_magic{ 'V', 'C', 'D', 'I', 'N', 'D', 'X', '1' };
+    //! Magic at the end of a complete index file.
+    constexpr std::array<char, 8> footer_magic{ 'V', 'C', 'D', 'I', 'N', 'D', 'X', 'E' };
+    //! Bytes per signal in a checkpoint.
+    constexpr std::size_t slot_size = 16;
+    //! Bytes before the slots of a checkpoint.
+    constexpr std::size_t checkpoint_header_size = 16;
+    //! Bytes per entry.
+    constexpr std::size_t entry_size = 24;
+    //! Bytes in the footer.
+    constexpr std::size_t footer_size = 32;
+    //! Slot state of a value traced as 'x'.
+    constexpr std::uint8_t state_x = 0;
+    //! Slot state of a value traced as 'z'.
+    constexpr std::uint8_t state_z = 1;
+    //! Slot state of a known value.
+    constexpr std::uint8_t state_known = 2;
+    //! Slot state of a value that has not been traced yet.
+    constexpr std::uint8_t state_none = 3;
+
+    /** The state and bits of a traced value, as a slot holds them.
+     */
+    struct encoded_value {
+        //! One of state_x, state_z or state_known.
+        std::uint8_t state;
+        //! The integer value, or the bits of a real, 0 for an x or z value.
+        std::uint64_t bits;
+    };
+
+    /** Encode a value change as a checkpoint slot, the other sidecars use the same encoding.
+        Reals are traced as a number whatever their state, so they are always known.
+    */
+    inline encoded_value encode_change(const raw_change &change) {
+        if (change.is_real) {
+            encoded_value value{ state_known, 0 };
+            std::memcpy(&value.bits, &change.real, sizeof(value.bits));
+            return value;
+        }
+        if (change.state == value_state::known) {
+            return { state_known, change.bits };
+        }
+        return { (change.state == value_state::undriven_z) ? state_z : state_x, 0 };
+    }
+}// namespace vcd_tracer::index_format
+
+namespace vcd_tracer {
+
+    /** Options to control the size of an index.
+     */
+    struct index_options {
+        //! Add an entry at the first timestamp after this many value changes.
+        std::uint64_t entry_changes{ 4096 };
+        /** Add a checkpoint at the first entry after this many value changes.
+            With 0 the interval grows with the number of signals, so the index
+            stays small compared to the trace.
+        */
+        std::uint64_t checkpoint_changes{ 0 };
+    };
+
+    /** Write a sidecar index of a trace as it is written.
+
+        @code
+        std::ofstream vcd("trace.vcd");
+        std::ofstream idx("trace.vcd.idx", std::ios::binary);
+        vcd_tracer::index_writer index(idx);
+        dumper.add_observer(index.observer());
+        @endcode
+
+        The trace output must report it's position with tellp(). The index
+        writer must outlive the tracing, the index is complete once
+        top::finalize_trace() has been called.
+     */
+    class index_writer {
+      public:
+        /** @param index The index output, opened in binary mode.
+            @param options Controls the spacing of entries and checkpoints.
+        */
+        explicit index_writer(std::ostream &index, index_options options = {});
+        index_writer(const index_writer &) = delete;
+        index_writer(index_writer &&) = delete;
+        index_writer &operator=(const index_writer &) = delete;
+        index_writer &operator=(index_writer &&) = delete;
+        ~index_writer(void) = default;
+
+        /** The functions to add to the top scope with top::add_observer().
+         */
+        trace_observer observer(void);
+
+        //! The number of entries recorded.
+        [[nodiscard]] std::size_t entry_count(void) const { return _entries.size(); }
+        //! The number of checkpoints written.
+        [[nodiscard]] std::size_t checkpoint_count(void) const { return _checkpoint_count; }
+
+      private:
+        struct slot {
+            std::uint8_t state{ index_format::state_none };
+            std::uint8_t is_real{ 0 };
+            std::uint64_t bits{ 0 };
+        };
+        struct entry {
+            std::uint64_t time;
+            std::uint64_t offset;
+            std::uint64_t checkpoint;
+        };
+
+        void on_header(const std::vector<std::string> &identifiers);
+        void on_time(std::ostream &out, scope_fn::sequence_t time);
+        void on_change(const raw_change &change);
+        void on_finalize(void);
+        void put_u64(std::uint64_t v);
+        void put_bytes(const char *data, std::size_t size);
+
+        std::ostream &_index;
+        index_options _options;
+        // Bytes written to the index.
+        std::uint64_t _written{ 0 };
+        // The current value of every signal.
+        std::vector<slot> _values;
+        std::vector<entry> _entries;
+        std::uint64_t _checkpoint{ 0 };
+        std::uint64_t _first_checkpoint{ 0 };
+        std::size_t _checkpoint_count{ 0 };
+        std::uint64_t _changes_since_entry{ 0 };
+        std::uint64_t _changes_since_checkpoint{ 0 };
+        std::uint64_t _checkpoint_interval{ 0 };
+    };
+
+}// namespace vcd_tracer
+
+#endif
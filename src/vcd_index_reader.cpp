@@ -0,0 +1,227 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Index Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "vcd_bytes.hpp"
+#include "vcd_index.hpp"
+#include "vcd_index_reader.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+        using vcd_tracer::detail::get_u32;
+        using vcd_tracer::detail::get_u64;
+    }// namespace
+
+    std::string format_slot(const signal &sig, std::uint8_t state, bool is_real, std::uint64_t bits) {
+        if (is_real && (state != index_format::state_none)) {
+            double real = 0;
+            std::memcpy(&real, &bits, sizeof(real));
+            std::array<char, 32> buf;
+            ::snprintf(buf.data(), buf.size(), "r%.16g", real);
+            return buf.data();
+        }
+        const bool scalar = (sig.bit_size == 1);
+        if (state == index_format::state_none) {
+            return std::string();
+        }
+        if (state != index_format::state_known) {
+            const char *c = (state == index_format::state_z) ? "z" : "x";
+            return scalar ? std::string(c) : std::string("b") + c;
+        }
+        if (scalar) {
+            return (bits & 1) ? "1" : "0";
+        }
+        std::string text("b");
+        int msb = 63;
+        while ((msb > 0) && ((bits >> static_cast<unsigned int>(msb)) & 1) == 0) {
+            msb--;
+        }
+        // Format as value_base::dump() does, so a checkpoint matches the trace byte for byte.
+        // It drops leading 0s but keeps the one above the highest set bit, and keeps leading 1s
+        // as VCD extends a shorter vector with 0.
+        if ((bits != 0) && (static_cast<std::size_t>(msb) + 1 < sig.bit_size)) {
+            text += '0';
+        }
+        for (int i = msb; i >= 0; i--) {
+            text += ((bits >> static_cast<unsigned int>(i)) & 1) ? '1' : '0';
+        }
+        return text;
+    }
+
+    trace_index::trace_index(mapped_file file)
+        : _file(std::move(file)),
+          _data(_file->data()) {
+        parse();
+    }
+
+    trace_index::trace_index(std::string_view data)
+        : _data(data) {
+        parse();
+    }
+
+    void trace_index::parse(void) {
+        const auto magic_size = index_format::header_magic.size();
+        if ((_data.size() < (magic_size + 8 + index_format::footer_size))
+            || (_data.substr(0, magic_size) != std::string_view(index_format::header_magic.data(), magic_size))) {
+            throw parse_error("not a trace index", 0);
+        }
+        const std::size_t footer = _data.size() - index_format::footer_size;
+        if (_data.substr(footer + 24, magic_size) != std::string_view(index_format::footer_magic.data(), magic_size)) {
+            throw parse_error("incomplete trace index", footer);
+        }
+        _entries_offset = get_u64(_data, footer);
+        const auto count = get_u64(_data, footer + 8);
+        if ((_entries_offset > footer) || (count > ((footer - _entries_offset) / index_format::entry_size))) {
+            throw parse_error("invalid trace index entries", footer);
+        }
+        _entry_count = static_cast<std::size_t>(count);
+
+        std::uint64_t pos = magic_size;
+        const auto signals = get_u64(_data, pos);
+        pos += 8;
+        for (std::uint64_t s = 0; s < signals; s++) {
+            if ((pos + 4) > footer) {
+                throw parse_error("truncated trace index identifiers", pos);
+            }
+            const auto length = get_u32(_data, pos);
+            pos += 4;
+            if ((pos + length) > footer) {
+                throw parse_error("truncated trace index identifiers", pos);
+            }
+            _identifiers.emplace_back(_data.substr(pos, length));
+            _slots.emplace(_identifiers.back(), _identifiers.size() - 1);
+            pos += length;
+        }
+    }
+
+    index_entry trace_index::entry(std::size_t n) const {
+        const auto offset = _entries_offset + (n * index_format::entry_size);
+        return index_entry{ get_u64(_data, offset), get_u64(_data, offset + 8), get_u64(_data, offset + 16) };
+    }
+
+    std::size_t trace_index::find(std::uint64_t time) const {
+        // First entry after time.
+        std::size_t lo = 0;
+        std::size_t hi = _entry_count;
+        while (lo < hi) {
+            const std::size_t mid = lo + ((hi - lo) / 2);
+            if (get_u64(_data, _entries_offset + (mid * index_format::entry_size)) <= time) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        return (lo == 0) ? npos : (lo - 1);
+    }
+
+    std::uint64_t trace_index::checkpoint_offset(std::uint64_t offset) const {
+        if ((offset > _entries_offset) || (index_format::checkpoint_header_size > (_entries_offset - offset))) {
+            throw parse_error("checkpoint out of range", offset);
+        }
+        return get_u64(_data, offset + 8);
+    }
+
+    checkpoint trace_index::read_checkpoint(std::uint64_t offset, const header &hdr) const {
+        const auto size = index_format::checkpoint_header_size + (_identifiers.size() * index_format::slot_size);
+        if ((offset > _entries_offset) || (size > (_entries_offset - offset))) {
+            throw parse_error("checkpoint out of range", offset);
+        }
+        checkpoint cp;
+        cp.time = get_u64(_data, offset);
+        cp.offset = get_u64(_data, offset + 8);
+        cp.values.resize(hdr.signals.size());
+        auto slot = offset + index_format::checkpoint_header_size;
+        for (const auto &identifier : _identifiers) {
+            const auto signal = hdr.find_signal(identifier);
+            if (signal == npos) {
+                throw parse_error("index identifier '" + identifier + "' is not in the trace", slot);
+            }
+            cp.values[signal] = format_slot(hdr.signals[signal],
+                                            static_cast<std::uint8_t>(_data[slot]),
+                                            _data[slot + 1] != 0,
+                                            get_u64(_data, slot + 8));
+            slot += index_format::slot_size;
+        }
+        return cp;
+    }
+
+    checkpoint trace_index::read_checkpoint(std::uint64_t offset,
+                                            const header &hdr,
+                                            const std::vector<std::size_t> &signals) const {
+        const auto size = index_format::checkpoint_header_size + (_identifiers.size() * index_format::slot_size);
+        if ((offset > _entries_offset) || (size > (_entries_offset - offset))) {
+            throw parse_error("checkpoint out of range", offset);
+        }
+        checkpoint cp;
+        cp.time = get_u64(_data, offset);
+        cp.offset = get_u64(_data, offset + 8);
+        cp.values.resize(signals.size());
+        for (std::size_t i = 0; i < signals.size(); i++) {
+            const auto &sig = hdr.signals.at(signals[i]);
+            const auto n = find_identifier(sig.identifier);
+            if (n != npos) {
+                const auto slot = offset + index_format::checkpoint_header_size + (n * index_format::slot_size);
+                cp.values[i] = format_slot(sig,
+                                           static_cast<std::uint8_t>(_data[slot]),
+                                           _data[slot + 1] != 0,
+                                           get_u64(_data, slot + 8));
+            }
+        }
+        return cp;
+    }
+
+    std::size_t trace_index::find_identifier(std::string_view identifier) const {
+        const auto it = _slots.find(std::string(identifier));
+        return (it == _slots.end()) ? npos : it->second;
+    }
+
+    checkpoint seek(const trace &t, const trace_index &index, std::uint64_t time) {
+        return seek(t, &index, time);
+    }
+
+    checkpoint seek(const trace &t, const trace_index *index, std::uint64_t time) {
+        const auto &hdr = t.get_header();
+        const auto data = t.data();
+        checkpoint cp;
+        if ((index == nullptr) || (index->entry_count() == 0)) {
+            // Nothing indexed, read from the start.
+            cp.values.resize(hdr.signals.size());
+            cp.offset = hdr.body_offset;
+        }
+        else {
+            const auto e = index->find(time);
+            cp = index->read_checkpoint(index->entry((e == npos) ? 0 : e).checkpoint, hdr);
+        }
+        if (cp.offset > data.size()) {
+            throw parse_error("index offset is beyond the end of the trace", data.size());
+        }
+        change_cursor cursor(hdr, data.data() + cp.offset, data.data() + data.size(), cp.time, data.data());
+        value_change change;
+        const char *before = cursor.position();
+        while (cursor.next(change) && (change.time <= time)) {
+            cp.values[change.signal] = std::string(change.value);
+            before = cursor.position();
+        }
+        // Only the timestamps after the last change applied are read again.
+        cp.offset = find_time(t, time, static_cast<std::size_t>(before - data.data()));
+        cp.time = time;
+        return cp;
+    }
+
+}// namespace vcd_tracer::reader
@@ -0,0 +1,146 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Index Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "vcd_reader.hpp"
+
+#ifndef VCD_INDEX_READER_HPP
+#define VCD_INDEX_READER_HPP
+
+namespace vcd_tracer::reader {
+
+    /** An entry of a sidecar index, see vcd_index.hpp.
+     */
+    struct index_entry {
+        //! The timestamp.
+        std::uint64_t time{ 0 };
+        //! Byte offset of the "#time" line in the trace.
+        std::uint64_t offset{ 0 };
+        //! Index file offset of the checkpoint to start from.
+        std::uint64_t checkpoint{ 0 };
+    };
+
+    /** The value of every signal at a point in a trace.
+     */
+    struct checkpoint {
+        //! The time of the values.
+        std::uint64_t time{ 0 };
+        //! Byte offset into the trace of the changes that follow the values.
+        std::uint64_t offset{ 0 };
+        //! The value of each signal, indexed as header::signals, formatted as a VCD value such as "b101".
+        //! The value is empty before the first change of a signal.
+        std::vector<std::string> values;
+    };
+
+    /** A sidecar index written by vcd_tracer::index_writer.
+     */
+    class trace_index {
+      public:
+        /** Read an index from a mapped file.
+            @throw parse_error If the file is not a complete index.
+        */
+        explicit trace_index(mapped_file file);
+        /** Read an index from a buffer, the buffer must outlive this object.
+            @throw parse_error If the data is not a complete index.
+        */
+        explicit trace_index(std::string_view data);
+        trace_index(trace_index &&) = default;
+        trace_index(const trace_index &) = delete;
+        trace_index &operator=(const trace_index &) = delete;
+
+        //! The identifiers of the indexed signals, in checkpoint order.
+        [[nodiscard]] const std::vector<std::string> &identifiers(void) const { return _identifiers; }
+        //! The number of entries.
+        [[nodiscard]] std::size_t entry_count(void) const { return _entry_count; }
+        //! Read an entry.
+        [[nodiscard]] index_entry entry(std::size_t n) const;
+
+        /** Find the last entry at or before a time, with a binary search.
+            @retval npos If the time is before the first entry.
+        */
+        [[nodiscard]] std::size_t find(std::uint64_t time) const;
+
+        /** Read where the changes after a checkpoint start, without reading any values.
+            @param offset The index file offset, from index_entry::checkpoint.
+            @retval The byte offset into the trace, as checkpoint::offset.
+            @throw parse_error If the checkpoint is out of range.
+        */
+        [[nodiscard]] std::uint64_t checkpoint_offset(std::uint64_t offset) const;
+
+        /** Read a checkpoint.
+            @param offset The index file offset, from index_entry::checkpoint.
+            @param hdr    The header of the indexed trace.
+            @throw parse_error If the checkpoint is out of range or an identifier is not in the header.
+        */
+        [[nodiscard]] checkpoint read_checkpoint(std::uint64_t offset, const header &hdr) const;
+
+        /** Read some of the values of a checkpoint, only the slots of these signals are read.
+            @param offset  The index file offset, from index_entry::checkpoint.
+            @param hdr     The header of the indexed trace.
+            @param signals Index of the signals to read, in header::signals.
+            @retval The checkpoint, with the values in the order of signals.
+                    A signal that is not in the index has an empty value.
+            @throw parse_error If the checkpoint is out of range.
+        */
+        [[nodiscard]] checkpoint read_checkpoint(std::uint64_t offset,
+                                                 const header &hdr,
+                                                 const std::vector<std::size_t> &signals) const;
+
+        /** Find the checkpoint slot of an identifier.
+            @retval npos If the identifier is not indexed.
+        */
+        [[nodiscard]] std::size_t find_identifier(std::string_view identifier) const;
+
+      private:
+        void parse(void);
+        std::optional<mapped_file> _file;
+        std::string_view _data;
+        std::vector<std::string> _identifiers;
+        std::unordered_map<std::string, std::size_t> _slots;
+        std::uint64_t _entries_offset{ 0 };
+        std::size_t _entry_count{ 0 };
+    };
+
+    /** Format a checkpoint slot as it would be traced, see vcd_index.hpp.
+        @param sig     The signal of the slot.
+        @param state   The slot state, such as index_format::state_known.
+        @param is_real Set if the slot holds a double.
+        @param bits    The slot value.
+        @retval The value, such as "b101", or empty for index_format::state_none.
+    */
+    [[nodiscard]] std::string format_slot(const signal &sig, std::uint8_t state, bool is_real, std::uint64_t bits);
+
+    /** Find the value of every signal at a time, without reading the trace from the start.
+        The values include the changes at the time. The checkpoint at or before
+        the time is loaded and the changes from there are applied.
+        @param t     The trace.
+        @param index The index of the trace.
+        @param time  The time to seek to.
+        @retval The values, the offset is that of the first timestamp after time, or the end of the trace.
+    */
+    [[nodiscard]] checkpoint seek(const trace &t, const trace_index &index, std::uint64_t time);
+
+    /** Find the value of every signal at a time, reading from the start when there is no index.
+        @param index The index of the trace, or nullptr.
+    */
+    [[nodiscard]] checkpoint seek(const trace &t, const trace_index *index, std::uint64_t time);
+
+}// namespace vcd_tracer::reader
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ *  C++ VCD Tracer Library - Trace Merging
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+#include "vcd_merge.hpp"
+#include "vcd_tracer.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+
+        /** Format a timescale, which must be 1, 10 or 100 of a unit.
+         */
+        std::string format_timescale(std::uint64_t fs) {
+            constexpr std::array<const char *, 6> units{ "fs", "ps", "ns", "us", "ms", "s" };
+            std::size_t unit = 0;
+            while (((fs % 1000) == 0) && (unit < (units.size() - 1))) {
+                fs /= 1000;
+                unit++;
+            }
+            return std::to_string(fs) + units[unit];
+        }
+
+        /** One of the merged traces.
+         */
+        struct source {
+            const trace *t;
+            std::uint64_t scale;
+            std::vector<std::string> identifiers;
+            change_cursor cursor;
+            value_change change;
+            bool more;
+        };
+
+        void write_scope(std::ostream &out, const header &hdr, std::size_t s, const std::vector<std::string> &identifiers) {
+            const auto &sc = hdr.scopes[s];
+            out << "$scope " << sc.type << " " << sc.name << " $end\n";
+            for (const auto v : sc.vars) {
+                const auto &var = hdr.vars[v];
+                out << "$var " << var.type << " " << hdr.signals[var.signal].bit_size << " "
+                    << identifiers[var.signal] << " " << var.name << " $end\n";
+            }
+            for (const auto child : sc.children) {
+                write_scope(out, hdr, child, identifiers);
+            }
+            out << "$upscope $end\n";
+        }
+
+    }// namespace
+
+    std::uint64_t merge(const std::vector<merge_input> &inputs, std::ostream &out) {
+        // The common timescale.
+        std::uint64_t fs = 0;
+        for (const auto &input : inputs) {
+            fs = std::gcd(fs, timescale_fs(input.source->get_header().timescale));
+        }
+
+        // Reassign identifiers and start reading.
+        identifier_generator identifiers;
+        std::vector<source> sources;
+        sources.reserve(inputs.size());
+        for (const auto &input : inputs) {
+            const auto &hdr = input.source->get_header();
+            const auto body = input.source->body();
+            std::vector<std::string> ids;
+            ids.reserve(hdr.signals.size());
+            for (std::size_t s = 0; s < hdr.signals.size(); s++) {
+                ids.emplace_back(identifiers.next());
+            }
+            sources.push_back(source{ input.source,
+                                      timescale_fs(hdr.timescale) / fs,
+                                      std::move(ids),
+                                      change_cursor(hdr, body.data(), body.data() + body.size(), 0, input.source->data().data()),
+                                      value_change{},
+                                      false });
+        }
+
+        // Definitions
+        out << "$date\n   " << (inputs.empty() ? std::string() : inputs.front().source->get_header().date) << "\n$end\n"
+            << "$version\n   C++ Simple VCD Logger merge\n$end\n"
+            << "$timescale\n   " << format_timescale((fs == 0) ? 1 : fs) << "\n$end\n";
+        for (std::size_t i = 0; i < inputs.size(); i++) {
+            const auto &hdr = inputs[i].source->get_header();
+            out << "$scope module " << inputs[i].scope << " $end\n";
+            for (std::size_t s = 0; s < hdr.scopes.size(); s++) {
+                if (hdr.scopes[s].parent == npos) {
+                    write_scope(out, hdr, s, sources[i].identifiers);
+                }
+            }
+            // Variables outside of any scope.
+            for (std::size_t v = 0; v < hdr.vars.size(); v++) {
+                if (hdr.vars[v].scope == npos) {
+                    const auto &var = hdr.vars[v];
+                    out << "$var " << var.type << " " << hdr.signals[var.signal].bit_size << " "
+                        << sources[i].identifiers[var.signal] << " " << var.name << " $end\n";
+                }
+            }
+            out << "$upscope $end\n";
+        }
+        out << "$enddefinitions $end\n";
+
+        // K-way merge on the time of the next change of each source.
+        using pending = std::pair<std::uint64_t, std::size_t>;
+        std::priority_queue<pending, std::vector<pending>, std::greater<>> queue;
+        for (std::size_t i = 0; i < sources.size(); i++) {
+            auto &src = sources[i];
+            src.more = src.cursor.next(src.change);
+            if (src.more) {
+                queue.emplace(src.change.time * src.scale, i);
+            }
+        }
+        std::uint64_t changes = 0;
+        std::uint64_t time = 0;
+        bool first = true;
+        while (!queue.empty()) {
+            const auto [next_time, i] = queue.top();
+            queue.pop();
+            if (first || (next_time != time)) {
+                time = next_time;
+                first = false;
+                out << "#" << time << "\n";
+            }
+            // Every change of this source at this time.
+            auto &src = sources[i];
+            while (src.more && ((src.change.time * src.scale) == time)) {
+                write_change(out, src.change.value, src.identifiers[src.change.signal]);
+                changes++;
+                src.more = src.cursor.next(src.change);
+            }
+            if (src.more) {
+                queue.emplace(src.change.time * src.scale, i);
+            }
+        }
+        // Keep the final timestamp, such as the one written by top::finalize_trace().
+        std::uint64_t last = time;
+        for (const auto &src : sources) {
+            last = std::max(last, src.cursor.time() * src.scale);
+        }
+        if (last != time) {
+            out << "#" << last << "\n";
+        }
+        return changes;
+    }
+
+}// namespace vcd_tracer::reader
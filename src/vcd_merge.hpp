@@ -0,0 +1,54 @@
+/*
+ *  C++ VCD Tracer Library - Trace Merging
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "vcd_reader.hpp"
+
+#ifndef VCD_MERGE_HPP
+#define VCD_MERGE_HPP
+
+namespace vcd_tracer::reader {
+
+    /** A trace to be merged.
+     */
+    struct merge_input {
+        //! The trace, it must outlive the merge.
+        const trace *source{ nullptr };
+        //! The scope the hierarchy of the trace is nested in.
+        std::string scope;
+    };
+
+    /** Combine several traces into one.
+
+        - The hierarchy of each trace is nested in a scope of it's own.
+        - Identifiers are reassigned, so they are unique in the merged trace.
+        - The timescale is the finest that every trace timescale is a multiple of.
+        - The value changes are merged by time in a single pass, reading each
+          trace in order. Memory use does not depend on the trace lengths.
+
+        Changes at the same time are written in the order of the inputs.
+
+        @param inputs The traces to merge.
+        @param out    The merged trace.
+        @retval The number of value changes written.
+        @throw parse_error If a trace is malformed.
+    */
+    std::uint64_t merge(const std::vector<merge_input> &inputs, std::ostream &out);
+
+}// namespace vcd_tracer::reader
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ *  C++ VCD Tracer Library - Memory Mapped File Sink
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vcd_bytes.hpp"
+#include "vcd_mmap_sink.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        using detail::throw_errno;
+    }// namespace
+
+    mmap_sink::mmap_sink(const std::string &path, mmap_sink_options options)
+        : _options(options) {
+        const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        _options.window_size = ((std::max(_options.window_size, page) + page - 1) / page) * page;
+        _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (_fd < 0) {
+            throw_errno("mmap_sink open");
+        }
+        try {
+            map_window(0);
+        }
+        catch (const std::system_error &) {
+            ::close(_fd);
+            throw;
+        }
+    }
+
+    mmap_sink::~mmap_sink(void) {
+        try {
+            close();
+        }
+        catch (const std::system_error &) {
+            // Call close() to see errors.
+        }
+        if (_window != nullptr) {
+            ::munmap(_window, _options.window_size);
+        }
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+    }
+
+    trace_observer mmap_sink::observer(void) {
+        trace_observer o;
+        o.on_finalize = [this](std::ostream &) { close(); };
+        return o;
+    }
+
+    void mmap_sink::close(void) {
+        if (_fd < 0) {
+            return;
+        }
+        const auto end = _offset + static_cast<std::uint64_t>(pptr() - pbase());
+        retire_window();
+        _offset = end;
+        if (::ftruncate(_fd, static_cast<off_t>(end)) != 0) {
+            throw_errno("mmap_sink ftruncate");
+        }
+        if (::close(std::exchange(_fd, -1)) != 0) {
+            throw_errno("mmap_sink close");
+        }
+    }
+
+    mmap_sink::int_type mmap_sink::overflow(int_type ch) {
+        if (_fd < 0) {
+            return traits_type::eof();
+        }
+        retire_window();
+        map_window(_offset + _options.window_size);
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int mmap_sink::sync(void) {
+        // The window is the page cache, a flush only has to write it back if asked to.
+        if ((_window != nullptr) && (_options.writeback == mmap_writeback::sync)) {
+            const auto used = static_cast<std::size_t>(pptr() - pbase());
+            if ((used > 0) && (::msync(_window, used, MS_SYNC) != 0)) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    mmap_sink::pos_type mmap_sink::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+        // Only tellp() is supported, for the sidecar writers.
+        if ((off != 0) || (dir != std::ios_base::cur) || ((which & std::ios_base::out) == 0)) {
+            return pos_type(off_type(-1));
+        }
+        return pos_type(static_cast<off_type>(_offset) + (pptr() - pbase()));
+    }
+
+    void mmap_sink::map_window(std::uint64_t offset) {
+        const auto size = static_cast<off_t>(_options.window_size);
+        const int error = ::posix_fallocate(_fd, static_cast<off_t>(offset), size);
+        if (error != 0) {
+            // Not every file system can allocate ahead, a sparse extension is the best there is.
+            if ((error != EOPNOTSUPP) && (error != EINVAL)) {
+                throw std::system_error(error, std::system_category(), "mmap_sink fallocate");
+            }
+            if (::ftruncate(_fd, static_cast<off_t>(offset) + size) != 0) {
+                throw_errno("mmap_sink ftruncate");
+            }
+        }
+        void *window = ::mmap(nullptr, _options.window_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, static_cast<off_t>(offset));
+        if (window == MAP_FAILED) {
+            throw_errno("mmap_sink mmap");
+        }
+        ::madvise(window, _options.window_size, MADV_SEQUENTIAL);
+        _window = static_cast<char *>(window);
+        _offset = offset;
+        _windows++;
+        setp(_window, _window + _options.window_size);
+    }
+
+    void mmap_sink::retire_window(void) {
+        if (_window == nullptr) {
+            return;
+        }
+        const auto offset = static_cast<off_t>(_offset);
+        const auto size = static_cast<off_t>(_options.window_size);
+        const auto used = static_cast<std::size_t>(pptr() - pbase());
+        if ((_options.writeback == mmap_writeback::sync) && (used > 0) && (::msync(_window, used, MS_SYNC) != 0)) {
+            throw_errno("mmap_sink msync");
+        }
+        ::munmap(std::exchange(_window, nullptr), _options.window_size);
+        setp(nullptr, nullptr);
+        if (_options.writeback == mmap_writeback::async) {
+            // MS_ASYNC does not start write back on Linux, this does.
+            ::sync_file_range(_fd, offset, size, SYNC_FILE_RANGE_WRITE);
+        }
+        if (_options.drop_behind && (offset >= size)) {
+            // The window before has had a whole window of time to be written back.
+            ::sync_file_range(_fd, offset - size, size, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            ::posix_fadvise(_fd, offset - size, size, POSIX_FADV_DONTNEED);
+        }
+    }
+
+}// namespace vcd_tracer
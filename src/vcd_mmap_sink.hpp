@@ -0,0 +1,112 @@
+/*
+ *  C++ VCD Tracer Library - Memory Mapped File Sink
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_MMAP_SINK_HPP
+#define VCD_MMAP_SINK_HPP
+
+namespace vcd_tracer {
+
+    /** What to do with a window of the file once it is full.
+     */
+    enum class mmap_writeback {
+        //! Leave it to the kernel to write back.
+        none,
+        //! Start writing it back, without waiting.
+        async,
+        //! Write it back with msync() before moving on.
+        sync
+    };
+
+    /** Options to control the windows of a mmap_sink.
+     */
+    struct mmap_sink_options {
+        //! Bytes per mapped window, rounded up to a whole number of pages.
+        std::size_t window_size{ 16 * 1024 * 1024 };
+        //! What to do with a full window.
+        mmap_writeback writeback{ mmap_writeback::async };
+        //! Drop the window before the last full one from the page cache, for traces larger than memory.
+        bool drop_behind{ false };
+    };
+
+    /** A stream buffer that formats a trace straight into a memory mapped file.
+
+        @code
+        vcd_tracer::mmap_sink sink("trace.vcd");
+        std::ostream out(&sink);
+        dumper.add_observer(sink.observer());
+        dumper.finalize_header(out, std::chrono::system_clock::now());
+        ...
+        dumper.finalize_trace(out);
+        @endcode
+
+        The file is extended a window at a time with fallocate(), so running
+        out of space is an error when the window is mapped rather than a
+        SIGBUS when it is written. The stream buffer is the mapped window, so
+        there is no system call or copy until the window is full.
+
+        The file is truncated to the traced length by close(), which the
+        observer calls when the trace is finalized. Until then a reader sees
+        zeros after the last traced byte. Errors throw std::system_error,
+        which the std::ostream turns into badbit.
+     */
+    class mmap_sink : public std::streambuf {
+      public:
+        /** @param path    The file to create or truncate.
+            @param options Controls the windows.
+        */
+        explicit mmap_sink(const std::string &path, mmap_sink_options options = {});
+        mmap_sink(const mmap_sink &) = delete;
+        mmap_sink(mmap_sink &&) = delete;
+        mmap_sink &operator=(const mmap_sink &) = delete;
+        mmap_sink &operator=(mmap_sink &&) = delete;
+        ~mmap_sink(void) override;
+
+        /** The functions to add to the top scope with top::add_observer(),
+            to close the file when the trace is finalized.
+         */
+        trace_observer observer(void);
+
+        /** Unmap the window, truncate the file to the traced length and close it.
+         */
+        void close(void);
+
+        //! The number of windows mapped.
+        [[nodiscard]] std::uint64_t window_count(void) const { return _windows; }
+
+      protected:
+        int_type overflow(int_type ch) override;
+        int sync(void) override;
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+      private:
+        void map_window(std::uint64_t offset);
+        void retire_window(void);
+
+        int _fd{ -1 };
+        mmap_sink_options _options;
+        char *_window{ nullptr };
+        // The file offset of the window.
+        std::uint64_t _offset{ 0 };
+        std::uint64_t _windows{ 0 };
+    };
+
+}// namespace vcd_tracer
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ *  C++ VCD Tracer Library - Reader Thread Pool
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef VCD_PARALLEL_HPP
+#define VCD_PARALLEL_HPP
+
+// Internal to the reader library.
+namespace vcd_tracer::reader::detail {
+
+    /** Run a function over a range of work items on a number of threads.
+        The first exception thrown by a worker is rethrown.
+    */
+    template<typename F>
+    void parallel_for(std::size_t count, unsigned int threads, F &&fn) {
+        std::atomic<std::size_t> next{ 0 };
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto worker = [&](void) {
+            try {
+                for (std::size_t i = next++; i < count; i = next++) {
+                    fn(i);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                // Stop the other workers.
+                next = count;
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned int t = 1; t < threads; t++) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : pool) {
+            thread.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    /** Choose a number of threads.
+        @param threads The requested number, 0 for the hardware concurrency.
+    */
+    inline unsigned int thread_count(unsigned int threads) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        return (threads == 0) ? 1 : threads;
+    }
+
+}// namespace vcd_tracer::reader::detail
+
+#endif
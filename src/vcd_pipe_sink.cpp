@@ -0,0 +1,304 @@
+/*
+ *  C++ VCD Tracer Library - Pipe and Socket Sink
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <system_error>
+
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "vcd_bytes.hpp"
+#include "vcd_pipe_sink.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        using detail::throw_errno;
+
+        // Errors meaning vmsplice() or splice() is not supported for the descriptor.
+        bool unsupported(int error) {
+            return (error == EINVAL) || (error == ENOSYS) || (error == EOPNOTSUPP);
+        }
+    }// namespace
+
+    pipe_sink::pipe_sink(int fd, pipe_sink_options options)
+        : _fd(fd), _options(options), _page(static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))) {
+        _options.buffer_size = ((std::max(_options.buffer_size, _page) + _page - 1) / _page) * _page;
+        _options.buffers = std::max<std::size_t>(2, _options.buffers);
+
+        struct stat st {};
+        if (::fstat(_fd, &st) != 0) {
+            throw_errno("pipe_sink fstat");
+        }
+        if (S_ISFIFO(st.st_mode)) {
+            _target = target::pipe;
+        }
+        else if (S_ISSOCK(st.st_mode)) {
+            _target = target::socket;
+        }
+        // vmsplice() only takes non blocking from its flags.
+        const int flags = ::fcntl(_fd, F_GETFL);
+        if ((flags >= 0) && ((static_cast<unsigned int>(flags) & O_NONBLOCK) != 0)) {
+            _splice_flags = SPLICE_F_NONBLOCK;
+        }
+        if (_options.zero_copy && (_target != target::file)) {
+            // Splicing is only safe while the queued bytes can be read back.
+            int count = 0;
+            _zero_copy = (::ioctl(_fd, (_target == target::pipe) ? FIONREAD : SIOCOUTQ, &count) == 0);
+        }
+        if (_zero_copy && (_target == target::socket)) {
+            if (::pipe2(_relay, O_CLOEXEC | O_NONBLOCK) == 0) {
+                ::fcntl(_relay[1], F_SETPIPE_SZ, static_cast<int>(_options.buffer_size));
+                const int size = ::fcntl(_relay[1], F_GETPIPE_SZ);
+                _relay_size = (size > 0) ? static_cast<std::size_t>(size) : 0;
+            }
+            _zero_copy = (_relay_size >= _page);
+        }
+
+        // Mapped rather than allocated, so the pages are never handed to anything else
+        // while the kernel still refers to them.
+        const std::size_t total = _options.buffer_size * _options.buffers;
+        void *pages = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pages == MAP_FAILED) {
+            const int error = errno;
+            for (const int relay : _relay) {
+                if (relay >= 0) {
+                    ::close(relay);
+                }
+            }
+            throw std::system_error(error, std::system_category(), "pipe_sink mmap");
+        }
+        for (std::size_t i = 0; i < _options.buffers; i++) {
+            _buffers.push_back({ static_cast<char *>(pages) + (i * _options.buffer_size), 0 });
+        }
+        setp(_buffers[0].data, _buffers[0].data + _options.buffer_size);
+    }
+
+    pipe_sink::~pipe_sink(void) {
+        try {
+            flush_buffer();
+        }
+        catch (const std::system_error &) {
+            // The stream reported any error when it was flushed.
+        }
+        ::munmap(_buffers[0].data, _options.buffer_size * _options.buffers);
+        for (const int relay : _relay) {
+            if (relay >= 0) {
+                ::close(relay);
+            }
+        }
+    }
+
+    pipe_sink::int_type pipe_sink::overflow(int_type ch) {
+        flush_buffer();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int pipe_sink::sync(void) {
+        flush_buffer();
+        return 0;
+    }
+
+    pipe_sink::pos_type pipe_sink::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+        // Only tellp() is supported, for the sidecar writers.
+        if ((off != 0) || (dir != std::ios_base::cur) || ((which & std::ios_base::out) == 0)) {
+            return pos_type(off_type(-1));
+        }
+        return pos_type(static_cast<off_type>(_sent) + (pptr() - pbase()));
+    }
+
+    void pipe_sink::flush_buffer(void) {
+        const auto size = static_cast<std::size_t>(pptr() - pbase());
+        if (size == 0) {
+            return;
+        }
+        auto &buf = _buffers[_current];
+        if (!send(buf.data, size)) {
+            // Copied out, the buffer can be filled again straight away.
+            setp(buf.data, buf.data + _options.buffer_size);
+            return;
+        }
+        buf.release = _sent;
+        _current = (_current + 1) % _buffers.size();
+        const auto &next = _buffers[_current];
+        wait_released(next);
+        setp(next.data, next.data + _options.buffer_size);
+    }
+
+    bool pipe_sink::send(const char *data, std::size_t size) {
+        // A partial page would take a whole pipe slot, copy it instead.
+        if (!_zero_copy || (size < _page)) {
+            send_copy(data, size);
+            return false;
+        }
+        const auto spliced = _spliced;
+        const std::size_t done = (_target == target::pipe) ? splice_pipe(data, size) : splice_socket(data, size);
+        if (done < size) {
+            send_copy(data + done, size - done);
+        }
+        return _spliced != spliced;
+    }
+
+    void pipe_sink::send_copy(const char *data, std::size_t size) {
+        std::size_t done = 0;
+        while (done < size) {
+            const auto n = (_target == target::socket) ? ::send(_fd, data + done, size - done, MSG_NOSIGNAL)
+                                                      : ::write(_fd, data + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                    wait_writable(_fd);
+                    continue;
+                }
+                throw_errno("pipe_sink write");
+            }
+            done += static_cast<std::size_t>(n);
+            _sent += static_cast<std::uint64_t>(n);
+        }
+    }
+
+    std::size_t pipe_sink::splice_pipe(const char *data, std::size_t size) {
+        std::size_t done = 0;
+        while (done < size) {
+            iovec iov{ const_cast<char *>(data + done), size - done };// NOLINT(cppcoreguidelines-pro-type-const-cast)
+            const auto n = ::vmsplice(_fd, &iov, 1, _splice_flags);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN) {
+                    wait_writable(_fd);
+                    continue;
+                }
+                if (unsupported(errno)) {
+                    _zero_copy = false;
+                    break;
+                }
+                throw_errno("pipe_sink vmsplice");
+            }
+            done += static_cast<std::size_t>(n);
+            _sent += static_cast<std::uint64_t>(n);
+            _spliced += static_cast<std::uint64_t>(n);
+        }
+        return done;
+    }
+
+    std::size_t pipe_sink::splice_socket(const char *data, std::size_t size) {
+        std::size_t done = 0;
+        while (done < size) {
+            iovec iov{ const_cast<char *>(data + done), std::min(size - done, _relay_size) };// NOLINT(cppcoreguidelines-pro-type-const-cast)
+            const auto n = ::vmsplice(_relay[1], &iov, 1, 0);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // The relay is empty, so a full relay also means splicing does not work here.
+                if ((errno == EAGAIN) || unsupported(errno)) {
+                    _zero_copy = false;
+                    break;
+                }
+                throw_errno("pipe_sink vmsplice");
+            }
+            auto queued_bytes = static_cast<std::size_t>(n);
+            while (queued_bytes > 0) {
+                const auto m = ::splice(_relay[0], nullptr, _fd, nullptr, queued_bytes, SPLICE_F_MOVE);
+                if (m < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if (errno == EAGAIN) {
+                        wait_writable(_fd);
+                        continue;
+                    }
+                    if (unsupported(errno)) {
+                        // Copy out what is left in the relay.
+                        std::vector<char> rest(queued_bytes);
+                        if (::read(_relay[0], rest.data(), rest.size()) != static_cast<ssize_t>(rest.size())) {
+                            throw_errno("pipe_sink relay");
+                        }
+                        send_copy(rest.data(), rest.size());
+                        _zero_copy = false;
+                        return done + static_cast<std::size_t>(n);
+                    }
+                    throw_errno("pipe_sink splice");
+                }
+                if (m == 0) {
+                    throw std::system_error(std::make_error_code(std::errc::broken_pipe), "pipe_sink splice");
+                }
+                queued_bytes -= static_cast<std::size_t>(m);
+                _sent += static_cast<std::uint64_t>(m);
+                _spliced += static_cast<std::uint64_t>(m);
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        return done;
+    }
+
+    void pipe_sink::wait_writable(int fd) {
+        _stalls++;
+        pollfd p{ fd, POLLOUT, 0 };
+        for (;;) {
+            const int ready = ::poll(&p, 1, _options.timeout_ms);
+            if (ready > 0) {
+                return;
+            }
+            if (ready == 0) {
+                throw std::system_error(std::make_error_code(std::errc::timed_out), "pipe_sink");
+            }
+            if (errno != EINTR) {
+                throw_errno("pipe_sink poll");
+            }
+        }
+    }
+
+    void pipe_sink::wait_released(const buffer &buf) {
+        // There is no notification when the other end reads, so poll the queued bytes.
+        const auto start = std::chrono::steady_clock::now();
+        bool stalled = false;
+        while ((_sent - std::min(_sent, queued())) < buf.release) {
+            if (!stalled) {
+                stalled = true;
+                _stalls++;
+            }
+            if ((_options.timeout_ms >= 0)
+                && (std::chrono::steady_clock::now() - start) > std::chrono::milliseconds(_options.timeout_ms)) {
+                throw std::system_error(std::make_error_code(std::errc::timed_out), "pipe_sink");
+            }
+            ::poll(nullptr, 0, 1);
+        }
+    }
+
+    std::uint64_t pipe_sink::queued(void) const {
+        int count = 0;
+        if (::ioctl(_fd, (_target == target::pipe) ? FIONREAD : SIOCOUTQ, &count) != 0) {
+            throw_errno("pipe_sink ioctl");
+        }
+        return static_cast<std::uint64_t>(std::max(count, 0));
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,121 @@
+/*
+ *  C++ VCD Tracer Library - Pipe and Socket Sink
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+#ifndef VCD_PIPE_SINK_HPP
+#define VCD_PIPE_SINK_HPP
+
+namespace vcd_tracer {
+
+    /** Options to control the buffering of a pipe_sink.
+     */
+    struct pipe_sink_options {
+        //! Bytes per buffer, rounded up to a whole number of pages.
+        std::size_t buffer_size{ 64 * 1024 };
+        //! The number of buffers to rotate through, at least 2.
+        std::size_t buffers{ 8 };
+        //! Map full buffers into the pipe with vmsplice() rather than copy them with write().
+        bool zero_copy{ true };
+        //! How long to wait for a full pipe or socket to drain before failing, -1 to wait forever.
+        int timeout_ms{ -1 };
+    };
+
+    /** A stream buffer that writes a trace to a pipe or a Unix domain socket.
+
+        @code
+        vcd_tracer::pipe_sink sink(fd);
+        std::ostream out(&sink);
+        dumper.finalize_header(out, std::chrono::system_clock::now());
+        @endcode
+
+        The trace is formatted into page aligned buffers. A full buffer is
+        mapped into a pipe with vmsplice(), and into a socket with vmsplice()
+        to a relay pipe then splice() to the socket, so it is not copied by
+        the sink. As the kernel holds references to the pages until the other
+        end reads them, a buffer is not reused until the bytes still queued
+        in the pipe (FIONREAD) or socket (SIOCOUTQ) were all sent after it.
+
+        Small flushes, other file types and kernels without vmsplice() use
+        write(). A non blocking descriptor that is full is polled until it
+        drains, each wait is counted by stall_count(). Errors throw
+        std::system_error, which the std::ostream turns into badbit.
+
+        The descriptor is not closed by the sink. Writing to a pipe with no
+        reader raises SIGPIPE, as for any other pipe writer.
+     */
+    class pipe_sink : public std::streambuf {
+      public:
+        /** @param fd      The pipe or socket to write to.
+            @param options Controls the buffering.
+        */
+        explicit pipe_sink(int fd, pipe_sink_options options = {});
+        pipe_sink(const pipe_sink &) = delete;
+        pipe_sink(pipe_sink &&) = delete;
+        pipe_sink &operator=(const pipe_sink &) = delete;
+        pipe_sink &operator=(pipe_sink &&) = delete;
+        ~pipe_sink(void) override;
+
+        //! True while full buffers are spliced rather than copied.
+        [[nodiscard]] bool zero_copy(void) const { return _zero_copy; }
+        //! The number of bytes sent.
+        [[nodiscard]] std::uint64_t bytes_sent(void) const { return _sent; }
+        //! The number of bytes sent with vmsplice().
+        [[nodiscard]] std::uint64_t spliced_bytes(void) const { return _spliced; }
+        //! The number of times the sink waited for the other end to read.
+        [[nodiscard]] std::uint64_t stall_count(void) const { return _stalls; }
+
+      protected:
+        int_type overflow(int_type ch) override;
+        int sync(void) override;
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+      private:
+        enum class target { file, pipe, socket };
+        struct buffer {
+            char *data;
+            // The stream offset after the last byte spliced from the buffer, 0 if none.
+            std::uint64_t release;
+        };
+
+        void flush_buffer(void);
+        [[nodiscard]] bool send(const char *data, std::size_t size);
+        void send_copy(const char *data, std::size_t size);
+        std::size_t splice_pipe(const char *data, std::size_t size);
+        std::size_t splice_socket(const char *data, std::size_t size);
+        void wait_writable(int fd);
+        void wait_released(const buffer &buf);
+        [[nodiscard]] std::uint64_t queued(void) const;
+
+        int _fd;
+        pipe_sink_options _options;
+        target _target{ target::file };
+        bool _zero_copy{ false };
+        unsigned int _splice_flags{ 0 };
+        // The relay pipe to splice to a socket, read and write ends.
+        int _relay[2]{ -1, -1 };
+        std::size_t _relay_size{ 0 };
+        std::vector<buffer> _buffers;
+        std::size_t _current{ 0 };
+        std::size_t _page{ 0 };
+        std::uint64_t _sent{ 0 };
+        std::uint64_t _spliced{ 0 };
+        std::uint64_t _stalls{ 0 };
+    };
+
+}// namespace vcd_tracer
+
+#endif
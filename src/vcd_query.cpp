@@ -0,0 +1,216 @@
+/*
+ *  C++ VCD Tracer Library - Trace Queries
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+
+#include "vcd_query.hpp"
+
+namespace vcd_tracer::reader {
+
+    /** Reads forward through a trace, keeping the values of the requested signals.
+     */
+    class query::scanner {
+      public:
+        scanner(const query &q, const std::vector<std::size_t> &signals)
+            : _index(q._index),
+              _header(q._trace->get_header()),
+              _data(q._trace->data()),
+              _signals(signals),
+              _position(_header.signals.size(), npos) {
+            for (std::size_t i = 0; i < signals.size(); i++) {
+                if (signals[i] >= _position.size()) {
+                    throw std::out_of_range("vcd_tracer::reader::query: invalid signal " + std::to_string(signals[i]));
+                }
+                if (_position[signals[i]] == npos) {
+                    _position[signals[i]] = i;
+                }
+            }
+        }
+
+        /** Copy results for signals that are requested more than once, such as through aliases.
+            Only the first request of a signal is updated while reading.
+        */
+        template<typename T>
+        void fill_duplicates(std::vector<T> &results) const {
+            for (std::size_t i = 0; i < _signals.size(); i++) {
+                const auto first = _position[_signals[i]];
+                if (first != i) {
+                    results[i] = results[first];
+                }
+            }
+        }
+
+        //! The values of the requested signals.
+        std::vector<std::string> values;
+
+        /** Start reading at the last checkpoint at or before a time,
+            or the start of the trace without an index.
+        */
+        void start(std::uint64_t time) {
+            std::uint64_t offset = _header.body_offset;
+            std::uint64_t start_time = 0;
+            values.assign(_signals.size(), std::string());
+            if ((_index != nullptr) && (_index->entry_count() > 0)) {
+                const auto e = _index->find(time);
+                auto cp = _index->read_checkpoint(_index->entry((e == npos) ? 0 : e).checkpoint, _header, _signals);
+                offset = cp.offset;
+                start_time = cp.time;
+                values = std::move(cp.values);
+            }
+            if (offset > _data.size()) {
+                throw parse_error("index offset is beyond the end of the trace", _data.size());
+            }
+            _cursor.emplace(_header, _data.data() + offset, _data.data() + _data.size(), start_time, _data.data());
+            _pending = false;
+            _more = true;
+        }
+
+        /** Check if restarting from a checkpoint would skip part of the trace.
+         */
+        [[nodiscard]] bool should_restart(std::uint64_t time) const {
+            if (!_cursor) {
+                return true;
+            }
+            if ((_index == nullptr) || (_index->entry_count() == 0)) {
+                return false;
+            }
+            const auto e = _index->find(time);
+            if (e == npos) {
+                return false;
+            }
+            return _index->checkpoint_offset(_index->entry(e).checkpoint) > static_cast<std::uint64_t>(_cursor->position() - _data.data());
+        }
+
+        /** Read the changes up to and including a time.
+            @param limit The last time to read.
+            @param fn    Called as fn(request position, change) for the requested signals.
+        */
+        template<typename F>
+        void advance(std::uint64_t limit, F &&fn) {
+            while (_more) {
+                if (!_pending) {
+                    _more = _cursor->next(_change);
+                    if (!_more) {
+                        break;
+                    }
+                }
+                if (_change.time > limit) {
+                    _pending = true;
+                    break;
+                }
+                _pending = false;
+                const auto pos = _position[_change.signal];
+                if (pos != npos) {
+                    fn(pos, _change);
+                }
+            }
+        }
+
+        //! Read up to and including a time, updating the values.
+        void advance(std::uint64_t limit) {
+            advance(limit, [this](std::size_t pos, const value_change &change) {
+                values[pos] = std::string(change.value);
+            });
+        }
+
+      private:
+        const trace_index *_index;
+        const header &_header;
+        std::string_view _data;
+        const std::vector<std::size_t> &_signals;
+        // The position in the request of each header signal, or npos.
+        std::vector<std::size_t> _position;
+        std::optional<change_cursor> _cursor;
+        value_change _change;
+        bool _pending{ false };
+        bool _more{ true };
+    };
+
+    query::query(const trace &t, const trace_index *index)
+        : _trace(&t), _index(index) {
+    }
+
+    std::vector<std::size_t> query::signals(const std::vector<std::string> &paths) const {
+        const auto &hdr = _trace->get_header();
+        std::vector<std::size_t> result;
+        result.reserve(paths.size());
+        for (const auto &path : paths) {
+            const auto v = hdr.find_var(path);
+            if (v == npos) {
+                throw std::out_of_range("vcd_tracer::reader::query: no variable " + path);
+            }
+            result.push_back(hdr.vars[v].signal);
+        }
+        return result;
+    }
+
+    std::string query::value_at(std::size_t signal, std::uint64_t time) const {
+        return values_at(std::vector<std::size_t>{ signal }, time).front();
+    }
+
+    std::vector<std::string> query::values_at(const std::vector<std::size_t> &signals, std::uint64_t time) const {
+        scanner s(*this, signals);
+        s.start(time);
+        s.advance(time);
+        s.fill_duplicates(s.values);
+        return std::move(s.values);
+    }
+
+    std::vector<std::vector<std::string>> query::values_at(const std::vector<std::size_t> &signals,
+                                                           const std::vector<std::uint64_t> &times) const {
+        std::vector<std::size_t> order(times.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&times](std::size_t a, std::size_t b) {
+            return times[a] < times[b];
+        });
+        std::vector<std::vector<std::string>> result(times.size());
+        scanner s(*this, signals);
+        for (const auto i : order) {
+            if (s.should_restart(times[i])) {
+                s.start(times[i]);
+            }
+            s.advance(times[i]);
+            result[i] = s.values;
+            s.fill_duplicates(result[i]);
+        }
+        return result;
+    }
+
+    window query::changes(const std::vector<std::size_t> &signals, std::uint64_t begin, std::uint64_t end) const {
+        scanner s(*this, signals);
+        window w;
+        w.changes.resize(signals.size());
+        s.start(begin);
+        if (begin > 0) {
+            s.advance(begin - 1);
+        }
+        w.before = s.values;
+        s.fill_duplicates(w.before);
+        if (end < begin) {
+            return w;
+        }
+        s.advance(end, [&w, &s](std::size_t pos, const value_change &change) {
+            auto &history = w.changes[pos];
+            const std::string_view current = history.empty() ? std::string_view(s.values[pos]) : history.back().value;
+            if (!same_value(change.value, current)) {
+                history.push_back({ change.time, change.value });
+            }
+        });
+        s.fill_duplicates(w.changes);
+        return w;
+    }
+
+}// namespace vcd_tracer::reader
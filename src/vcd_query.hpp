@@ -0,0 +1,104 @@
+/*
+ *  C++ VCD Tracer Library - Trace Queries
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vcd_index_reader.hpp"
+#include "vcd_reader.hpp"
+
+#ifndef VCD_QUERY_HPP
+#define VCD_QUERY_HPP
+
+namespace vcd_tracer::reader {
+
+    /** The changes of a set of signals over a time window.
+     */
+    struct window {
+        //! The value of each signal before the window starts, in request order.
+        std::vector<std::string> before;
+        //! The changes of each signal within the window, in request order.
+        std::vector<signal_history> changes;
+    };
+
+    /** Point in time and windowed queries of recorded values.
+
+        Queries are made for a batch of signals. With a sidecar index only
+        the trace from the checkpoint before the queried time is read, and
+        only the checkpoint slots of the queried signals. Without an index
+        the trace is read from the start.
+
+        @code
+        query q(t, &index);
+        const auto signals = q.signals({ "root.bus.addr", "root.bus.data" });
+        const auto now = q.values_at(signals, 1200000);
+        const auto w = q.changes(signals, 1000000, 2000000);
+        @endcode
+
+        Values are as written, such as "1", "bx", "b0101" or "r1.5". A value
+        before the first change of a signal is empty.
+     */
+    class query {
+      public:
+        /** @param t     The trace, it must outlive the query.
+            @param index An index of the trace, or nullptr. It must outlive the query.
+        */
+        explicit query(const trace &t, const trace_index *index = nullptr);
+
+        /** Look up signals by the hierarchical path of a variable.
+            @throw std::out_of_range If a path is not declared.
+        */
+        [[nodiscard]] std::vector<std::size_t> signals(const std::vector<std::string> &paths) const;
+
+        /** The value of a signal at a time, including the changes at that time.
+            @throw std::out_of_range If the signal is not in the trace.
+        */
+        [[nodiscard]] std::string value_at(std::size_t signal, std::uint64_t time) const;
+
+        /** The values of signals at a time, including the changes at that time.
+            @retval The values, in the order of signals.
+            @throw std::out_of_range If a signal is not in the trace.
+        */
+        [[nodiscard]] std::vector<std::string> values_at(const std::vector<std::size_t> &signals,
+                                                         std::uint64_t time) const;
+
+        /** The values of signals at many times.
+            The times are visited in order in one pass, an index is used to
+            skip ahead when the next time is beyond a later checkpoint.
+            @retval The values at each time, in the order of times then signals.
+            @throw std::out_of_range If a signal is not in the trace.
+        */
+        [[nodiscard]] std::vector<std::vector<std::string>> values_at(const std::vector<std::size_t> &signals,
+                                                                      const std::vector<std::uint64_t> &times) const;
+
+        /** The changes of signals in the window [begin, end].
+            A change to the value a signal already has is not kept,
+            values are compared with same_value() as load_histories() does.
+            @throw std::out_of_range If a signal is not in the trace.
+        */
+        [[nodiscard]] window changes(const std::vector<std::size_t> &signals,
+                                     std::uint64_t begin,
+                                     std::uint64_t end) const;
+
+      private:
+        class scanner;
+
+        const trace *_trace;
+        const trace_index *_index;
+    };
+
+}// namespace vcd_tracer::reader
+
+#endif
@@ -0,0 +1,694 @@
+/*
+ *  C++ VCD Tracer Library - VCD Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <ostream>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "vcd_reader.hpp"
+#include "vcd_parallel.hpp"
+
+namespace vcd_tracer::reader {
+
+    // ------------------------------------------------------------------------
+    // Mapped file
+
+    mapped_file::mapped_file(const std::string &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            const int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "stat " + path);
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+        if (_size > 0) {
+            void *addr = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                const int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "mmap " + path);
+            }
+            // The whole file is read front to back.
+            ::madvise(addr, _size, MADV_SEQUENTIAL);
+            _data = static_cast<const char *>(addr);
+        }
+        ::close(fd);
+    }
+
+    mapped_file::mapped_file(mapped_file &&other) noexcept
+        : _data(std::exchange(other._data, nullptr)),
+          _size(std::exchange(other._size, 0)) {
+    }
+
+    mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+        if (this != &other) {
+            if (_data != nullptr) {
+                ::munmap(const_cast<char *>(_data), _size);
+            }
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+        }
+        return *this;
+    }
+
+    mapped_file::~mapped_file(void) {
+        if (_data != nullptr) {
+            ::munmap(const_cast<char *>(_data), _size);
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Scanning
+
+    namespace scan {
+
+        const char *find_char(const char *pos, const char *end, char c) {
+#if defined(__SSE2__)
+            const __m128i match = _mm_set1_epi8(c);
+            while (end - pos >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+                const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, match));
+                if (mask != 0) {
+                    return pos + __builtin_ctz(static_cast<unsigned int>(mask));
+                }
+                pos += 16;
+            }
+#endif
+            while ((pos != end) && (*pos != c)) {
+                pos++;
+            }
+            return pos;
+        }
+
+        const char *find_space(const char *pos, const char *end) {
+#if defined(__SSE2__)
+            // An unsigned compare of <= ' ' is done as min(x, ' ') == x
+            const __m128i space = _mm_set1_epi8(' ');
+            while (end - pos >= 16) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+                const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(chunk, space), chunk));
+                if (mask != 0) {
+                    return pos + __builtin_ctz(static_cast<unsigned int>(mask));
+                }
+                pos += 16;
+            }
+#endif
+            while ((pos != end) && (static_cast<unsigned char>(*pos) > ' ')) {
+                pos++;
+            }
+            return pos;
+        }
+
+        const char *skip_space(const char *pos, const char *end) {
+            // Usually a single new line, so no vector scan.
+            while ((pos != end) && (static_cast<unsigned char>(*pos) <= ' ')) {
+                pos++;
+            }
+            return pos;
+        }
+
+    }// namespace scan
+
+    namespace {
+
+        // The identifier characters used by vcd_tracer::identifier_generator
+        constexpr char RANK_START = '!';
+        constexpr char RANK_END = 'z';
+        constexpr std::uint64_t RANK_BASE = RANK_END - RANK_START + 1;
+        // Longest identifier ranked, longer ones are looked up by name.
+        constexpr std::size_t RANK_MAX_LENGTH = 5;
+
+        /** Find the position of an identifier in the identifier_generator sequence.
+            @retval false The identifier is not part of the sequence.
+        */
+        bool identifier_rank(std::string_view identifier, std::uint64_t &rank) {
+            if (identifier.empty() || (identifier.size() > RANK_MAX_LENGTH)) {
+                return false;
+            }
+            // All shorter identifiers come first.
+            std::uint64_t offset = 0;
+            std::uint64_t count = 1;
+            for (std::size_t i = 1; i < identifier.size(); i++) {
+                count *= RANK_BASE;
+                offset += count;
+            }
+            std::uint64_t value = 0;
+            for (const char c : identifier) {
+                if ((c < RANK_START) || (c > RANK_END)) {
+                    return false;
+                }
+                value = (value * RANK_BASE) + static_cast<std::uint64_t>(c - RANK_START);
+            }
+            rank = offset + value;
+            return true;
+        }
+
+        /** Tokenizer for the definitions section.
+         */
+        class token_reader {
+          public:
+            token_reader(std::string_view data)
+                : _begin(data.data()), _pos(data.data()), _end(data.data() + data.size()) {
+            }
+            //! Read the next token, empty at the end of the data.
+            std::string_view next(void) {
+                _pos = scan::skip_space(_pos, _end);
+                const char *token_end = scan::find_space(_pos, _end);
+                std::string_view token(_pos, static_cast<std::size_t>(token_end - _pos));
+                _pos = token_end;
+                return token;
+            }
+            //! Read a token that must be present.
+            std::string_view expect(const char *what) {
+                auto token = next();
+                if (token.empty()) {
+                    throw parse_error(std::string("unexpected end of header, expected ") + what, offset());
+                }
+                return token;
+            }
+            //! Read all tokens up to $end, joined with spaces.
+            std::string text(void) {
+                std::string result;
+                for (auto token = expect("$end"); token != "$end"; token = expect("$end")) {
+                    if (!result.empty()) {
+                        result += ' ';
+                    }
+                    result += token;
+                }
+                return result;
+            }
+            //! The current offset in the data.
+            [[nodiscard]] std::size_t offset(void) const { return static_cast<std::size_t>(_pos - _begin); }
+
+          private:
+            const char *_begin;
+            const char *_pos;
+            const char *_end;
+        };
+
+    }// namespace
+
+    // ------------------------------------------------------------------------
+    // Header
+
+    std::size_t header::find_signal(std::string_view identifier) const {
+        if (!_dense.empty()) {
+            std::uint64_t rank = 0;
+            if (identifier_rank(identifier, rank) && (rank < _dense.size())) {
+                const auto idx = _dense[static_cast<std::size_t>(rank)];
+                return (idx == std::numeric_limits<std::uint32_t>::max()) ? npos : idx;
+            }
+            return npos;
+        }
+        const auto it = _identifiers.find(std::string(identifier));
+        return (it == _identifiers.end()) ? npos : it->second;
+    }
+
+    std::size_t header::find_var(std::string_view path) const {
+        const auto it = _paths.find(std::string(path));
+        return (it == _paths.end()) ? npos : it->second;
+    }
+
+    std::string header::scope_path(std::size_t scope_index) const {
+        if (scope_index == npos) {
+            return {};
+        }
+        const auto &s = scopes[scope_index];
+        if (s.parent == npos) {
+            return s.name;
+        }
+        return scope_path(s.parent) + "." + s.name;
+    }
+
+    std::string header::path(std::size_t var_index) const {
+        const auto &v = vars[var_index];
+        if (v.scope == npos) {
+            return v.name;
+        }
+        return scope_path(v.scope) + "." + v.name;
+    }
+
+    void header::index(void) {
+        _dense.clear();
+        _identifiers.clear();
+        _paths.clear();
+        // Use a dense table when every identifier is from the generator sequence.
+        std::uint64_t max_rank = 0;
+        bool dense = !signals.empty();
+        for (const auto &s : signals) {
+            std::uint64_t rank = 0;
+            if (!identifier_rank(s.identifier, rank)) {
+                dense = false;
+                break;
+            }
+            max_rank = std::max(max_rank, rank);
+        }
+        if (dense && (max_rank < (2 * signals.size()) + 1024)) {
+            _dense.assign(static_cast<std::size_t>(max_rank + 1), std::numeric_limits<std::uint32_t>::max());
+            for (std::size_t i = 0; i < signals.size(); i++) {
+                std::uint64_t rank = 0;
+                (void)identifier_rank(signals[i].identifier, rank);
+                _dense[static_cast<std::size_t>(rank)] = static_cast<std::uint32_t>(i);
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < signals.size(); i++) {
+                _identifiers.emplace(signals[i].identifier, i);
+            }
+        }
+        // Paths are built scope by scope to avoid walking up the tree for every variable.
+        std::vector<std::string> scope_paths(scopes.size());
+        for (std::size_t i = 0; i < scopes.size(); i++) {
+            // Parents are always declared before their children.
+            const auto parent = scopes[i].parent;
+            scope_paths[i] = (parent == npos) ? scopes[i].name : scope_paths[parent] + "." + scopes[i].name;
+        }
+        for (std::size_t i = 0; i < vars.size(); i++) {
+            const auto s = vars[i].scope;
+            _paths.emplace((s == npos) ? vars[i].name : scope_paths[s] + "." + vars[i].name, i);
+        }
+    }
+
+    header parse_header(std::string_view data) {
+        header hdr;
+        token_reader tokens(data);
+        std::size_t current_scope = npos;
+        std::unordered_map<std::string, std::size_t> signal_of_identifier;
+        while (true) {
+            const auto keyword = tokens.next();
+            if (keyword.empty()) {
+                throw parse_error("missing $enddefinitions", tokens.offset());
+            }
+            if (keyword == "$enddefinitions") {
+                if (tokens.expect("$end") != "$end") {
+                    throw parse_error("expected $end", tokens.offset());
+                }
+                break;
+            }
+            if (keyword == "$date") {
+                hdr.date = tokens.text();
+            }
+            else if (keyword == "$version") {
+                hdr.version = tokens.text();
+            }
+            else if (keyword == "$timescale") {
+                // "1ns" or "1 ns"
+                hdr.timescale = tokens.text();
+                hdr.timescale.erase(std::remove(hdr.timescale.begin(), hdr.timescale.end(), ' '), hdr.timescale.end());
+            }
+            else if (keyword == "$scope") {
+                scope s;
+                s.type = tokens.expect("scope type");
+                s.name = tokens.expect("scope name");
+                s.parent = current_scope;
+                if (tokens.expect("$end") != "$end") {
+                    throw parse_error("expected $end", tokens.offset());
+                }
+                const auto idx = hdr.scopes.size();
+                if (current_scope != npos) {
+                    hdr.scopes[current_scope].children.push_back(idx);
+                }
+                hdr.scopes.push_back(std::move(s));
+                current_scope = idx;
+            }
+            else if (keyword == "$upscope") {
+                if (current_scope == npos) {
+                    throw parse_error("$upscope without $scope", tokens.offset());
+                }
+                current_scope = hdr.scopes[current_scope].parent;
+                (void)tokens.text();
+            }
+            else if (keyword == "$var") {
+                var v;
+                v.type = tokens.expect("var type");
+                const auto size_token = tokens.expect("var size");
+                unsigned int bit_size = 0;
+                if (std::from_chars(size_token.data(), size_token.data() + size_token.size(), bit_size).ec != std::errc{}) {
+                    throw parse_error("invalid var size", tokens.offset());
+                }
+                const std::string identifier(tokens.expect("var identifier"));
+                // The reference, with an optional bit range.
+                v.name = tokens.text();
+                v.scope = current_scope;
+                auto [it, inserted] = signal_of_identifier.try_emplace(identifier, hdr.signals.size());
+                if (inserted) {
+                    signal sig;
+                    sig.identifier = identifier;
+                    sig.bit_size = bit_size;
+                    sig.real = (v.type == "real");
+                    hdr.signals.push_back(std::move(sig));
+                }
+                v.signal = it->second;
+                const auto idx = hdr.vars.size();
+                hdr.signals[v.signal].vars.push_back(idx);
+                if (current_scope != npos) {
+                    hdr.scopes[current_scope].vars.push_back(idx);
+                }
+                hdr.vars.push_back(std::move(v));
+            }
+            else if (keyword[0] == '$') {
+                // $comment and unknown sections are skipped.
+                (void)tokens.text();
+            }
+            else {
+                throw parse_error("unexpected token in header", tokens.offset());
+            }
+        }
+        hdr.body_offset = tokens.offset();
+        hdr.index();
+        return hdr;
+    }
+
+    // ------------------------------------------------------------------------
+    // Values
+
+    bool decode_bits(std::string_view value, std::uint64_t &bits) {
+        if (value.empty()) {
+            return false;
+        }
+        if ((value[0] == 'b') || (value[0] == 'B')) {
+            value.remove_prefix(1);
+        }
+        else if (value.size() != 1) {
+            return false;
+        }
+        std::uint64_t result = 0;
+        for (const char c : value) {
+            if (c == '1') {
+                result = (result << 1) | 1;
+            }
+            else if (c == '0') {
+                result <<= 1;
+            }
+            else {
+                return false;
+            }
+        }
+        bits = result;
+        return true;
+    }
+
+    bool decode_real(std::string_view value, double &real) {
+        if ((value.size() < 2) || ((value[0] != 'r') && (value[0] != 'R'))) {
+            return false;
+        }
+        const auto result = std::from_chars(value.data() + 1, value.data() + value.size(), real);
+        return result.ec == std::errc{};
+    }
+
+    bool same_value(std::string_view a, std::string_view b) {
+        if (a == b) {
+            return true;
+        }
+        std::uint64_t a_bits = 0;
+        std::uint64_t b_bits = 0;
+        if (decode_bits(a, a_bits)) {
+            return decode_bits(b, b_bits) && (a_bits == b_bits);
+        }
+        double a_real = 0;
+        double b_real = 0;
+        if (decode_real(a, a_real)) {
+            return decode_real(b, b_real) && (a_real == b_real);
+        }
+        // x and z states, a scalar 'x' is a vector 'bx' or 'bxxxx'.
+        const auto state = [](std::string_view v) {
+            if (!v.empty() && ((v[0] == 'b') || (v[0] == 'B'))) {
+                v.remove_prefix(1);
+            }
+            if (!v.empty() && (v.find_first_not_of(v[0]) == std::string_view::npos)) {
+                v = v.substr(0, 1);
+            }
+            return v;
+        };
+        return state(a) == state(b);
+    }
+
+    void write_change(std::ostream &out, std::string_view value, std::string_view identifier) {
+        out << value;
+        if ((value[0] == 'b') || (value[0] == 'B') || (value[0] == 'r') || (value[0] == 'R')) {
+            out << ' ';
+        }
+        out << identifier << '\n';
+    }
+
+    std::uint64_t timescale_fs(std::string_view timescale) {
+        std::uint64_t count = 0;
+        const char *end = timescale.data() + timescale.size();
+        const auto result = std::from_chars(timescale.data(), end, count);
+        const std::string_view unit(scan::skip_space(result.ptr, end), static_cast<std::size_t>(end - scan::skip_space(result.ptr, end)));
+        constexpr std::array<std::pair<std::string_view, std::uint64_t>, 6> units{
+            { { "s", 1000000000000000ULL }, { "ms", 1000000000000ULL }, { "us", 1000000000ULL }, { "ns", 1000000ULL }, { "ps", 1000ULL }, { "fs", 1ULL } }
+        };
+        for (const auto &[name, fs] : units) {
+            if ((result.ec == std::errc{}) && (count > 0) && (unit == name)) {
+                return count * fs;
+            }
+        }
+        throw parse_error("invalid timescale '" + std::string(timescale) + "'", 0);
+    }
+
+    // ------------------------------------------------------------------------
+    // Change cursor
+
+    bool change_cursor::next(value_change &change) {
+        while (true) {
+            _pos = scan::skip_space(_pos, _end);
+            if (_pos == _end) {
+                return false;
+            }
+            const char *token_end = scan::find_space(_pos, _end);
+            const char c = *_pos;
+            if (c == '#') {
+                std::uint64_t new_time = 0;
+                if (std::from_chars(_pos + 1, token_end, new_time).ptr != token_end) {
+                    throw parse_error("invalid timestamp", static_cast<std::size_t>(_pos - _base));
+                }
+                _time = new_time;
+                _pos = token_end;
+                continue;
+            }
+            if (c == '$') {
+                const std::string_view keyword(_pos, static_cast<std::size_t>(token_end - _pos));
+                _pos = token_end;
+                if (keyword == "$comment") {
+                    // Skip to the end of the comment
+                    std::string_view token;
+                    do {
+                        _pos = scan::skip_space(_pos, _end);
+                        token_end = scan::find_space(_pos, _end);
+                        token = std::string_view(_pos, static_cast<std::size_t>(token_end - _pos));
+                        _pos = token_end;
+                    } while (!token.empty() && (token != "$end"));
+                }
+                // The values in $dumpvars, $dumpall, $dumpon and $dumpoff are read as changes.
+                continue;
+            }
+            std::string_view identifier;
+            if ((c == 'b') || (c == 'B') || (c == 'r') || (c == 'R')) {
+                // Vector or real, the identifier is the next token.
+                change.value = std::string_view(_pos, static_cast<std::size_t>(token_end - _pos));
+                const char *id_begin = scan::skip_space(token_end, _end);
+                token_end = scan::find_space(id_begin, _end);
+                identifier = std::string_view(id_begin, static_cast<std::size_t>(token_end - id_begin));
+            }
+            else {
+                // Scalar, the identifier follows the value.
+                change.value = std::string_view(_pos, 1);
+                identifier = std::string_view(_pos + 1, static_cast<std::size_t>(token_end - _pos - 1));
+            }
+            change.signal = _header->find_signal(identifier);
+            if (change.signal == npos) {
+                throw parse_error("undeclared identifier '" + std::string(identifier) + "'", static_cast<std::size_t>(_pos - _base));
+            }
+            change.time = _time;
+            _pos = token_end;
+            return true;
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Trace
+
+    trace::trace(mapped_file file)
+        : _file(std::move(file)),
+          _data(_file->data()),
+          _header(parse_header(_data)) {
+    }
+
+    trace::trace(std::string_view data)
+        : _data(data),
+          _header(parse_header(_data)) {
+    }
+
+    // ------------------------------------------------------------------------
+    // Parallel parsing
+
+    namespace {
+
+        /** A change read from a chunk, before it is grouped by signal.
+         */
+        struct chunk_change {
+            std::size_t signal;
+            std::uint64_t time;
+            std::string_view value;
+        };
+
+        /** Append a change to a history, unless it repeats the current value.
+            Values are compared as query::changes() does, by what they mean.
+         */
+        inline void append_change(signal_history &history, std::uint64_t time, std::string_view value) {
+            if (history.empty() || !same_value(history.back().value, value)) {
+                history.push_back({ time, value });
+            }
+        }
+
+    }// namespace
+
+    std::vector<std::string_view> split_body(const trace &t, std::size_t count) {
+        const auto body = t.body();
+        std::vector<std::string_view> chunks;
+        const char *begin = body.data();
+        const char *end = body.data() + body.size();
+        const std::size_t target = std::max<std::size_t>(1, body.size() / std::max<std::size_t>(1, count));
+        const char *chunk_begin = begin;
+        while (chunk_begin != end) {
+            const char *chunk_end = end;
+            if (static_cast<std::size_t>(end - chunk_begin) > target) {
+                // Find the next timestamp line after the target size.
+                const char *pos = chunk_begin + target;
+                chunk_end = end;
+                while ((pos = scan::find_char(pos, end, '\n')) != end) {
+                    pos++;
+                    if ((pos != end) && (*pos == '#')) {
+                        chunk_end = pos;
+                        break;
+                    }
+                }
+            }
+            chunks.emplace_back(chunk_begin, static_cast<std::size_t>(chunk_end - chunk_begin));
+            chunk_begin = chunk_end;
+        }
+        return chunks;
+    }
+
+    std::vector<signal_history> load_histories(const trace &t, unsigned int threads) {
+        const auto &hdr = t.get_header();
+        std::vector<signal_history> histories(hdr.signals.size());
+        threads = detail::thread_count(threads);
+        if (threads == 1) {
+            t.for_each_change([&](const value_change &change) {
+                append_change(histories[change.signal], change.time, change.value);
+            });
+            return histories;
+        }
+
+        // Each signal is merged by one partition, each partition by one thread.
+        const std::size_t partitions = threads;
+        const std::size_t signal_count = histories.size();
+        std::vector<std::size_t> partition_of(signal_count);
+        for (std::size_t p = 0; p < partitions; p++) {
+            const std::size_t first = (p * signal_count) / partitions;
+            const std::size_t last = ((p + 1) * signal_count) / partitions;
+            std::fill(partition_of.begin() + static_cast<std::ptrdiff_t>(first),
+                      partition_of.begin() + static_cast<std::ptrdiff_t>(last), p);
+        }
+
+        // Parse chunks in parallel. Several chunks per thread balances the load.
+        // The changes of each chunk are bucketed by partition as they are read.
+        const auto chunks = split_body(t, static_cast<std::size_t>(threads) * 4);
+        std::vector<std::vector<std::vector<chunk_change>>> parsed(chunks.size());
+        detail::parallel_for(chunks.size(), threads, [&](std::size_t c) {
+            change_cursor cursor(hdr, chunks[c].data(), chunks[c].data() + chunks[c].size(), 0, t.data().data());
+            value_change change;
+            auto &buckets = parsed[c];
+            buckets.resize(partitions);
+            for (auto &bucket : buckets) {
+                bucket.reserve(chunks[c].size() / (8 * partitions));
+            }
+            while (cursor.next(change)) {
+                buckets[partition_of[change.signal]].push_back({ change.signal, change.time, change.value });
+            }
+        });
+
+        // Merge each partition from it's own buckets. Chunks are visited in order, so the first
+        // change of a chunk is compared with the last value of the previous chunk.
+        detail::parallel_for(partitions, threads, [&](std::size_t p) {
+            for (auto &buckets : parsed) {
+                for (const auto &change : buckets[p]) {
+                    append_change(histories[change.signal], change.time, change.value);
+                }
+                // Release the bucket once it is merged.
+                std::vector<chunk_change>().swap(buckets[p]);
+            }
+        });
+        return histories;
+    }
+
+    namespace {
+        /** Find the first timestamp after a time.
+            The range must only hold timestamps and keywords, such as the text between two changes.
+            @retval end If there is no timestamp after time.
+        */
+        const char *timestamp_after(const char *pos, const char *end, std::uint64_t time) {
+            pos = scan::skip_space(pos, end);
+            while (pos != end) {
+                const char *token_end = scan::find_space(pos, end);
+                std::uint64_t stamp = 0;
+                if ((*pos == '#') && (std::from_chars(pos + 1, token_end, stamp).ptr == token_end) && (stamp > time)) {
+                    break;
+                }
+                pos = scan::skip_space(token_end, end);
+            }
+            return pos;
+        }
+    }// namespace
+
+    std::size_t find_time(const trace &t, std::uint64_t time, std::size_t from) {
+        const auto &hdr = t.get_header();
+        const auto data = t.data();
+        from = std::clamp(from, hdr.body_offset, data.size());
+        change_cursor cursor(hdr, data.data() + from, data.data() + data.size(), 0, data.data());
+        value_change change;
+        const char *before = cursor.position();
+        bool more = false;
+        while ((more = cursor.next(change)) && (change.time <= time)) {
+            before = cursor.position();
+        }
+        const char *until = more ? cursor.position() : (data.data() + data.size());
+        return static_cast<std::size_t>(timestamp_after(before, until, time) - data.data());
+    }
+
+}// namespace vcd_tracer::reader
@@ -0,0 +1,383 @@
+/*
+ *  C++ VCD Tracer Library - VCD Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef VCD_READER_HPP
+#define VCD_READER_HPP
+
+/**
+   Reading back traces:
+
+   The reader is used to post process traces written by vcd_tracer::top.
+
+   - The file is memory mapped, and never copied.
+   - The header is parsed back into the scope and variable tree.
+   - Value changes are streamed through a cursor or callback, as views into
+     the mapped file. Nothing is allocated per change.
+ */
+namespace vcd_tracer::reader {
+
+    /** Thrown when a VCD file can not be parsed.
+     */
+    class parse_error : public std::runtime_error {
+      public:
+        /** @param what   Description of the error.
+            @param offset Byte offset into the file where the error was found.
+        */
+        parse_error(const std::string &what, std::size_t offset)
+            : std::runtime_error(what + " at offset " + std::to_string(offset)),
+              _offset(offset) {
+        }
+        //! Byte offset into the file where the error was found.
+        [[nodiscard]] std::size_t offset(void) const { return _offset; }
+
+      private:
+        std::size_t _offset;
+    };
+
+    /** A read only memory mapping of a whole file.
+     */
+    class mapped_file {
+      public:
+        /** Map a file.
+            @param path The file to map.
+            @throw std::system_error The file could not be opened or mapped.
+        */
+        explicit mapped_file(const std::string &path);
+        mapped_file(mapped_file &&other) noexcept;
+        mapped_file &operator=(mapped_file &&other) noexcept;
+        mapped_file(const mapped_file &) = delete;
+        mapped_file &operator=(const mapped_file &) = delete;
+        ~mapped_file(void);
+
+        //! The contents of the file.
+        [[nodiscard]] std::string_view data(void) const { return { _data, _size }; }
+
+      private:
+        const char *_data{ nullptr };
+        std::size_t _size{ 0 };
+    };
+
+    /** Byte scanning primitives.
+        These use SSE2 when available, and fall back to a byte at a time.
+     */
+    namespace scan {
+        /** Find the next occurrence of a character.
+            @retval end when not found.
+        */
+        const char *find_char(const char *pos, const char *end, char c);
+        /** Find the next white space (any character up to and including ' ').
+            @retval end when not found.
+        */
+        const char *find_space(const char *pos, const char *end);
+        /** Skip white space.
+            @retval end when only white space remains.
+        */
+        const char *skip_space(const char *pos, const char *end);
+    }// namespace scan
+
+    //! Index value used to indicate no entry.
+    constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /** A $scope declaration.
+     */
+    struct scope {
+        //! The scope type, such as "module".
+        std::string type;
+        //! The scope instance name.
+        std::string name;
+        //! Index of the parent scope, or npos for a top level scope.
+        std::size_t parent{ npos };
+        //! Index of the child scopes.
+        std::vector<std::size_t> children;
+        //! Index of the variables declared in this scope.
+        std::vector<std::size_t> vars;
+    };
+
+    /** A $var declaration.
+        Several variables may share one signal identifier.
+     */
+    struct var {
+        //! The variable type, such as "wire" or "real".
+        std::string type;
+        //! The variable name, including any bit range.
+        std::string name;
+        //! Index of the declaring scope.
+        std::size_t scope{ npos };
+        //! Index of the signal (identifier) of this variable.
+        std::size_t signal{ npos };
+    };
+
+    /** A signal is a unique identifier in the trace, all value changes refer to one.
+     */
+    struct signal {
+        //! The VCD identifier code.
+        std::string identifier;
+        //! The size, in bits.
+        unsigned int bit_size{ 0 };
+        //! Set if the values are real.
+        bool real{ false };
+        //! Index of the variables that use this identifier.
+        std::vector<std::size_t> vars;
+    };
+
+    /** The definitions section of a VCD file.
+     */
+    class header {
+      public:
+        //! Text of the $date section.
+        std::string date;
+        //! Text of the $version section.
+        std::string version;
+        //! Text of the $timescale section, such as "1ns".
+        std::string timescale;
+        //! All scopes, in declaration order.
+        std::vector<scope> scopes;
+        //! All variables, in declaration order.
+        std::vector<var> vars;
+        //! All signals, in order of first declaration.
+        std::vector<signal> signals;
+        //! Byte offset of the first character after "$enddefinitions $end".
+        std::size_t body_offset{ 0 };
+
+        /** Find a signal by identifier code.
+            @retval npos If the identifier is not declared.
+        */
+        [[nodiscard]] std::size_t find_signal(std::string_view identifier) const;
+
+        /** Find a variable by it's hierarchical path, such as "root.bus.addr".
+            @retval npos If the path is not declared.
+        */
+        [[nodiscard]] std::size_t find_var(std::string_view path) const;
+
+        /** The hierarchical path of a variable.
+         */
+        [[nodiscard]] std::string path(std::size_t var_index) const;
+
+        /** The hierarchical path of a scope.
+         */
+        [[nodiscard]] std::string scope_path(std::size_t scope_index) const;
+
+        /** Build the lookup tables, this must be called once all declarations have been added.
+         */
+        void index(void);
+
+      private:
+        // Identifiers made by identifier_generator are dense, and are looked up by rank.
+        std::vector<std::uint32_t> _dense;
+        std::unordered_map<std::string, std::size_t> _identifiers;
+        std::unordered_map<std::string, std::size_t> _paths;
+    };
+
+    /** Parse the definitions section of a VCD file.
+        @param data The file contents.
+        @throw parse_error If the definitions are malformed.
+    */
+    [[nodiscard]] header parse_header(std::string_view data);
+
+    /** A single value change. The views point into the traced data.
+     */
+    struct value_change {
+        //! The time of the change, in timescale units.
+        std::uint64_t time{ 0 };
+        //! Index of the changed signal in header::signals.
+        std::size_t signal{ npos };
+        //! The value as written, such as "1", "x", "b0101" or "r1.5".
+        std::string_view value;
+    };
+
+    /** Decode a scalar or vector value to an integer.
+        @param value A value as found in value_change::value.
+        @param[out] bits The decoded value, the low 64 bits are kept.
+        @retval false The value has x or z bits, or is not a scalar or vector.
+    */
+    bool decode_bits(std::string_view value, std::uint64_t &bits);
+
+    /** Decode a real value.
+        @param value A value as found in value_change::value.
+        @param[out] real The decoded value.
+        @retval false The value is not a real.
+    */
+    bool decode_real(std::string_view value, double &real);
+
+    /** Compare values by what they mean rather than how they are written.
+        The same bits may be written with a different number of leading zeros,
+        and the same real with a different number of digits.
+        @retval true The values are the same.
+    */
+    [[nodiscard]] bool same_value(std::string_view a, std::string_view b);
+
+    /** Write a value change.
+        @param out        The trace output.
+        @param value      The value as written, such as "1", "b0101" or "r1.5".
+        @param identifier The identifier code of the signal.
+    */
+    void write_change(std::ostream &out, std::string_view value, std::string_view identifier);
+
+    /** The length of a timescale.
+        @param timescale A timescale such as "1ns" or "10 ps".
+        @retval The timescale in femtoseconds.
+        @throw parse_error If the timescale can not be parsed.
+    */
+    [[nodiscard]] std::uint64_t timescale_fs(std::string_view timescale);
+
+    /** Stream value changes from a range of a trace body.
+     */
+    class change_cursor {
+      public:
+        /** @param hdr   The parsed header, used to look up identifiers.
+            @param begin Start of the value change text.
+            @param end   End of the value change text.
+            @param time  The time before the first timestamp in the range.
+            @param base  Start of the file, used to report error offsets. Defaults to begin.
+        */
+        change_cursor(const header &hdr,
+                      const char *begin,
+                      const char *end,
+                      std::uint64_t time = 0,
+                      const char *base = nullptr)
+            : _header(&hdr), _base((base == nullptr) ? begin : base), _pos(begin), _end(end), _time(time) {
+        }
+
+        /** Read the next value change.
+            @param[out] change The change, only valid while the trace is mapped.
+            @retval false There are no more changes.
+            @throw parse_error On an undeclared identifier or malformed value.
+        */
+        bool next(value_change &change);
+
+        //! The most recent timestamp.
+        [[nodiscard]] std::uint64_t time(void) const { return _time; }
+        //! The current read position.
+        [[nodiscard]] const char *position(void) const { return _pos; }
+
+      private:
+        const header *_header;
+        const char *_base;
+        const char *_pos;
+        const char *_end;
+        std::uint64_t _time;
+    };
+
+    /** A VCD trace held in memory, either a mapped file or a caller owned buffer.
+     */
+    class trace {
+      public:
+        /** Read a trace from a mapped file.
+            @throw parse_error If the header can not be parsed.
+        */
+        explicit trace(mapped_file file);
+        /** Read a trace from a buffer, the buffer must outlive this object.
+            @throw parse_error If the header can not be parsed.
+        */
+        explicit trace(std::string_view data);
+        trace(trace &&) = default;
+        trace(const trace &) = delete;
+        trace &operator=(const trace &) = delete;
+
+        //! The parsed definitions.
+        [[nodiscard]] const header &get_header(void) const { return _header; }
+        //! The whole trace.
+        [[nodiscard]] std::string_view data(void) const { return _data; }
+        //! The value change section.
+        [[nodiscard]] std::string_view body(void) const { return _data.substr(_header.body_offset); }
+
+        //! A cursor over every value change.
+        [[nodiscard]] change_cursor changes(void) const {
+            const auto b = body();
+            return change_cursor(_header, b.data(), b.data() + b.size(), 0, _data.data());
+        }
+
+        /** Call a function for every value change.
+            @param fn Called as fn(const value_change &).
+        */
+        template<typename F>
+        void for_each_change(F &&fn) const {
+            auto cursor = changes();
+            value_change change;
+            while (cursor.next(change)) {
+                fn(change);
+            }
+        }
+
+      private:
+        std::optional<mapped_file> _file;
+        std::string_view _data;
+        header _header;
+    };
+
+    /** A value at a point in time, the view points into the traced data.
+     */
+    struct timed_value {
+        //! The time of the change, in timescale units.
+        std::uint64_t time{ 0 };
+        //! The value as written, such as "1", "x", "b0101" or "r1.5".
+        std::string_view value;
+    };
+
+    //! The changes of one signal, in time order.
+    using signal_history = std::vector<timed_value>;
+
+    /** Split the value change section into chunks that start at a timestamp.
+        A chunk boundary is only placed before a line that starts with '#', so every
+        chunk after the first starts by setting the time.
+        @param t     The trace to split.
+        @param count The wanted number of chunks, fewer are returned if there are not enough timestamps.
+        @retval The chunks, in order, covering the whole body.
+    */
+    [[nodiscard]] std::vector<std::string_view> split_body(const trace &t, std::size_t count);
+
+    /** Read every value change, grouped by signal.
+        A change to the value a signal already has (such as in a $dumpall) is not kept,
+        values are compared with same_value().
+
+        With more than one thread the body is split at timestamps, the chunks are
+        parsed in parallel and then merged per signal. Each chunk buckets it's
+        changes by signal partition, so each merge thread only reads the changes
+        of it's own signals. The merge reconciles the first changes of each chunk
+        with the state at the end of the previous chunk, so the result is
+        identical to a sequential parse.
+
+        Between the parse and the merge every change is held once in a bucket,
+        32 bytes per change on a 64 bit target, as well as the histories. A
+        bucket is released once it is merged.
+
+        @param t       The trace to read.
+        @param threads Number of threads, 0 to use the hardware concurrency, 1 for a sequential parse.
+        @retval One history per signal, indexed as header::signals.
+        @throw parse_error If the body is malformed.
+    */
+    [[nodiscard]] std::vector<signal_history> load_histories(const trace &t, unsigned int threads = 0);
+
+    /** Find the first timestamp after a time.
+        @param t    The trace.
+        @param time The time.
+        @param from Byte offset to start reading, this must be between tokens at or before the wanted timestamp.
+        @retval The byte offset of the "#time" line, or the end of the trace.
+        @throw parse_error If the body is malformed.
+    */
+    [[nodiscard]] std::size_t find_time(const trace &t, std::uint64_t time, std::size_t from = 0);
+
+}// namespace vcd_tracer::reader
+
+#endif
@@ -0,0 +1,182 @@
+/*
+ *  C++ VCD Tracer Library - Shared Memory Ring Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cerrno>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vcd_bytes.hpp"
+#include "vcd_ring_reader.hpp"
+#include "vcd_shm_ring.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+        const ring_format::control &ctrl(const char *segment) {
+            return *reinterpret_cast<const ring_format::control *>(segment);
+        }
+
+        ring_value unpack(std::uint64_t meta, std::uint64_t bits) {
+            return ring_value{ static_cast<std::uint8_t>(meta & 0xFF), ((meta >> 8) & 1) != 0, bits };
+        }
+    }// namespace
+
+    ring_reader::ring_reader(const std::string &name) {
+        const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "can not open " + name);
+        }
+        struct stat st {};
+        if (::fstat(fd, &st) != 0) {
+            const int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "can not stat " + name);
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+        if (_size < sizeof(ring_format::control)) {
+            ::close(fd);
+            throw parse_error("not an initialized ring", 0);
+        }
+        void *mapped = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "can not map " + name);
+        }
+        _segment = static_cast<const char *>(mapped);
+
+        const auto &c = ctrl(_segment);
+        if ((c.ready.load(std::memory_order_acquire) != ring_format::ready_magic)
+            || (c.segment_size.load(std::memory_order_relaxed) != _size)) {
+            ::munmap(mapped, _size);
+            throw parse_error("not an initialized ring", 0);
+        }
+        _capacity = c.capacity.load(std::memory_order_relaxed);
+        const auto signals = c.signal_count.load(std::memory_order_relaxed);
+        const auto names_end = c.checkpoint_offset.load(std::memory_order_relaxed);
+        std::size_t pos = c.names_offset.load(std::memory_order_relaxed);
+        const auto text = [&](void) {
+            if ((pos + 4) > names_end) {
+                throw parse_error("truncated ring names", pos);
+            }
+            const auto length = vcd_tracer::detail::get_u32({ _segment, names_end }, pos);
+            pos += 4;
+            if ((pos + length) > names_end) {
+                throw parse_error("truncated ring names", pos);
+            }
+            std::string s(_segment + pos, length);
+            pos += length;
+            return s;
+        };
+        try {
+            for (std::uint64_t s = 0; s < signals; s++) {
+                _paths.push_back(text());
+                _identifiers.push_back(text());
+            }
+        }
+        catch (...) {
+            ::munmap(mapped, _size);
+            throw;
+        }
+        _values.resize(_paths.size());
+        resync();
+        _resyncs = 0;
+    }
+
+    ring_reader::~ring_reader(void) {
+        ::munmap(const_cast<char *>(_segment), _size);
+    }
+
+    void ring_reader::resync(void) {
+        const auto &c = ctrl(_segment);
+        const auto checkpoint_offset = c.checkpoint_offset.load(std::memory_order_relaxed);
+        const auto checkpoint_size = c.checkpoint_size.load(std::memory_order_relaxed);
+        // The writer only holds a checkpoint for as long as it takes to copy the values.
+        constexpr unsigned int attempts = 1000000;
+        for (unsigned int attempt = 0; attempt < attempts; attempt++) {
+            if (attempt != 0) {
+                std::this_thread::yield();
+            }
+            const auto count = c.checkpoints.load(std::memory_order_acquire);
+            const char *buffer = _segment + checkpoint_offset + (((count - 1) % 2) * checkpoint_size);
+            const auto &cp = *reinterpret_cast<const ring_format::checkpoint *>(buffer);
+            const auto *slots = reinterpret_cast<const ring_format::slot *>(buffer + sizeof(ring_format::checkpoint));
+            const auto lock = cp.lock.load(std::memory_order_acquire);
+            if ((lock % 2) != 0) {
+                continue;
+            }
+            const auto record_seq = cp.record_seq.load(std::memory_order_relaxed);
+            const auto time = cp.time.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < _values.size(); i++) {
+                _values[i] = unpack(slots[i].meta.load(std::memory_order_relaxed), slots[i].bits.load(std::memory_order_relaxed));
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            // The buffer was rewritten while it was copied, or the records after it are gone.
+            if ((cp.lock.load(std::memory_order_relaxed) != lock)
+                || ((c.write_seq.load(std::memory_order_acquire) - record_seq) > _capacity)) {
+                continue;
+            }
+            _position = record_seq;
+            _time = time;
+            _resyncs++;
+            return;
+        }
+        throw parse_error("the ring checkpoints are not stable, has the writer stopped?", checkpoint_offset);
+    }
+
+    std::size_t ring_reader::read(std::vector<ring_change> &changes, std::size_t max) {
+        const auto &c = ctrl(_segment);
+        const auto *records = reinterpret_cast<const ring_format::record *>(_segment + c.ring_offset.load(std::memory_order_relaxed));
+        std::size_t count = 0;
+        while (count < max) {
+            const auto &r = records[_position & (_capacity - 1)];
+            const auto seq = r.seq.load(std::memory_order_acquire);
+            if (seq == (_position + 1)) {
+                const auto time = r.time.load(std::memory_order_relaxed);
+                const auto meta = r.meta.load(std::memory_order_relaxed);
+                const auto bits = r.bits.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (r.seq.load(std::memory_order_relaxed) == seq) {
+                    const auto signal = static_cast<std::size_t>(meta >> 32);
+                    if (signal < _values.size()) {
+                        const auto value = unpack(meta, bits);
+                        _values[signal] = value;
+                        _time = time;
+                        changes.push_back(ring_change{ time, signal, value });
+                        count++;
+                    }
+                    _position++;
+                    continue;
+                }
+            }
+            if (c.write_seq.load(std::memory_order_acquire) <= _position) {
+                // Nothing more has been published.
+                break;
+            }
+            // Published, so it has been or is being overwritten by a later change.
+            resync();
+        }
+        return count;
+    }
+
+    bool ring_reader::finished(void) const {
+        const auto &c = ctrl(_segment);
+        return (c.status.load(std::memory_order_acquire) == ring_format::status_finished)
+               && (c.write_seq.load(std::memory_order_acquire) <= _position);
+    }
+
+}// namespace vcd_tracer::reader
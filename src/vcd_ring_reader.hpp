@@ -0,0 +1,125 @@
+/*
+ *  C++ VCD Tracer Library - Shared Memory Ring Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vcd_reader.hpp"
+
+#ifndef VCD_RING_READER_HPP
+#define VCD_RING_READER_HPP
+
+namespace vcd_tracer::reader {
+
+    /** A value published to a shared memory ring.
+     */
+    struct ring_value {
+        //! The state, one of the vcd_tracer::index_format states.
+        std::uint8_t state{ 3 };
+        //! Set if the value is real.
+        bool is_real{ false };
+        //! The value bits, or the bits of the double.
+        std::uint64_t bits{ 0 };
+
+        //! The value of a real.
+        [[nodiscard]] double real(void) const {
+            double v = 0;
+            std::memcpy(&v, &bits, sizeof(v));
+            return v;
+        }
+    };
+
+    /** A value change read from a shared memory ring.
+     */
+    struct ring_change {
+        //! The time of the change.
+        std::uint64_t time{ 0 };
+        //! The index of the signal, in order of registration.
+        std::size_t signal{ 0 };
+        //! The new value.
+        ring_value value;
+    };
+
+    /** Follow the value changes published by a vcd_tracer::shm_ring_writer.
+
+        The reader starts from the latest checkpoint, so values() holds the
+        value of every signal when it attaches. read() never waits, it
+        returns the changes published since the last call. If the writer has
+        overwritten changes that were not read yet the reader resyncs from
+        the latest checkpoint, some changes are lost and resync_count() goes
+        up.
+
+        @code
+        ring_reader ring("/my_sim");
+        std::vector<ring_change> changes;
+        while (!ring.finished()) {
+            changes.clear();
+            if (ring.read(changes) == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            ...
+        }
+        @endcode
+     */
+    class ring_reader {
+      public:
+        /** Attach to a ring.
+            @param name The POSIX shared memory name, such as "/my_sim".
+            @throw std::system_error The segment could not be opened or mapped.
+            @throw parse_error The segment is not an initialized ring.
+        */
+        explicit ring_reader(const std::string &name);
+        ring_reader(const ring_reader &) = delete;
+        ring_reader &operator=(const ring_reader &) = delete;
+        ~ring_reader(void);
+
+        //! The hierarchical path of each signal, in order of registration.
+        [[nodiscard]] const std::vector<std::string> &paths(void) const { return _paths; }
+        //! The identifier of each signal, in order of registration.
+        [[nodiscard]] const std::vector<std::string> &identifiers(void) const { return _identifiers; }
+        //! The value of every signal after the changes read so far.
+        [[nodiscard]] const std::vector<ring_value> &values(void) const { return _values; }
+        //! The time of the last change or checkpoint read.
+        [[nodiscard]] std::uint64_t time(void) const { return _time; }
+        //! The number of times the reader fell behind and resynced.
+        [[nodiscard]] std::uint64_t resync_count(void) const { return _resyncs; }
+
+        /** Read the changes published since the last call.
+            @param[out] changes The changes are appended.
+            @param max          The most changes to read.
+            @retval The number of changes appended.
+        */
+        std::size_t read(std::vector<ring_change> &changes, std::size_t max = npos);
+
+        //! True once the trace is finalized and every change has been read.
+        [[nodiscard]] bool finished(void) const;
+
+      private:
+        void resync(void);
+
+        const char *_segment{ nullptr };
+        std::size_t _size{ 0 };
+        std::vector<std::string> _paths;
+        std::vector<std::string> _identifiers;
+        std::vector<ring_value> _values;
+        std::uint64_t _capacity{ 0 };
+        std::uint64_t _position{ 0 };
+        std::uint64_t _time{ 0 };
+        std::uint64_t _resyncs{ 0 };
+    };
+
+}// namespace vcd_tracer::reader
+
+#endif
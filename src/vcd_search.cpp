@@ -0,0 +1,218 @@
+/*
+ *  C++ VCD Tracer Library - Value Search
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+#include "vcd_bytes.hpp"
+#include "vcd_parallel.hpp"
+#include "vcd_search.hpp"
+#include "vcd_value_index.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+        using vcd_tracer::detail::get_u32;
+        using vcd_tracer::detail::get_u64;
+    }// namespace
+
+    trace_value_index::trace_value_index(mapped_file file)
+        : _file(std::move(file)),
+          _data(_file->data()) {
+        parse();
+    }
+
+    trace_value_index::trace_value_index(std::string_view data)
+        : _data(data) {
+        parse();
+    }
+
+    void trace_value_index::parse(void) {
+        const auto magic_size = value_index_format::header_magic.size();
+        if ((_data.size() < (magic_size + 8 + value_index_format::footer_size))
+            || (_data.substr(0, magic_size) != std::string_view(value_index_format::header_magic.data(), magic_size))) {
+            throw parse_error("not a value index", 0);
+        }
+        const std::size_t footer = _data.size() - value_index_format::footer_size;
+        if (_data.substr(footer + 16, magic_size) != std::string_view(value_index_format::footer_magic.data(), magic_size)) {
+            throw parse_error("incomplete value index", footer);
+        }
+        const auto directory = get_u64(_data, footer);
+        const auto count = get_u64(_data, footer + 8);
+        if ((directory > footer) || (count != ((footer - directory) / 8))) {
+            throw parse_error("invalid value index directory", footer);
+        }
+        std::uint64_t pos = magic_size;
+        const auto signals = get_u64(_data, pos);
+        pos += 8;
+        for (std::uint64_t s = 0; s < signals; s++) {
+            if ((pos + 4) > directory) {
+                throw parse_error("truncated value index identifiers", pos);
+            }
+            const auto length = get_u32(_data, pos);
+            pos += 4;
+            if ((pos + length) > directory) {
+                throw parse_error("truncated value index identifiers", pos);
+            }
+            _identifiers.emplace_back(_data.substr(pos, length));
+            _slots.emplace(_identifiers.back(), static_cast<std::uint32_t>(_identifiers.size() - 1));
+            pos += length;
+        }
+        for (std::uint64_t n = 0; n < count; n++) {
+            const auto chunk = get_u64(_data, directory + (n * 8));
+            if ((chunk < pos) || ((chunk + value_index_format::chunk_header_size) > directory)
+                || (get_u64(_data, chunk + 16) > ((directory - chunk - value_index_format::chunk_header_size) / value_index_format::zone_size))) {
+                throw parse_error("invalid value index chunk", directory + (n * 8));
+            }
+            _chunks.push_back(chunk);
+        }
+    }
+
+    std::uint64_t trace_value_index::chunk_time(std::size_t n) const {
+        return get_u64(_data, _chunks.at(n));
+    }
+
+    std::uint64_t trace_value_index::chunk_offset(std::size_t n) const {
+        return get_u64(_data, _chunks.at(n) + 8);
+    }
+
+    std::vector<std::size_t> trace_value_index::candidates(const signal &sig, std::string_view value) const {
+        std::vector<std::size_t> result;
+        const auto it = _slots.find(sig.identifier);
+        if (it == _slots.end()) {
+            // Not indexed, every chunk may hold it.
+            for (std::size_t n = 0; n < _chunks.size(); n++) {
+                result.push_back(n);
+            }
+            return result;
+        }
+        const auto slot = it->second;
+
+        // What is searched for, a known value or a state.
+        std::uint64_t bits = 0;
+        std::uint8_t state_flag = 0;
+        double real = 0;
+        bool known = false;
+        if (sig.real) {
+            known = decode_real(value, real);
+            std::memcpy(&bits, &real, sizeof(bits));
+        }
+        else {
+            known = decode_bits(value, bits);
+        }
+        if (!known) {
+            const auto c = ((value.size() > 1) && ((value[0] == 'b') || (value[0] == 'B'))) ? value[1] : (value.empty() ? '\0' : value[0]);
+            state_flag = ((c == 'z') || (c == 'Z')) ? value_index_format::has_z : value_index_format::has_x;
+        }
+        const auto positions = value_index_format::bloom_positions(bits);
+
+        for (std::size_t n = 0; n < _chunks.size(); n++) {
+            const auto zones = _chunks[n] + value_index_format::chunk_header_size;
+            // Zones are in signal order.
+            const auto count = static_cast<std::size_t>(get_u64(_data, _chunks[n] + 16));
+            std::size_t lo = 0;
+            std::size_t hi = count;
+            while (lo < hi) {
+                const std::size_t mid = lo + ((hi - lo) / 2);
+                if (get_u32(_data, zones + (mid * value_index_format::zone_size)) < slot) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            const auto z = zones + (lo * value_index_format::zone_size);
+            if ((lo < count) && (get_u32(_data, z) == slot)) {
+                const auto flags = static_cast<std::uint8_t>(_data[z + 4]);
+                bool may = false;
+                if (!known) {
+                    may = (flags & state_flag) != 0;
+                }
+                else if ((flags & value_index_format::has_range) != 0) {
+                    const auto min = get_u64(_data, z + 8);
+                    const auto max = get_u64(_data, z + 16);
+                    if (sig.real) {
+                        double dmin = 0;
+                        double dmax = 0;
+                        std::memcpy(&dmin, &min, sizeof(dmin));
+                        std::memcpy(&dmax, &max, sizeof(dmax));
+                        may = (real >= dmin) && (real <= dmax);
+                    }
+                    else {
+                        may = (bits >= min) && (bits <= max);
+                    }
+                    const std::array<std::uint64_t, 2> bloom{ get_u64(_data, z + 24), get_u64(_data, z + 32) };
+                    for (const auto p : positions) {
+                        may = may && (((bloom[p / 64] >> (p % 64)) & 1) != 0);
+                    }
+                }
+                if (may) {
+                    result.push_back(n);
+                }
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::uint64_t> find_value(const trace &t,
+                                          const trace_value_index &index,
+                                          std::size_t signal,
+                                          std::string_view value,
+                                          unsigned int threads) {
+        return find_value(t, &index, signal, value, threads);
+    }
+
+    std::vector<std::uint64_t> find_value(const trace &t,
+                                          const trace_value_index *index,
+                                          std::size_t signal,
+                                          std::string_view value,
+                                          unsigned int threads) {
+        const auto &hdr = t.get_header();
+        const auto data = t.data();
+        // The ranges of the trace to search, and the time before each.
+        std::vector<std::tuple<std::uint64_t, std::uint64_t, std::uint64_t>> ranges;
+        if (index == nullptr) {
+            ranges.emplace_back(hdr.body_offset, data.size(), 0);
+        }
+        else {
+            for (const auto n : index->candidates(hdr.signals.at(signal), value)) {
+                const auto begin = std::min<std::uint64_t>(index->chunk_offset(n), data.size());
+                const auto end = ((n + 1) < index->chunk_count()) ? std::min<std::uint64_t>(index->chunk_offset(n + 1), data.size()) : data.size();
+                if (begin > end) {
+                    throw parse_error("value index chunks are out of order", begin);
+                }
+                ranges.emplace_back(begin, end, index->chunk_time(n));
+            }
+        }
+        std::vector<std::vector<std::uint64_t>> found(ranges.size());
+        detail::parallel_for(ranges.size(), detail::thread_count(threads), [&](std::size_t r) {
+            const auto [begin, end, time] = ranges[r];
+            change_cursor cursor(hdr, data.data() + begin, data.data() + end, time, data.data());
+            value_change change;
+            while (cursor.next(change)) {
+                if ((change.signal == signal) && same_value(change.value, value)) {
+                    found[r].push_back(change.time);
+                }
+            }
+        });
+        std::vector<std::uint64_t> times;
+        for (const auto &f : found) {
+            times.insert(times.end(), f.begin(), f.end());
+        }
+        return times;
+    }
+
+}// namespace vcd_tracer::reader
@@ -0,0 +1,101 @@
+/*
+ *  C++ VCD Tracer Library - Value Search
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "vcd_reader.hpp"
+
+#ifndef VCD_SEARCH_HPP
+#define VCD_SEARCH_HPP
+
+namespace vcd_tracer::reader {
+
+    /** A sidecar value index written by vcd_tracer::value_index_writer.
+     */
+    class trace_value_index {
+      public:
+        /** Read a value index from a mapped file.
+            @throw parse_error If the file is not a complete value index.
+        */
+        explicit trace_value_index(mapped_file file);
+        /** Read a value index from a buffer, the buffer must outlive this object.
+            @throw parse_error If the data is not a complete value index.
+        */
+        explicit trace_value_index(std::string_view data);
+        trace_value_index(trace_value_index &&) = default;
+        trace_value_index(const trace_value_index &) = delete;
+        trace_value_index &operator=(const trace_value_index &) = delete;
+
+        //! The identifiers of the indexed signals.
+        [[nodiscard]] const std::vector<std::string> &identifiers(void) const { return _identifiers; }
+        //! The number of chunks.
+        [[nodiscard]] std::size_t chunk_count(void) const { return _chunks.size(); }
+        //! The time of the first timestamp of a chunk.
+        [[nodiscard]] std::uint64_t chunk_time(std::size_t n) const;
+        //! The trace offset of the first timestamp of a chunk.
+        [[nodiscard]] std::uint64_t chunk_offset(std::size_t n) const;
+
+        /** The chunks that may hold changes of a signal to a value.
+            Chunks are skipped when the signal does not change in them, or the
+            value is outside the range of known values or not in the bloom filter.
+            @param sig   The signal, from the header of the indexed trace.
+            @param value The value, such as "b1011", "1", "x" or "r1.5".
+            @retval The chunk numbers, in order.
+        */
+        [[nodiscard]] std::vector<std::size_t> candidates(const signal &sig, std::string_view value) const;
+
+      private:
+        void parse(void);
+        std::optional<mapped_file> _file;
+        std::string_view _data;
+        std::vector<std::string> _identifiers;
+        std::unordered_map<std::string, std::uint32_t> _slots;
+        std::vector<std::uint64_t> _chunks;
+    };
+
+    /** Find the times a signal changes to a value.
+
+        Only the chunks of the trace that the value index does not rule out
+        are read, in parallel. A value is matched with same_value().
+
+        @param t       The trace.
+        @param index   The value index of the trace.
+        @param signal  Index of the signal, in header::signals.
+        @param value   The value, such as "b1011", "1", "x" or "r1.5".
+        @param threads Number of threads, 0 to use the hardware concurrency.
+        @retval The times, in order.
+        @throw parse_error If the trace is malformed.
+    */
+    [[nodiscard]] std::vector<std::uint64_t> find_value(const trace &t,
+                                                        const trace_value_index &index,
+                                                        std::size_t signal,
+                                                        std::string_view value,
+                                                        unsigned int threads = 0);
+
+    /** Find the times a signal changes to a value, reading the whole trace when there is no index.
+        @param index The value index of the trace, or nullptr.
+    */
+    [[nodiscard]] std::vector<std::uint64_t> find_value(const trace &t,
+                                                        const trace_value_index *index,
+                                                        std::size_t signal,
+                                                        std::string_view value,
+                                                        unsigned int threads = 0);
+
+}// namespace vcd_tracer::reader
+
+#endif
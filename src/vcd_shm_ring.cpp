@@ -0,0 +1,175 @@
+/*
+ *  C++ VCD Tracer Library - Shared Memory Ring
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vcd_bytes.hpp"
+#include "vcd_index.hpp"
+#include "vcd_shm_ring.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        constexpr std::size_t align_up(std::size_t v, std::size_t to) {
+            return (v + to - 1) & ~(to - 1);
+        }
+    }// namespace
+
+    shm_ring_writer::shm_ring_writer(std::string name, shm_ring_options options)
+        : _name(std::move(name)), _options(options) {
+        std::uint64_t capacity = 1;
+        while (capacity < std::max<std::uint64_t>(4, _options.capacity)) {
+            capacity <<= 1;
+        }
+        _options.capacity = capacity;
+        // A checkpoint must still be in the ring for a reader to resync from it.
+        if ((_options.checkpoint_records == 0) || (_options.checkpoint_records > (capacity / 2))) {
+            _options.checkpoint_records = capacity / 4;
+        }
+    }
+
+    shm_ring_writer::~shm_ring_writer(void) {
+        if (_segment != nullptr) {
+            ::munmap(_segment, _size);
+            ::shm_unlink(_name.c_str());
+        }
+    }
+
+    trace_observer shm_ring_writer::observer(void) {
+        trace_observer o;
+        o.on_header = [this](std::ostream &, const std::vector<std::string> &identifiers, const std::vector<std::string> &paths) {
+            on_header(identifiers, paths);
+        };
+        o.on_time = [this](std::ostream &, scope_fn::sequence_t time) { on_time(time); };
+        o.on_change = [this](const raw_change &change) { on_change(change); };
+        o.on_finalize = [this](std::ostream &) { on_finalize(); };
+        return o;
+    }
+
+    ring_format::control &shm_ring_writer::ctrl(void) const {
+        return *reinterpret_cast<ring_format::control *>(_segment);
+    }
+
+    void shm_ring_writer::on_header(const std::vector<std::string> &identifiers, const std::vector<std::string> &paths) {
+        std::string names;
+        for (std::size_t i = 0; i < identifiers.size(); i++) {
+            for (const auto *text : { &paths[i], &identifiers[i] }) {
+                detail::append_u32(names, static_cast<std::uint32_t>(text->size()));
+                names += *text;
+            }
+        }
+        constexpr std::size_t line = 64;
+        const std::size_t names_offset = align_up(sizeof(ring_format::control), line);
+        const std::size_t checkpoint_offset = align_up(names_offset + names.size(), line);
+        const std::size_t checkpoint_size = align_up(sizeof(ring_format::checkpoint) + (identifiers.size() * sizeof(ring_format::slot)), line);
+        const std::size_t ring_offset = checkpoint_offset + (2 * checkpoint_size);
+        _size = ring_offset + (static_cast<std::size_t>(_options.capacity) * sizeof(ring_format::record));
+
+        // Replace any segment left by an earlier run, readers of it keep their mapping.
+        ::shm_unlink(_name.c_str());
+        const int fd = ::shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "vcd_tracer::shm_ring_writer: can not create " + _name);
+        }
+        if (::ftruncate(fd, static_cast<off_t>(_size)) != 0) {
+            const int error = errno;
+            ::close(fd);
+            ::shm_unlink(_name.c_str());
+            throw std::system_error(error, std::generic_category(), "vcd_tracer::shm_ring_writer: can not size " + _name);
+        }
+        void *mapped = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            const int error = errno;
+            ::shm_unlink(_name.c_str());
+            throw std::system_error(error, std::generic_category(), "vcd_tracer::shm_ring_writer: can not map " + _name);
+        }
+        _segment = static_cast<char *>(mapped);
+
+        // The segment is zero filled, so every record is empty.
+        auto &c = ctrl();
+        c.segment_size.store(_size, std::memory_order_relaxed);
+        c.signal_count.store(identifiers.size(), std::memory_order_relaxed);
+        c.capacity.store(_options.capacity, std::memory_order_relaxed);
+        c.names_offset.store(names_offset, std::memory_order_relaxed);
+        c.checkpoint_offset.store(checkpoint_offset, std::memory_order_relaxed);
+        c.checkpoint_size.store(checkpoint_size, std::memory_order_relaxed);
+        c.ring_offset.store(ring_offset, std::memory_order_relaxed);
+        c.status.store(ring_format::status_live, std::memory_order_relaxed);
+        std::memcpy(_segment + names_offset, names.data(), names.size());
+        _values.assign(identifiers.size(), { index_format::state_none, 0 });
+        write_checkpoint();
+        c.ready.store(ring_format::ready_magic, std::memory_order_release);
+    }
+
+    void shm_ring_writer::write_checkpoint(void) {
+        auto &c = ctrl();
+        char *buffer = _segment + c.checkpoint_offset.load(std::memory_order_relaxed)
+                       + ((_checkpoints % 2) * c.checkpoint_size.load(std::memory_order_relaxed));
+        auto &cp = *reinterpret_cast<ring_format::checkpoint *>(buffer);
+        auto *slots = reinterpret_cast<ring_format::slot *>(buffer + sizeof(ring_format::checkpoint));
+        const auto lock = cp.lock.load(std::memory_order_relaxed);
+        cp.lock.store(lock + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        cp.record_seq.store(_seq, std::memory_order_relaxed);
+        cp.time.store(_time, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < _values.size(); i++) {
+            slots[i].meta.store(_values[i].first, std::memory_order_relaxed);
+            slots[i].bits.store(_values[i].second, std::memory_order_relaxed);
+        }
+        cp.lock.store(lock + 2, std::memory_order_release);
+        _checkpoints++;
+        c.checkpoints.store(_checkpoints, std::memory_order_release);
+        _checkpoint_seq = _seq;
+    }
+
+    void shm_ring_writer::on_time(scope_fn::sequence_t time) {
+        // Checkpoint between timestamps, so the values are those of a whole time.
+        if ((_seq - _checkpoint_seq) >= _options.checkpoint_records) {
+            write_checkpoint();
+        }
+        _time = time;
+    }
+
+    void shm_ring_writer::on_change(const raw_change &change) {
+        const auto [state, bits] = index_format::encode_change(change);
+        const std::uint64_t value_meta = (change.is_real ? (std::uint64_t{ 1 } << 8) : 0) | state;
+        _values[change.index] = { value_meta, bits };
+
+        auto &c = ctrl();
+        auto *records = reinterpret_cast<ring_format::record *>(_segment + c.ring_offset.load(std::memory_order_relaxed));
+        auto &r = records[_seq & (_options.capacity - 1)];
+        r.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        r.time.store(_time, std::memory_order_relaxed);
+        r.meta.store((static_cast<std::uint64_t>(change.index) << 32) | value_meta, std::memory_order_relaxed);
+        r.bits.store(bits, std::memory_order_relaxed);
+        r.seq.store(_seq + 1, std::memory_order_release);
+        _seq++;
+        c.write_seq.store(_seq, std::memory_order_release);
+    }
+
+    void shm_ring_writer::on_finalize(void) {
+        write_checkpoint();
+        ctrl().status.store(ring_format::status_finished, std::memory_order_release);
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,182 @@
+/*
+ *  C++ VCD Tracer Library - Shared Memory Ring
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_SHM_RING_HPP
+#define VCD_SHM_RING_HPP
+
+/**
+   Shared memory ring:
+
+   Value changes are published to a POSIX shared memory segment as they are
+   traced, so a viewer process can follow a running simulation. There is a
+   single writer that never waits for readers. Readers that fall behind by
+   more than the ring capacity detect the overrun and resync from the latest
+   checkpoint of every value.
+
+   Every shared word is a lock free 64 bit atomic. Records and checkpoints
+   are guarded by sequence counters, a reader copies one and checks that the
+   counter did not change while it did so.
+
+   Segment layout:
+
+   - Control:     a ring_format::control.
+   - Names:       per signal a u32 length and the hierarchical path, then a u32
+                  length and the identifier, in order of registration.
+   - Checkpoints: two buffers, each a ring_format::checkpoint followed by a
+                  ring_format::slot per signal.
+   - Records:     capacity ring_format::record, record n is in slot n % capacity.
+ */
+namespace vcd_tracer::ring_format {
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "the ring needs lock free 64 bit atomics");
+
+    //! The value of control::ready once the segment is initialized.
+    constexpr std::uint64_t ready_magic = 0x31474e4952444356ULL;// "VCDRING1"
+    //! control::status while tracing.
+    constexpr std::uint64_t status_live = 0;
+    //! control::status once the trace is finalized.
+    constexpr std::uint64_t status_finished = 1;
+
+    /** The start of the segment.
+     */
+    struct control {
+        //! ready_magic once the rest of the segment is initialized.
+        std::atomic<std::uint64_t> ready;
+        //! The size of the segment, in bytes.
+        std::atomic<std::uint64_t> segment_size;
+        //! The number of signals.
+        std::atomic<std::uint64_t> signal_count;
+        //! The number of records in the ring, a power of 2.
+        std::atomic<std::uint64_t> capacity;
+        //! Segment offset of the names.
+        std::atomic<std::uint64_t> names_offset;
+        //! Segment offset of the first checkpoint buffer.
+        std::atomic<std::uint64_t> checkpoint_offset;
+        //! Bytes per checkpoint buffer.
+        std::atomic<std::uint64_t> checkpoint_size;
+        //! Segment offset of the records.
+        std::atomic<std::uint64_t> ring_offset;
+        //! The number of records published.
+        std::atomic<std::uint64_t> write_seq;
+        //! The number of checkpoints published, the latest is in buffer (checkpoints - 1) % 2.
+        std::atomic<std::uint64_t> checkpoints;
+        //! status_live or status_finished.
+        std::atomic<std::uint64_t> status;
+    };
+
+    /** A value change.
+     */
+    struct record {
+        //! The record number + 1, 0 while the record is written.
+        std::atomic<std::uint64_t> seq;
+        //! The time of the change.
+        std::atomic<std::uint64_t> time;
+        //! The signal index << 32, is_real << 8 and the index_format state.
+        std::atomic<std::uint64_t> meta;
+        //! The value bits, or the bits of the double.
+        std::atomic<std::uint64_t> bits;
+    };
+
+    /** The value of a signal in a checkpoint.
+     */
+    struct slot {
+        //! is_real << 8 and the index_format state.
+        std::atomic<std::uint64_t> meta;
+        //! The value bits, or the bits of the double.
+        std::atomic<std::uint64_t> bits;
+    };
+
+    /** The header of a checkpoint buffer.
+     */
+    struct checkpoint {
+        //! Odd while the buffer is written.
+        std::atomic<std::uint64_t> lock;
+        //! The values are those before this record.
+        std::atomic<std::uint64_t> record_seq;
+        //! The time of the values.
+        std::atomic<std::uint64_t> time;
+    };
+}// namespace vcd_tracer::ring_format
+
+namespace vcd_tracer {
+
+    /** Options to control the size of a ring.
+     */
+    struct shm_ring_options {
+        //! The number of records in the ring, rounded up to a power of 2.
+        std::uint64_t capacity{ 65536 };
+        //! Write a checkpoint at the first timestamp after this many records, 0 for a quarter of the capacity.
+        std::uint64_t checkpoint_records{ 0 };
+    };
+
+    /** Publish the value changes of a trace to a shared memory ring.
+
+        @code
+        vcd_tracer::shm_ring_writer ring("/my_sim");
+        dumper.add_observer(ring.observer());
+        @endcode
+
+        The segment is created when the header is finalized, replacing any
+        segment of the same name, and is unlinked when the writer is
+        destroyed. The writer must outlive the tracing.
+     */
+    class shm_ring_writer {
+      public:
+        /** @param name    The POSIX shared memory name, such as "/my_sim".
+            @param options Controls the ring size.
+        */
+        explicit shm_ring_writer(std::string name, shm_ring_options options = {});
+        shm_ring_writer(const shm_ring_writer &) = delete;
+        shm_ring_writer(shm_ring_writer &&) = delete;
+        shm_ring_writer &operator=(const shm_ring_writer &) = delete;
+        shm_ring_writer &operator=(shm_ring_writer &&) = delete;
+        ~shm_ring_writer(void);
+
+        /** The functions to add to the top scope with top::add_observer().
+         */
+        trace_observer observer(void);
+
+        //! The number of records published.
+        [[nodiscard]] std::uint64_t record_count(void) const { return _seq; }
+        //! The number of checkpoints published.
+        [[nodiscard]] std::uint64_t checkpoint_count(void) const { return _checkpoints; }
+
+      private:
+        void on_header(const std::vector<std::string> &identifiers, const std::vector<std::string> &paths);
+        void on_time(scope_fn::sequence_t time);
+        void on_change(const raw_change &change);
+        void on_finalize(void);
+        void write_checkpoint(void);
+        [[nodiscard]] ring_format::control &ctrl(void) const;
+
+        std::string _name;
+        shm_ring_options _options;
+        char *_segment{ nullptr };
+        std::size_t _size{ 0 };
+        // The current value of every signal, meta and bits.
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> _values;
+        std::uint64_t _time{ 0 };
+        std::uint64_t _seq{ 0 };
+        std::uint64_t _checkpoint_seq{ 0 };
+        std::uint64_t _checkpoints{ 0 };
+    };
+
+}// namespace vcd_tracer
+
+#endif
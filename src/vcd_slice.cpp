@@ -0,0 +1,190 @@
+/*
+ *  C++ VCD Tracer Library - Trace Slicing
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+
+#include "vcd_slice.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+
+        bool any_match(const std::vector<std::string> &filters, std::string_view path) {
+            return std::any_of(filters.begin(), filters.end(), [path](const std::string &pattern) {
+                return path_matches(pattern, path);
+            });
+        }
+
+        void write_header_section(std::ostream &out, const char *keyword, const std::string &text) {
+            if (!text.empty()) {
+                out << keyword << "\n   " << text << "\n$end\n";
+            }
+        }
+
+        void write_var(std::ostream &out, const header &hdr, std::size_t v) {
+            const auto &var = hdr.vars[v];
+            const auto &sig = hdr.signals[var.signal];
+            out << "$var " << var.type << " " << sig.bit_size << " " << sig.identifier << " " << var.name << " $end\n";
+        }
+
+        /** Write the kept scopes and variables under a scope.
+         */
+        void write_scope(std::ostream &out,
+                         const header &hdr,
+                         std::size_t s,
+                         const std::vector<bool> &scope_used,
+                         const std::vector<bool> &var_kept) {
+            const auto &sc = hdr.scopes[s];
+            out << "$scope " << sc.type << " " << sc.name << " $end\n";
+            for (const auto v : sc.vars) {
+                if (var_kept[v]) {
+                    write_var(out, hdr, v);
+                }
+            }
+            for (const auto child : sc.children) {
+                if (scope_used[child]) {
+                    write_scope(out, hdr, child, scope_used, var_kept);
+                }
+            }
+            out << "$upscope $end\n";
+        }
+
+    }// namespace
+
+    bool path_matches(std::string_view pattern, std::string_view path) {
+        // Wildcard matching, backtracking to the most recent '*'.
+        std::size_t p = 0;
+        std::size_t s = 0;
+        std::size_t star = std::string_view::npos;
+        std::size_t star_s = 0;
+        while (s < path.size()) {
+            if ((p < pattern.size()) && ((pattern[p] == '?') || (pattern[p] == path[s]))) {
+                p++;
+                s++;
+            }
+            else if ((p < pattern.size()) && (pattern[p] == '*')) {
+                star = p++;
+                star_s = s;
+            }
+            else if (star != std::string_view::npos) {
+                p = star + 1;
+                s = ++star_s;
+            }
+            else {
+                return false;
+            }
+        }
+        while ((p < pattern.size()) && (pattern[p] == '*')) {
+            p++;
+        }
+        return p == pattern.size();
+    }
+
+    std::size_t slice(const trace &t, const trace_index *index, const slice_options &options, std::ostream &out) {
+        const auto &hdr = t.get_header();
+        const auto data = t.data();
+
+        // Select the variables. Scopes are declared before their children.
+        const bool keep_all = options.filters.empty();
+        std::vector<bool> scope_all(hdr.scopes.size(), keep_all);
+        std::vector<bool> scope_used(hdr.scopes.size(), false);
+        std::vector<bool> var_kept(hdr.vars.size(), false);
+        std::vector<bool> signal_kept(hdr.signals.size(), false);
+        for (std::size_t s = 0; !keep_all && (s < hdr.scopes.size()); s++) {
+            const auto parent = hdr.scopes[s].parent;
+            scope_all[s] = ((parent != npos) && scope_all[parent]) || any_match(options.filters, hdr.scope_path(s));
+        }
+        std::size_t kept = 0;
+        for (std::size_t v = 0; v < hdr.vars.size(); v++) {
+            const auto &var = hdr.vars[v];
+            // A variable can be declared outside any scope.
+            if (((var.scope != npos) && scope_all[var.scope]) || keep_all || any_match(options.filters, hdr.path(v))) {
+                var_kept[v] = true;
+                signal_kept[var.signal] = true;
+                kept++;
+                for (auto s = var.scope; (s != npos) && !scope_used[s]; s = hdr.scopes[s].parent) {
+                    scope_used[s] = true;
+                }
+            }
+        }
+        const bool every_signal = std::all_of(signal_kept.begin(), signal_kept.end(), [](bool k) { return k; });
+
+        // Definitions
+        write_header_section(out, "$date", hdr.date);
+        write_header_section(out, "$version", hdr.version);
+        write_header_section(out, "$timescale", hdr.timescale);
+        for (std::size_t v = 0; v < hdr.vars.size(); v++) {
+            if ((hdr.vars[v].scope == npos) && var_kept[v]) {
+                write_var(out, hdr, v);
+            }
+        }
+        for (std::size_t s = 0; s < hdr.scopes.size(); s++) {
+            if ((hdr.scopes[s].parent == npos) && scope_used[s]) {
+                write_scope(out, hdr, s, scope_used, var_kept);
+            }
+        }
+        out << "$enddefinitions $end\n";
+        if (options.end < options.begin) {
+            return kept;
+        }
+
+        // The values at the start of the window.
+        const auto start = seek(t, index, options.begin);
+        out << "#" << options.begin << "\n$dumpvars\n";
+        for (std::size_t s = 0; s < hdr.signals.size(); s++) {
+            if (signal_kept[s] && !start.values[s].empty()) {
+                write_change(out, start.values[s], hdr.signals[s].identifier);
+            }
+        }
+        out << "$end\n";
+
+        // The changes after the start of the window.
+        std::size_t from = static_cast<std::size_t>(start.offset);
+        std::size_t until = data.size();
+        if (options.end != std::numeric_limits<std::uint64_t>::max()) {
+            std::size_t search = from;
+            if ((index != nullptr) && (index->entry_count() > 0)) {
+                const auto e = index->find(options.end);
+                if (e != npos) {
+                    search = std::max(search, static_cast<std::size_t>(index->entry(e).offset));
+                }
+            }
+            until = find_time(t, options.end, search);
+        }
+        if (from < until) {
+            if (every_signal) {
+                out.write(data.data() + from, static_cast<std::streamsize>(until - from));
+            }
+            else {
+                change_cursor cursor(hdr, data.data() + from, data.data() + until, options.begin, data.data());
+                value_change change;
+                std::uint64_t time = options.begin;
+                while (cursor.next(change)) {
+                    if (signal_kept[change.signal]) {
+                        if (change.time != time) {
+                            time = change.time;
+                            out << "#" << time << "\n";
+                        }
+                        write_change(out, change.value, hdr.signals[change.signal].identifier);
+                    }
+                }
+            }
+        }
+        if (until < data.size()) {
+            // Mark the end of the window.
+            out << "#" << options.end << "\n";
+        }
+        return kept;
+    }
+
+}// namespace vcd_tracer::reader
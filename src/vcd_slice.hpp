@@ -0,0 +1,67 @@
+/*
+ *  C++ VCD Tracer Library - Trace Slicing
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "vcd_index_reader.hpp"
+#include "vcd_reader.hpp"
+
+#ifndef VCD_SLICE_HPP
+#define VCD_SLICE_HPP
+
+namespace vcd_tracer::reader {
+
+    /** What to keep of a trace.
+     */
+    struct slice_options {
+        //! The first time to keep, in timescale units.
+        std::uint64_t begin{ 0 };
+        //! The last time to keep, in timescale units.
+        std::uint64_t end{ std::numeric_limits<std::uint64_t>::max() };
+        /** Hierarchical paths of the variables to keep, such as "root.lsu" or "root.*.addr".
+            A pattern that matches a scope keeps everything in that scope.
+            Patterns use '*' and '?' wildcards. With no patterns every variable is kept.
+        */
+        std::vector<std::string> filters;
+    };
+
+    /** Check if a hierarchical path matches a slice filter.
+        @param pattern A pattern with '*' and '?' wildcards, '*' also matches '.'.
+        @param path    A path such as "root.bus.addr".
+    */
+    [[nodiscard]] bool path_matches(std::string_view pattern, std::string_view path);
+
+    /** Write a smaller, valid, trace from a time window and a subset of the signals.
+
+        The slice starts with a $dumpvars of the values at the start of the
+        window. When every signal is kept the changes in the window are copied
+        as they are, otherwise only the changes of the kept signals are
+        written. With an index only the trace from the checkpoint before the
+        window is read.
+
+        @param t       The trace to slice.
+        @param index   An index of the trace, or nullptr.
+        @param options The time window and filter.
+        @param out     The sliced trace.
+        @retval The number of variables kept.
+        @throw parse_error If the trace is malformed.
+    */
+    std::size_t slice(const trace &t, const trace_index *index, const slice_options &options, std::ostream &out);
+
+}// namespace vcd_tracer::reader
+
+#endif
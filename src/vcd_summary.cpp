@@ -0,0 +1,196 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Summary Pyramid
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "vcd_bytes.hpp"
+#include "vcd_index.hpp"
+#include "vcd_summary.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        //! Compare two values, as doubles for reals.
+        bool less_than(bool is_real, std::uint64_t a, std::uint64_t b) {
+            if (is_real) {
+                double x = 0;
+                double y = 0;
+                std::memcpy(&x, &a, sizeof(x));
+                std::memcpy(&y, &b, sizeof(y));
+                return x < y;
+            }
+            return a < b;
+        }
+
+        using detail::append_u64;
+    }// namespace
+
+    summary_writer::summary_writer(std::ostream &summary, summary_options options)
+        : _summary(summary), _options(options) {
+        _options.bucket = std::max<std::uint64_t>(1, _options.bucket);
+        _options.factor = std::max<std::uint64_t>(2, _options.factor);
+        _options.levels = std::max<std::size_t>(1, _options.levels);
+    }
+
+    trace_observer summary_writer::observer(void) {
+        trace_observer o;
+        o.on_header = [this](std::ostream &, const std::vector<std::string> &identifiers, const std::vector<std::string> &) {
+            on_header(identifiers);
+        };
+        o.on_time = [this](std::ostream &, scope_fn::sequence_t time) { on_time(time); };
+        o.on_change = [this](const raw_change &change) { on_change(change); };
+        o.on_finalize = [this](std::ostream &) { on_finalize(); };
+        return o;
+    }
+
+    void summary_writer::put_bytes(const char *data, std::size_t size) {
+        _summary.write(data, static_cast<std::streamsize>(size));
+        _written += size;
+    }
+
+    void summary_writer::put_u64(std::uint64_t v) {
+        const auto bytes = detail::le_u64(v);
+        put_bytes(bytes.data(), bytes.size());
+    }
+
+    void summary_writer::on_header(const std::vector<std::string> &identifiers) {
+        put_bytes(summary_format::header_magic.data(), summary_format::header_magic.size());
+        put_u64(identifiers.size());
+        for (const auto &identifier : identifiers) {
+            const auto length = detail::le_u32(static_cast<std::uint32_t>(identifier.size()));
+            put_bytes(length.data(), length.size());
+            put_bytes(identifier.data(), identifier.size());
+        }
+        put_u64(_options.levels);
+        _levels.assign(_options.levels, level_data{});
+        std::uint64_t length = _options.bucket;
+        for (auto &l : _levels) {
+            l.length = length;
+            l.signals.assign(identifiers.size(), accumulator{});
+            put_u64(length);
+            length *= _options.factor;
+        }
+        _levels.front().offset = _written;
+    }
+
+    void summary_writer::flush(std::size_t n) {
+        auto &l = _levels[n];
+        std::sort(l.touched.begin(), l.touched.end());
+        for (const auto signal : l.touched) {
+            auto &acc = l.signals[signal];
+            append_u64(l.records, l.bucket);
+            for (std::size_t i = 0; i < 4; i++) {
+                l.records.push_back(static_cast<char>((signal >> (8 * i)) & 0xFF));
+            }
+            l.records.push_back(static_cast<char>(acc.first_state));
+            l.records.push_back(static_cast<char>(acc.last_state));
+            l.records.push_back(static_cast<char>(acc.is_real));
+            l.records.push_back(static_cast<char>(acc.has_range));
+            append_u64(l.records, acc.changes);
+            append_u64(l.records, acc.first);
+            append_u64(l.records, acc.last);
+            append_u64(l.records, acc.min);
+            append_u64(l.records, acc.max);
+            l.count++;
+
+            // Roll up into the next level.
+            if ((n + 1) < _levels.size()) {
+                auto &up_level = _levels[n + 1];
+                auto &up = up_level.signals[signal];
+                if (up.changes == 0) {
+                    up = acc;
+                    up_level.touched.push_back(signal);
+                }
+                else {
+                    up.changes += acc.changes;
+                    up.last_state = acc.last_state;
+                    up.last = acc.last;
+                    if (acc.has_range && !up.has_range) {
+                        up.has_range = 1;
+                        up.min = acc.min;
+                        up.max = acc.max;
+                    }
+                    else if (acc.has_range) {
+                        up.min = less_than(up.is_real, acc.min, up.min) ? acc.min : up.min;
+                        up.max = less_than(up.is_real, up.max, acc.max) ? acc.max : up.max;
+                    }
+                }
+            }
+            acc = accumulator{};
+        }
+        l.touched.clear();
+        // The finest level is written as it goes.
+        if (n == 0) {
+            put_bytes(l.records.data(), l.records.size());
+            l.records.clear();
+        }
+    }
+
+    void summary_writer::on_time(scope_fn::sequence_t time) {
+        for (std::size_t n = 0; n < _levels.size(); n++) {
+            const auto bucket = time / _levels[n].length;
+            if (bucket == _levels[n].bucket) {
+                // Coarser buckets can not have closed either.
+                break;
+            }
+            flush(n);
+            _levels[n].bucket = bucket;
+        }
+    }
+
+    void summary_writer::on_change(const raw_change &change) {
+        auto &l = _levels.front();
+        auto &acc = l.signals[change.index];
+        const auto [state, bits] = index_format::encode_change(change);
+        if (acc.changes == 0) {
+            l.touched.push_back(change.index);
+            acc.is_real = change.is_real ? 1 : 0;
+            acc.first_state = state;
+            acc.first = bits;
+        }
+        acc.changes++;
+        acc.last_state = state;
+        acc.last = bits;
+        if (state == index_format::state_known) {
+            if (!acc.has_range) {
+                acc.has_range = 1;
+                acc.min = bits;
+                acc.max = bits;
+            }
+            else {
+                acc.min = less_than(change.is_real, bits, acc.min) ? bits : acc.min;
+                acc.max = less_than(change.is_real, acc.max, bits) ? bits : acc.max;
+            }
+        }
+    }
+
+    void summary_writer::on_finalize(void) {
+        for (std::size_t n = 0; n < _levels.size(); n++) {
+            flush(n);
+        }
+        for (std::size_t n = 1; n < _levels.size(); n++) {
+            _levels[n].offset = _written;
+            put_bytes(_levels[n].records.data(), _levels[n].records.size());
+            _levels[n].records.clear();
+        }
+        for (const auto &l : _levels) {
+            put_u64(l.offset);
+            put_u64(l.count);
+        }
+        put_u64(_levels.size());
+        put_bytes(summary_format::footer_magic.data(), summary_format::footer_magic.size());
+        _summary.flush();
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,145 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Summary Pyramid
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_SUMMARY_HPP
+#define VCD_SUMMARY_HPP
+
+/**
+   Sidecar summary pyramid:
+
+   A summary file is written alongside a trace, so that a zoomed out view
+   or a search for activity reads a summary of each signal rather than
+   every change. Time is split into buckets at several levels, each level's
+   buckets are a fixed factor longer than the level below. For each bucket
+   that a signal changes in there is a record of the number of changes, the
+   first and last value, and the range of the known values.
+
+   File layout, all integers are little endian:
+
+   - Header:  "VCDSUMM1", u64 signal count, then per signal a u32 length and the identifier,
+              u64 level count, then per level the u64 bucket length in timescale units.
+   - Records: per level, finest first, per bucket then signal:
+              u64 bucket number (time / bucket length), u32 signal (in header order),
+              u8 first state, u8 last state, u8 is_real, u8 has_range, u64 changes,
+              u64 first, u64 last, u64 min, u64 max.
+              States are those of index_format, values are bits or a double.
+   - Footer:  per level u64 offset and u64 record count, u64 level count, "VCDSUMME".
+ */
+namespace vcd_tracer::summary_format {
+    //! Magic at the start of a summary file.
+    constexpr std::array<char, 8> header_magic{ 'V', 'C', 'D', 'S', 'U', 'M', 'M', '1' };
+    //! Magic at the end of a complete summary file.
+    constexpr std::array<char, 8> footer_magic{ 'V', 'C', 'D', 'S', 'U', 'M', 'M', 'E' };
+    //! Bytes per record.
+    constexpr std::size_t record_size = 56;
+    //! Bytes per level in the footer.
+    constexpr std::size_t level_size = 16;
+    //! Bytes in the footer after the levels.
+    constexpr std::size_t footer_size = 16;
+}// namespace vcd_tracer::summary_format
+
+namespace vcd_tracer {
+
+    /** Options to control the resolution of a summary.
+     */
+    struct summary_options {
+        //! The bucket length of the finest level, in timescale units.
+        std::uint64_t bucket{ 1000 };
+        //! How many buckets of a level make a bucket of the next level.
+        std::uint64_t factor{ 16 };
+        //! The number of levels.
+        std::size_t levels{ 4 };
+    };
+
+    /** Write a sidecar summary pyramid of a trace as it is written.
+
+        @code
+        std::ofstream sum("trace.vcd.sum", std::ios::binary);
+        vcd_tracer::summary_writer summary(sum);
+        dumper.add_observer(summary.observer());
+        @endcode
+
+        Changes are only accumulated into the finest level, each coarser
+        level is rolled up from the level below when a bucket closes. The
+        finest level is written as it closes, the coarser levels are held in
+        memory and written by top::finalize_trace(), they are at most
+        1/(factor-1) of the size of the finest level. The summary writer must
+        outlive the tracing.
+     */
+    class summary_writer {
+      public:
+        /** @param summary The summary output, opened in binary mode.
+            @param options Controls the bucket lengths.
+        */
+        explicit summary_writer(std::ostream &summary, summary_options options = {});
+        summary_writer(const summary_writer &) = delete;
+        summary_writer(summary_writer &&) = delete;
+        summary_writer &operator=(const summary_writer &) = delete;
+        summary_writer &operator=(summary_writer &&) = delete;
+        ~summary_writer(void) = default;
+
+        /** The functions to add to the top scope with top::add_observer().
+         */
+        trace_observer observer(void);
+
+        //! The number of records of a level.
+        [[nodiscard]] std::uint64_t record_count(std::size_t level) const { return _levels.at(level).count; }
+
+      private:
+        struct accumulator {
+            std::uint64_t changes{ 0 };
+            std::uint8_t first_state{ 0 };
+            std::uint8_t last_state{ 0 };
+            std::uint8_t is_real{ 0 };
+            std::uint8_t has_range{ 0 };
+            std::uint64_t first{ 0 };
+            std::uint64_t last{ 0 };
+            std::uint64_t min{ 0 };
+            std::uint64_t max{ 0 };
+        };
+        struct level_data {
+            std::uint64_t length{ 0 };
+            std::uint64_t bucket{ 0 };
+            std::vector<accumulator> signals;
+            // Signals with changes in the current bucket.
+            std::vector<std::uint32_t> touched;
+            std::string records;
+            std::uint64_t count{ 0 };
+            std::uint64_t offset{ 0 };
+        };
+
+        void on_header(const std::vector<std::string> &identifiers);
+        void on_time(scope_fn::sequence_t time);
+        void on_change(const raw_change &change);
+        void on_finalize(void);
+        void flush(std::size_t n);
+        void put_u64(std::uint64_t v);
+        void put_bytes(const char *data, std::size_t size);
+
+        std::ostream &_summary;
+        summary_options _options;
+        std::uint64_t _written{ 0 };
+        std::vector<level_data> _levels;
+    };
+
+}// namespace vcd_tracer
+
+#endif
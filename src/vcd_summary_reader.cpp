@@ -0,0 +1,185 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Summary Pyramid Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <utility>
+
+#include "vcd_bytes.hpp"
+#include "vcd_index.hpp"
+#include "vcd_index_reader.hpp"
+#include "vcd_summary.hpp"
+#include "vcd_summary_reader.hpp"
+
+namespace vcd_tracer::reader {
+
+    namespace {
+        using vcd_tracer::detail::get_u32;
+        using vcd_tracer::detail::get_u64;
+    }// namespace
+
+    trace_summary::trace_summary(mapped_file file)
+        : _file(std::move(file)),
+          _data(_file->data()) {
+        parse();
+    }
+
+    trace_summary::trace_summary(std::string_view data)
+        : _data(data) {
+        parse();
+    }
+
+    void trace_summary::parse(void) {
+        const auto magic_size = summary_format::header_magic.size();
+        if ((_data.size() < (magic_size + 16 + summary_format::footer_size))
+            || (_data.substr(0, magic_size) != std::string_view(summary_format::header_magic.data(), magic_size))) {
+            throw parse_error("not a trace summary", 0);
+        }
+        const std::size_t footer = _data.size() - summary_format::footer_size;
+        if (_data.substr(footer + 8, magic_size) != std::string_view(summary_format::footer_magic.data(), magic_size)) {
+            throw parse_error("incomplete trace summary", footer);
+        }
+        const auto levels = get_u64(_data, footer);
+        if (levels > (footer / summary_format::level_size)) {
+            throw parse_error("invalid trace summary levels", footer);
+        }
+        const std::size_t table = footer - (static_cast<std::size_t>(levels) * summary_format::level_size);
+
+        std::uint64_t pos = magic_size;
+        const auto signals = get_u64(_data, pos);
+        pos += 8;
+        for (std::uint64_t s = 0; s < signals; s++) {
+            if ((pos + 4) > table) {
+                throw parse_error("truncated trace summary identifiers", pos);
+            }
+            const auto length = get_u32(_data, pos);
+            pos += 4;
+            if ((pos + length) > table) {
+                throw parse_error("truncated trace summary identifiers", pos);
+            }
+            _identifiers.emplace_back(_data.substr(pos, length));
+            pos += length;
+        }
+        if (((pos + 8 + (levels * 8)) > table) || (get_u64(_data, pos) != levels)) {
+            throw parse_error("invalid trace summary levels", pos);
+        }
+        pos += 8;
+        for (std::uint64_t n = 0; n < levels; n++) {
+            const auto entry = table + (n * summary_format::level_size);
+            const auto offset = get_u64(_data, entry);
+            const auto count = get_u64(_data, entry + 8);
+            if ((offset > table) || (count > ((table - offset) / summary_format::record_size))) {
+                throw parse_error("invalid trace summary records", entry);
+            }
+            _levels.push_back({ get_u64(_data, pos + (n * 8)), offset, static_cast<std::size_t>(count) });
+        }
+    }
+
+    std::size_t trace_summary::level_for(std::uint64_t span, std::size_t buckets) const {
+        for (std::size_t n = 0; n < _levels.size(); n++) {
+            if ((span / _levels[n].length) < buckets) {
+                return n;
+            }
+        }
+        return _levels.empty() ? 0 : (_levels.size() - 1);
+    }
+
+    std::pair<std::size_t, std::size_t> trace_summary::range(std::size_t level, std::uint64_t begin, std::uint64_t end) const {
+        const auto &l = _levels.at(level);
+        const auto bucket_of = [&](std::size_t n) { return get_u64(_data, l.offset + (n * summary_format::record_size)); };
+        // First record at or after a bucket.
+        const auto lower = [&](std::uint64_t bucket) {
+            std::size_t lo = 0;
+            std::size_t hi = l.count;
+            while (lo < hi) {
+                const std::size_t mid = lo + ((hi - lo) / 2);
+                if (bucket_of(mid) < bucket) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        };
+        if (end <= begin) {
+            return { 0, 0 };
+        }
+        const auto first = lower(begin / l.length);
+        const auto last = lower(((end - 1) / l.length) + 1);
+        return { first, last };
+    }
+
+    std::vector<summary_bucket> trace_summary::buckets(std::size_t level,
+                                                       std::uint64_t begin,
+                                                       std::uint64_t end,
+                                                       const header &hdr) const {
+        std::vector<std::size_t> signals;
+        for (std::size_t s = 0; s < _identifiers.size(); s++) {
+            signals.push_back(hdr.find_signal(_identifiers[s]));
+            if (signals.back() == npos) {
+                throw parse_error("summary identifier '" + _identifiers[s] + "' is not in the trace", 0);
+            }
+        }
+        const auto &l = _levels.at(level);
+        const auto [first, last] = range(level, begin, end);
+        std::vector<summary_bucket> result;
+        result.reserve(last - first);
+        for (std::size_t n = first; n < last; n++) {
+            const auto record = l.offset + (n * summary_format::record_size);
+            const auto bucket = get_u64(_data, record);
+            const auto slot = get_u32(_data, record + 8);
+            if (slot >= signals.size()) {
+                throw parse_error("invalid trace summary signal", record);
+            }
+            const auto signal = signals[slot];
+            const auto &sig = hdr.signals[signal];
+            const auto first_state = static_cast<std::uint8_t>(_data[record + 12]);
+            const auto last_state = static_cast<std::uint8_t>(_data[record + 13]);
+            const bool is_real = _data[record + 14] != 0;
+            const bool has_range = _data[record + 15] != 0;
+            summary_bucket b;
+            b.begin = bucket * l.length;
+            b.end = b.begin + l.length;
+            b.signal = signal;
+            b.changes = get_u64(_data, record + 16);
+            b.first = format_slot(sig, first_state, is_real, get_u64(_data, record + 24));
+            b.last = format_slot(sig, last_state, is_real, get_u64(_data, record + 32));
+            if (has_range) {
+                b.min = format_slot(sig, index_format::state_known, is_real, get_u64(_data, record + 40));
+                b.max = format_slot(sig, index_format::state_known, is_real, get_u64(_data, record + 48));
+            }
+            result.push_back(std::move(b));
+        }
+        return result;
+    }
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> trace_summary::activity(std::size_t level,
+                                                                                 std::uint64_t begin,
+                                                                                 std::uint64_t end) const {
+        const auto &l = _levels.at(level);
+        const auto [first, last] = range(level, begin, end);
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> result;
+        for (std::size_t n = first; n < last; n++) {
+            const auto record = l.offset + (n * summary_format::record_size);
+            const auto time = get_u64(_data, record) * l.length;
+            const auto changes = get_u64(_data, record + 16);
+            if (result.empty() || (result.back().first != time)) {
+                result.emplace_back(time, changes);
+            }
+            else {
+                result.back().second += changes;
+            }
+        }
+        return result;
+    }
+
+}// namespace vcd_tracer::reader
@@ -0,0 +1,114 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Summary Pyramid Reader
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "vcd_reader.hpp"
+
+#ifndef VCD_SUMMARY_READER_HPP
+#define VCD_SUMMARY_READER_HPP
+
+namespace vcd_tracer::reader {
+
+    /** The summary of a signal over a bucket of time.
+     */
+    struct summary_bucket {
+        //! The first time of the bucket.
+        std::uint64_t begin{ 0 };
+        //! The first time after the bucket.
+        std::uint64_t end{ 0 };
+        //! Index of the signal, in header::signals.
+        std::size_t signal{ npos };
+        //! The number of changes in the bucket.
+        std::uint64_t changes{ 0 };
+        //! The value of the first change, formatted as a VCD value such as "b101".
+        std::string first;
+        //! The value of the last change.
+        std::string last;
+        //! The smallest known value, empty if there were only 'x' or 'z' values.
+        std::string min;
+        //! The largest known value, empty if there were only 'x' or 'z' values.
+        std::string max;
+    };
+
+    /** A sidecar summary pyramid written by vcd_tracer::summary_writer.
+     */
+    class trace_summary {
+      public:
+        /** Read a summary from a mapped file.
+            @throw parse_error If the file is not a complete summary.
+        */
+        explicit trace_summary(mapped_file file);
+        /** Read a summary from a buffer, the buffer must outlive this object.
+            @throw parse_error If the data is not a complete summary.
+        */
+        explicit trace_summary(std::string_view data);
+        trace_summary(trace_summary &&) = default;
+        trace_summary(const trace_summary &) = delete;
+        trace_summary &operator=(const trace_summary &) = delete;
+
+        //! The identifiers of the summarized signals.
+        [[nodiscard]] const std::vector<std::string> &identifiers(void) const { return _identifiers; }
+        //! The number of levels, level 0 is the finest.
+        [[nodiscard]] std::size_t level_count(void) const { return _levels.size(); }
+        //! The bucket length of a level, in timescale units.
+        [[nodiscard]] std::uint64_t bucket_length(std::size_t level) const { return _levels.at(level).length; }
+        //! The number of records of a level.
+        [[nodiscard]] std::size_t record_count(std::size_t level) const { return _levels.at(level).count; }
+
+        /** The finest level that covers a time span in at most a number of buckets,
+            such as one bucket per pixel of a view. The coarsest level if none does.
+        */
+        [[nodiscard]] std::size_t level_for(std::uint64_t span, std::size_t buckets) const;
+
+        /** The summaries of the buckets of a level that overlap [begin, end).
+            Only the records of those buckets are read.
+            @param hdr The header of the summarized trace.
+            @retval The summaries, by bucket then signal. A signal without changes in a bucket has no summary.
+            @throw parse_error If an identifier is not in the header.
+        */
+        [[nodiscard]] std::vector<summary_bucket> buckets(std::size_t level,
+                                                          std::uint64_t begin,
+                                                          std::uint64_t end,
+                                                          const header &hdr) const;
+
+        /** The number of changes of all signals in each bucket of a level that overlaps [begin, end).
+            @retval Pairs of the first time of a bucket and the number of changes, for buckets with changes.
+        */
+        [[nodiscard]] std::vector<std::pair<std::uint64_t, std::uint64_t>> activity(std::size_t level,
+                                                                                    std::uint64_t begin,
+                                                                                    std::uint64_t end) const;
+
+      private:
+        struct level_data {
+            std::uint64_t length;
+            std::uint64_t offset;
+            std::size_t count;
+        };
+        void parse(void);
+        //! The record range of a level that overlaps [begin, end).
+        [[nodiscard]] std::pair<std::size_t, std::size_t> range(std::size_t level, std::uint64_t begin, std::uint64_t end) const;
+        std::optional<mapped_file> _file;
+        std::string_view _data;
+        std::vector<std::string> _identifiers;
+        std::vector<level_data> _levels;
+    };
+
+}// namespace vcd_tracer::reader
+
+#endif
@@ -11,6 +11,7 @@
  * See LICENSE for license details.
  */
 
+#include <algorithm>
 #include <cmath>
 #include <iomanip>
 #include <type_traits>
@@ -59,15 +60,18 @@ namespace vcd_tracer {
     void module::finalize_header(std::ostream &out) {
         if (_context != nullptr) {
             finalize_header(out, _context);
+            // The declarations are written, keep the name so a retired variable can be elaborated again at the same path.
+            _context->vcd_scope.str({});
+            _context->children.clear();
         }
-        _context.reset();
     }
 
     void module::finalize_header(
         std::ostream &out,
-        std::shared_ptr<const module_instance> context) {
+        const std::shared_ptr<module_instance> &context) {
         // Module and var definitions have been done, collect the
         // submodules and end the definition.
+        context->header_written = true;
         out << context->vcd_scope.str();
         for (const auto &child : context->children) {
             finalize_header(out, child);
@@ -84,17 +88,49 @@ namespace vcd_tracer {
             // This function will register any variable in the child
             // hierarchy with this top module.
             [identifier_generator = _identifier_generator, var_map = _var_map](const std::string_view full_path,
+                                                                               const std::string_view var_type,
+                                                                               const unsigned int bit_size,
                                                                                scope_fn::dumper_fn fn) -> value_context {
-                // Allocate a new identifier
-                const std::string identifier = identifier_generator->next();
+                std::string identifier;
+                std::uint32_t index = 0;
+                const auto retired = var_map->retired.find(full_path);
+                // The declaration of a retired variable is only reused for a variable of the same type and size.
+                const bool reused = (retired != var_map->retired.end())
+                                    && (retired->second.var_type == var_type)
+                                    && (retired->second.bit_size == bit_size);
+                if (!reused && var_map->header_written) {
+                    // A new identifier would not be declared.
+                    throw std::logic_error("variable " + std::string(full_path) + " elaborated after the header is written");
+                }
+                if (reused) {
+                    // Carry on the trace of a retired variable at the same path, it is already declared.
+                    identifier = retired->second.identifier;
+                    index = retired->second.index;
+                    var_map->retired.erase(retired);
+                    auto &retiring = var_map->retiring;
+                    retiring.erase(std::remove(retiring.begin(), retiring.end(), identifier), retiring.end());
+                }
+                else {
+                    // Allocate a new identifier
+                    identifier = identifier_generator->next();
+                    index = static_cast<std::uint32_t>(var_map->identifiers.size());
+                    var_map->identifiers.push_back(identifier);
+                    var_map->paths.emplace_back(full_path);
+                }
                 // Register this new varaible - the path and function to write values to the trace.
-                var_map->identifier_map[identifier] = full_path;
                 var_map->dumper_map[identifier] = fn;
                 // Create a function that allows the registration in this class to be reset by the variable destructor.
                 auto updater = [identifier, var_map](scope_fn::dumper_fn fn) -> void {
                     var_map->dumper_map[identifier] = fn;
                 };
-                return value_context{ identifier, updater };
+                // The final state is traced once, then time_update_core() removes the variable.
+                auto retire = [identifier, index, path = std::string(full_path), type = std::string(var_type), bit_size, var_map](scope_fn::dumper_fn final_fn) -> void {
+                    var_map->dumper_map[identifier] = std::move(final_fn);
+                    var_map->retiring.push_back(identifier);
+                    var_map->retired[path] = { identifier, index, type, bit_size };
+                };
+                const scope_fn::change_fn *observer = (index < var_map->observed) ? &var_map->observer : nullptr;
+                return value_context{ identifier, updater, index, observer, retire, reused };
             },
             name) {
     }
@@ -104,6 +140,11 @@ namespace vcd_tracer {
                        bool force,
                        std::string_view reason) {
         if (force || (new_time != _tracepoint)) {
+            for (const auto &observer : _observers) {
+                if (observer.on_time) {
+                    observer.on_time(out, new_time);
+                }
+            }
             // Insert a new time point into the VCD trace.
             out << "#" << new_time << "\n";
             _tracepoint = new_time;
@@ -122,6 +163,26 @@ namespace vcd_tracer {
 
 
     void top::finalize_header(std::ostream &out, std::chrono::time_point<std::chrono::system_clock> date) {
+        write_header(out, date);
+        start_trace(out);
+    }
+
+    void top::start_deferred(std::ostream &out, std::chrono::time_point<std::chrono::system_clock> date) {
+        for (const auto &observer : _observers) {
+            if (observer.uses_offsets) {
+                // The length of the header is not known until the trace is finalized.
+                throw std::logic_error("an observer that records trace offsets can not follow a deferred header");
+            }
+        }
+        _date = date;
+        start_trace(out);
+    }
+
+    void top::write_deferred_header(std::ostream &out) {
+        write_header(out, _date);
+    }
+
+    void top::write_header(std::ostream &out, std::chrono::time_point<std::chrono::system_clock> date) {
         // Create the VCD header
         std::time_t start_time = std::chrono::system_clock::to_time_t(date);
         out << "$date\n"
@@ -134,11 +195,30 @@ namespace vcd_tracer {
         // Write out the design hierarchy
         root.finalize_header(out);
         out << "$enddefinitions $end\n";
+        _var_map->header_written = true;
+    }
+
+    void top::start_trace(std::ostream &out) {
+        _var_map->observed = _var_map->identifiers.size();
+        for (const auto &observer : _observers) {
+            if (observer.on_header) {
+                observer.on_header(out, _var_map->identifiers, _var_map->paths);
+            }
+        }
         // Default values
         log_time(out, 0, true, "finalize header");
         // Log the initial state
         _timestamp = 0;
         time_update_core(out);
+        end_update(out);
+    }
+
+    void top::end_update(std::ostream &out) {
+        for (const auto &observer : _observers) {
+            if (observer.on_update) {
+                observer.on_update(out);
+            }
+        }
     }
 
     void top::time_update_delta(std::ostream &out, time_base delta) {
@@ -147,6 +227,7 @@ namespace vcd_tracer {
         }
         // Log out the updated variables
         time_update_core(out);
+        end_update(out);
         // Now the variables have been dumped to capture the state UP TO this time
         // log the time
         const auto delta_count = delta.count();
@@ -168,6 +249,7 @@ namespace vcd_tracer {
         }
         // Log out the updated variables
         time_update_core(out);
+        end_update(out);
         // Now the variables have been dumped to capture the state UP TO this time
         // log the time
         auto new_timestamp_count = new_timestamp.count();
@@ -217,6 +299,11 @@ namespace vcd_tracer {
                 }
             }
         }
+        // Retired variables have traced their final state.
+        for (const auto &identifier : _var_map->retiring) {
+            _var_map->dumper_map.erase(identifier);
+        }
+        _var_map->retiring.clear();
         if constexpr (SIMPLE_VCD_DEBUG) {
             out << "$comment second pass " << status.size() << " $end\n";
         }
@@ -260,11 +347,92 @@ namespace vcd_tracer {
         time_update_delta(out, std::chrono::nanoseconds(1));
         // Allow some time at the end for viewing the final value
         time_update_delta(out, std::chrono::microseconds(1));
+        for (const auto &observer : _observers) {
+            if (observer.on_finalize) {
+                observer.on_finalize(out);
+            }
+        }
+    }
+
+    void top::add_observer(trace_observer observer) {
+        _observers.push_back(std::move(observer));
+        // Only install a change observer when one is needed, values skip an empty function.
+        std::vector<scope_fn::change_fn> change_fns;
+        for (const auto &o : _observers) {
+            if (o.on_change) {
+                change_fns.push_back(o.on_change);
+            }
+        }
+        if (change_fns.size() == 1) {
+            _var_map->observer = change_fns.front();
+        }
+        else if (!change_fns.empty()) {
+            _var_map->observer = [change_fns](const raw_change &change) {
+                for (const auto &fn : change_fns) {
+                    fn(change);
+                }
+            };
+        }
+    }
+
+    void top::subscribe(std::function<bool(std::string_view path)> filter,
+                        std::function<void(const change_batch &batch)> fn) {
+        struct subscription {
+            std::function<bool(std::string_view path)> filter;
+            std::function<void(const change_batch &batch)> fn;
+            // Set for each selected variable, by index.
+            std::vector<bool> selected;
+            // The changes of this time update, reused so there is no allocation once it has grown.
+            std::vector<change_record> records;
+            scope_fn::sequence_t time{ 0 };
+        };
+        auto state = std::make_shared<subscription>();
+        state->filter = std::move(filter);
+        state->fn = std::move(fn);
+        trace_observer observer;
+        observer.on_header = [state](std::ostream &, const std::vector<std::string> &, const std::vector<std::string> &paths) {
+            state->selected.resize(paths.size());
+            for (std::size_t i = 0; i < paths.size(); i++) {
+                state->selected[i] = !state->filter || state->filter(paths[i]);
+            }
+        };
+        // Changes are traced at the last time written.
+        observer.on_time = [state](std::ostream &, scope_fn::sequence_t time) { state->time = time; };
+        observer.on_change = [state](const raw_change &change) {
+            if ((change.index < state->selected.size()) && state->selected[change.index]) {
+                state->records.push_back(change_record{ state->time, change.index, change.state, change.is_real, change.bits, change.real });
+            }
+        };
+        observer.on_update = [state](std::ostream &) {
+            if (!state->records.empty()) {
+                state->fn(change_batch{ state->records.data(), state->records.size() });
+                state->records.clear();
+            }
+        };
+        add_observer(std::move(observer));
     }
 
     // ------------------------------------------------------------------------
     // Value
 
+    scope_fn::dumper_fn value_base::final_dump(void) const {
+        return [identifier = _scope.identifier,
+                bit_size = _bit_size,
+                real = (std::string_view(_var_type) == "real"),
+                index = _scope.index,
+                observer = _scope.observer](std::ostream &out, bool start) -> scope_fn::dump_sequence_t {
+            (void)start;
+            // VCD has no unknown real, a real keeps it's last value.
+            if (!real) {
+                out << ((bit_size == 1) ? "x" : "bx ") << identifier << "\n";
+                if ((observer != nullptr) && *observer) {
+                    (*observer)(raw_change{ index, value_state::unknown_x, false, 0, 0.0 });
+                }
+            }
+            return scope_fn::end_sequence;
+        };
+    }
+
     template<typename T>
     void value_base::dump(std::ostream &out,
                           const size_t bit_size,
@@ -305,8 +473,8 @@ namespace vcd_tracer {
                 for (int i = bit_size - 2; i >= 0; i--) {
                     mask = mask >> 1;
                     const bool this_bit = (value & mask) != 0;
-                    if (compress && (this_bit == prev_bit)) {
-                        // Compress the left bits until a change is present..
+                    if (compress && !prev_bit && !this_bit) {
+                        // Compress the leading zeros, VCD extends a vector to the left with 0.
                     }
                     else {
                         compress = false;
@@ -318,6 +486,17 @@ namespace vcd_tracer {
             }
             out << " " << _scope.identifier << "\n";
         }
+        if ((_scope.observer != nullptr) && *_scope.observer) {
+            raw_change change{ _scope.index, state, std::is_floating_point_v<T>, 0, 0.0 };
+            if constexpr (std::is_floating_point_v<T>) {
+                change.real = static_cast<double>(value);
+            }
+            else {
+                const std::uint64_t mask = (bit_size >= 64) ? ~std::uint64_t{ 0 } : ((std::uint64_t{ 1 } << bit_size) - 1);
+                change.bits = static_cast<std::uint64_t>(value) & mask;
+            }
+            (*_scope.observer)(change);
+        }
     }
 
     // ------------------------------------------------------------------------
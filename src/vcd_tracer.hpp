@@ -14,12 +14,15 @@
 #include <chrono>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #ifndef SIMPLE_VCD_HPP
 #define SIMPLE_VCD_HPP
@@ -74,15 +77,21 @@ namespace vcd_tracer {
         using dumper_fn = std::function<dump_sequence_t(std::ostream &, bool)>;
         //! The type signature of a function used to ??
         using updater_fn = std::function<void(dumper_fn fn)>;
+        //! The type signature of a function used to retire a variable, with a function that dumps it's final state once.
+        using retire_fn = std::function<void(dumper_fn final_fn)>;
+        //! The type signature of a function used to observe value changes as they are traced.
+        using change_fn = std::function<void(const struct raw_change &change)>;
         //! The type signature of a function used to add a variable to be traced. The parameter define the information reqired VCD by a VCD header.
         using add_fn = std::function<
             struct value_context(std::string_view var_name,
                                  std::string_view var_type,
                                  unsigned int bit_size,
                                  dumper_fn fn)>;
-        //! The type signature of a function used to register a variable and it's dumper.
+        //! The type signature of a function used to register a variable and it's dumper, with it's VCD type and size.
         using register_fn = std::function<
             struct value_context(std::string_view var_name,
+                                 std::string_view var_type,
+                                 unsigned int bit_size,
                                  dumper_fn fn)>;
         //! A constant to represent the end of a set of variables to be dumped.
         static constexpr dump_sequence_t end_sequence{ {}, {} };
@@ -107,6 +116,14 @@ namespace vcd_tracer {
         std::string identifier;
         //! The update function of the value.
         scope_fn::updater_fn updater;
+        //! The index of the value, in order of registration with the top scope.
+        std::uint32_t index{ 0 };
+        //! Observer of traced changes, owned by the top scope. May be null or empty.
+        const scope_fn::change_fn *observer{ nullptr };
+        //! Remove the value from the trace when it is destroyed. May be empty.
+        scope_fn::retire_fn retire{};
+        //! Set if the identifier of a retired value at the same path is reused, so it is already declared.
+        bool reused{ false };
     };
 
 
@@ -129,6 +146,8 @@ namespace vcd_tracer {
         std::ostringstream vcd_scope;
         //! The children of this module instance.
         std::vector<std::shared_ptr<class module_instance>> children;
+        //! Set once the declarations of this module instance are written.
+        bool header_written{ false };
     };
 
     /** A type trait like structure used to determine the size in bits of a C++ type.
@@ -190,6 +209,50 @@ namespace vcd_tracer {
         known,
     };
 
+    /** A value change in it's raw, unformatted, form.
+        This is passed to observers of the trace as each change is written.
+     */
+    struct raw_change {
+        //! The index of the value, in order of registration with the top scope.
+        std::uint32_t index;
+        //! The state of the value.
+        value_state state;
+        //! Set if the value is real, and so stored in real rather than bits.
+        bool is_real;
+        //! The integer value, masked to the bit size.
+        std::uint64_t bits;
+        //! The real value.
+        double real;
+    };
+
+    /** A value change with the time it was traced at.
+        Batches of these are passed to subscribers of the trace, see top::subscribe().
+     */
+    struct change_record {
+        //! The time of the change, in the time base of the trace.
+        scope_fn::sequence_t time;
+        //! The index of the value, in order of registration with the top scope.
+        std::uint32_t index;
+        //! The state of the value.
+        value_state state;
+        //! Set if the value is real, and so stored in real rather than bits.
+        bool is_real;
+        //! The integer value, masked to the bit size.
+        std::uint64_t bits;
+        //! The real value.
+        double real;
+    };
+
+    /** A contiguous run of change records, only valid during the call it is passed to.
+     */
+    struct change_batch {
+        const change_record *data;
+        std::size_t size;
+        [[nodiscard]] const change_record *begin(void) const { return data; }
+        [[nodiscard]] const change_record *end(void) const { return data + size; }
+        [[nodiscard]] const change_record &operator[](std::size_t i) const { return data[i]; }
+    };
+
     /** A structure to represent a sample that has been traced with state and sequence context.
         - The state can be set directly, or determined to me known when a value is set.
         - The sequence is recorded from a global sequence number.
@@ -265,11 +328,17 @@ namespace vcd_tracer {
         value_base &operator=(const value_base &) = delete;
 
         /** Clean up a traced variable
+            The value is retired, it is traced as unknown (X) at the next time update and then removed from the trace.
          */
         virtual ~value_base(void) {
-            // Make sure the dumper function is invalidated so the
-            // disposed of dumper function is not called.
-            _scope.updater(scope_fn::nop_dump);
+            if (_scope.retire) {
+                _scope.retire(final_dump());
+            }
+            else {
+                // Make sure the dumper function is invalidated so the
+                // disposed of dumper function is not called.
+                _scope.updater(scope_fn::nop_dump);
+            }
         }
 
         /** Assign this trace variable to the unknown (X) state
@@ -310,7 +379,7 @@ namespace vcd_tracer {
                    scope_fn::add_fn add_fn,
                    const std::string_view var_name,
                    scope_fn::dumper_fn dumper_fn)
-            : _scope(add_fn(var_name, var_type, bit_size, dumper_fn)) {
+            : _scope(add_fn(var_name, var_type, bit_size, dumper_fn)), _bit_size(bit_size), _var_type(var_type) {
         }
         /** Create a new value to be traced without defining it at compile time.
             @param bit_size  The size, in bits, of this value.
@@ -319,8 +388,7 @@ namespace vcd_tracer {
         */
         value_base(unsigned int bit_size)
             // Define a default do nothing trace context
-            : _scope{ "", scope_fn::nop_update } {
-            (void)bit_size;
+            : _scope{ "", scope_fn::nop_update }, _bit_size(bit_size) {
         }
 
         /**
@@ -337,14 +405,31 @@ namespace vcd_tracer {
             auto new_scope = add_fn(var_name, var_type, bit_size, dumper_fn);
             _scope.identifier = new_scope.identifier;
             _scope.updater = new_scope.updater;
+            _scope.index = new_scope.index;
+            _scope.observer = new_scope.observer;
+            _scope.retire = new_scope.retire;
+            _bit_size = bit_size;
+            _var_type = var_type;
         }
 
       public:
+        //! The VCD identifier, empty until the value is elaborated.
+        [[nodiscard]] const std::string &identifier(void) const { return _scope.identifier; }
+        //! The size, in bits, of this value.
+        [[nodiscard]] unsigned int bit_size(void) const { return _bit_size; }
+        //! The VCD var type, such as "wire".
+        [[nodiscard]] const char *var_type(void) const { return _var_type; }
+
       protected:
         // This is the context required to trace the variable.
         value_context _scope;
+        // The declaration of the variable, for aliases.
+        unsigned int _bit_size{ 0 };
+        const char *_var_type{ "wire" };
 
       protected:
+        // A dumper function that does not refer to this value, to trace it's final state.
+        [[nodiscard]] scope_fn::dumper_fn final_dump(void) const;
         // A common dumper function.
         template<typename T>
         void dump(std::ostream &out, 
@@ -568,6 +653,7 @@ namespace vcd_tracer {
                std::string_view instance_name) :_register_fn{ parent.get_register_fn() },
             _context{ std::make_shared<module_instance>(instance_name) } {
             _context->vcd_scope << "$scope module " << instance_name << " $end\n";
+            _context->header_written = parent._context->header_written;
             parent._context->children.push_back(_context);
         }
 
@@ -583,6 +669,7 @@ namespace vcd_tracer {
             _context{ std::make_shared<module_instance>(instance_name) } {
             _context->vcd_scope << "$scope module " << instance_name << " $end\n";
             if (auto use_parent_context = parent_context.lock()) {
+                _context->header_written = use_parent_context->header_written;
                 use_parent_context->children.push_back(_context);
             }
         }
@@ -596,6 +683,27 @@ namespace vcd_tracer {
             var.elaborate(get_add_fn(), var_name);
         }
 
+        /** Declare another name for a trace variable within this module.
+            The alias shares the identifier of the variable, so each change is only written once.
+            @param var A trace variable already elaborated, in any module.
+            @param var_name The name of the alias.
+            @throws std::logic_error If the header is written, the alias would not be declared.
+        */
+        void alias(const value_base &var, const std::string_view var_name) {
+            if (var.identifier().empty()) {
+                throw std::invalid_argument("alias of a value that has not been elaborated");
+            }
+            if (_context->header_written) {
+                throw std::logic_error("alias " + std::string(var_name) + " declared after the header is written");
+            }
+            _context->vcd_scope
+                << "$var " << var.var_type()
+                << " " << var.bit_size()
+                << " " << var.identifier()
+                << " " << var_name
+                << " $end\n";
+        }
+
         /** Get the function to be provided to a trace variable declaration to give it scoped withing this module instance
          */
         [[nodiscard]] scope_fn::add_fn get_add_fn(void) {
@@ -632,16 +740,20 @@ namespace vcd_tracer {
 
       private:
         void finalize_header(std::ostream &out,
-                             std::shared_ptr<const module_instance> context);
+                             const std::shared_ptr<module_instance> &context);
 
         /** A function that can be passed to a new trace variable to declare it within the scope of this module instance
+            @throws std::logic_error If the header is written, and the variable does not carry on a retired variable of the same path, type and size.
          */
         [[nodiscard]] value_context add_var(std::string_view var_name,
                                             std::string_view var_type,
                                             const unsigned int bit_size,
                                             scope_fn::dumper_fn fn) {
             std::string child_path = _context->instance_name + "." + std::string(var_name);
-            auto value_context = _register_fn(child_path, fn);
+            auto value_context = _register_fn(child_path, var_type, bit_size, fn);
+            if (value_context.reused) {
+                return value_context;
+            }
             _context->vcd_scope
                 << "$var " << var_type
                 << " " << bit_size
@@ -654,22 +766,49 @@ namespace vcd_tracer {
          */
         [[nodiscard]] scope_fn::register_fn get_register_fn(void) {
             return [this](std::string_view child_path,
+                          std::string_view var_type,
+                          const unsigned int bit_size,
                           scope_fn::dumper_fn fn) -> value_context {
-                return this->register_var(child_path, fn);
+                return this->register_var(child_path, var_type, bit_size, fn);
             };
         }
         /** Get the function that can be used to register a variable within this module
             @param child_path The path of the variable. It will be added to the full instance path to be registered at the next level.
+            @param var_type   The VCD type of the variable.
+            @param bit_size   The size of the variable in bits.
             @param fn         The function that will be used to dump a given variable to file.
         */
         [[nodiscard]] value_context register_var(std::string_view child_path,
+                                                 std::string_view var_type,
+                                                 const unsigned int bit_size,
                                                  scope_fn::dumper_fn fn) {
             std::string this_path = _context->instance_name + "." + std::string(child_path);
-            auto value_context = _register_fn(this_path, fn);
+            auto value_context = _register_fn(this_path, var_type, bit_size, fn);
             return value_context;
         }
     };// module
 
+    /** Functions to follow a trace as it is written, such as to write a sidecar file.
+        Any function can be left empty.
+     */
+    struct trace_observer {
+        //! Called once the header has been written, with the identifiers and hierarchical paths in order of registration.
+        std::function<void(std::ostream &out,
+                           const std::vector<std::string> &identifiers,
+                           const std::vector<std::string> &paths)>
+            on_header;
+        //! Called before a timestamp is written.
+        std::function<void(std::ostream &out, scope_fn::sequence_t time)> on_time;
+        //! Called after each value change is written.
+        scope_fn::change_fn on_change;
+        //! Called at the end of each time update, once it's changes are written.
+        std::function<void(std::ostream &out)> on_update;
+        //! Called when the trace is finalized.
+        std::function<void(std::ostream &out)> on_finalize;
+        //! Set if the observer records byte offsets of the trace with tellp(), so it can not follow a deferred body.
+        bool uses_offsets{ false };
+    };
+
     /** A class to represent the top scope of a trace.
 
         This will corrospond to a single VCD trace file.
@@ -695,6 +834,22 @@ namespace vcd_tracer {
         */
         void finalize_header(std::ostream &out,
                              std::chrono::time_point<std::chrono::system_clock> date);
+
+        /** Start tracing without writing the header, so trace variables can still be added.
+            The body is written to out, and write_deferred_header() writes the header for it
+            once the trace is finalized. A deferred_file puts the two together.
+            Observers only follow the variables added before this is called.
+            @param out Trace body output.
+            @param date The date to be set in the header $date field.
+            @throws std::logic_error If an observer records byte offsets, they would be relative to the body.
+        */
+        void start_deferred(std::ostream &out,
+                            std::chrono::time_point<std::chrono::system_clock> date);
+
+        /** Write the header of a trace started with start_deferred(), with every trace variable added.
+            @param out Header output.
+        */
+        void write_deferred_header(std::ostream &out);
         /** Update the timestamp of the trace with a delta time to the previous timestamp
             This will result in an output to the trace file of the stored data.
             @param out Trace output.
@@ -714,18 +869,60 @@ namespace vcd_tracer {
         */
         void finalize_trace(std::ostream &out);
 
+        /** Follow the trace as it is written.
+            Observers should be added before values are traced.
+            @param observer The functions to call.
+        */
+        void add_observer(trace_observer observer);
+
+        /** Receive the changes of some variables in one batch per time update, from the same
+            change detection that writes the trace, so there is nothing to format or parse.
+            Subscribers are observers, so they should be added before the header is finalized.
+            @param filter Select the variables by hierarchical path, empty for every variable.
+            @param fn     Called at the end of each time update with changes, in the order they were traced.
+        */
+        void subscribe(std::function<bool(std::string_view path)> filter,
+                       std::function<void(const change_batch &batch)> fn);
+
       private:
 
+        // Every identifier stays declared for the whole trace, so the identifiers, paths and retired
+        // paths are bounded by the variables in the header. Only the dumper map shrinks as values retire.
         struct map_data {
-            // Map identifiers to variable names
-            std::map<std::string, std::string> identifier_map;
             // Map idenfiers to dump functions.
             std::map<std::string, scope_fn::dumper_fn> dumper_map;
+            // Identifiers in order of registration.
+            std::vector<std::string> identifiers;
+            // Hierarchical paths in order of registration.
+            std::vector<std::string> paths;
+            // A variable that has been retired, it's declaration can be reused by a new variable at the same path.
+            struct retired_var {
+                std::string identifier;
+                std::uint32_t index;
+                std::string var_type;
+                unsigned int bit_size;
+            };
+            // Retired variables by path.
+            std::map<std::string, retired_var, std::less<>> retired;
+            // Identifiers to remove from the dumper map once their final state is traced.
+            std::vector<std::string> retiring;
+            // Observer of value changes, shared with every value.
+            scope_fn::change_fn observer;
+            // The number of variables given to the observers, variables registered later are not observed.
+            std::size_t observed{ std::numeric_limits<std::size_t>::max() };
+            // Set once the header is written, only a retired variable can be registered again.
+            bool header_written{ false };
         } ;
 
       private:
         /** This function will do the bulk of the dumping af variables. */
         void time_update_core(std::ostream &out);
+        /** Write the header, up to $enddefinitions. */
+        void write_header(std::ostream &out, std::chrono::time_point<std::chrono::system_clock> date);
+        /** Pass the variables to the observers and trace the initial values. */
+        void start_trace(std::ostream &out);
+        /** Tell the observers a time update is complete. */
+        void end_update(std::ostream &out);
 
       private:
         // The most recently traced time
@@ -738,6 +935,10 @@ namespace vcd_tracer {
         std::shared_ptr<identifier_generator> _identifier_generator = std::make_shared<identifier_generator>();
         // Mapping of registers to identifiers and functions
         std::shared_ptr<map_data> _var_map = std::make_shared<map_data>();
+        // Followers of the trace.
+        std::vector<trace_observer> _observers;
+        // The date of a trace with a deferred header.
+        std::chrono::time_point<std::chrono::system_clock> _date;
 
       public : 
         //! The root module in the design hiearchy
@@ -0,0 +1,145 @@
+/*
+ *  C++ VCD Tracer Library - Cycle Counter Timestamps
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "vcd_tsc.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        // The 32.32 fixed point scale is worked in 32 bit halves, so that 32 bit targets without a 128 bit type can use it.
+
+        //! The low 64 bits of (a * b) >> 32.
+        std::uint64_t mul_shift32(std::uint64_t a, std::uint64_t b) {
+            const std::uint64_t a_hi = a >> 32U;
+            const std::uint64_t a_lo = a & 0xFFFFFFFFU;
+            const std::uint64_t b_hi = b >> 32U;
+            const std::uint64_t b_lo = b & 0xFFFFFFFFU;
+            return ((a_hi * b_hi) << 32U) + (a_hi * b_lo) + (a_lo * b_hi) + ((a_lo * b_lo) >> 32U);
+        }
+
+        //! The low 64 bits of (a << 32) / b, by long division of the 32 fraction bits.
+        std::uint64_t shift32_div(std::uint64_t a, std::uint64_t b) {
+            std::uint64_t quotient = a / b;
+            std::uint64_t remainder = a % b;
+            for (unsigned int bit = 0; bit < 32; bit++) {
+                // remainder < b, so doubling it overflows only when it is also at least b.
+                quotient <<= 1U;
+                if (remainder >= b - remainder) {
+                    remainder -= b - remainder;
+                    quotient |= 1U;
+                }
+                else {
+                    remainder <<= 1U;
+                }
+            }
+            return quotient;
+        }
+    }// namespace
+
+    tsc_clock::tsc_clock(tsc_options options)
+        : _options(options),
+          _hardware(options.hardware && counter_is_invariant()),
+          _base_ticks(ticks()),
+          _base_time(std::chrono::steady_clock::now()) {
+        if (!_hardware) {
+            // steady_clock ticks are already in the time base.
+            _scale.store(std::uint64_t{ 1 } << 32U, std::memory_order_release);
+            return;
+        }
+        _thread = std::thread([this](void) { run(); });
+    }
+
+    tsc_clock::~tsc_clock(void) {
+        {
+            const std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _changed.notify_all();
+        if (_thread.joinable()) {
+            _thread.join();
+        }
+    }
+
+    top::time_base tsc_clock::to_time(rep ticks) const {
+        auto scale = _scale.load(std::memory_order_acquire);
+        if (scale == 0) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _changed.wait(lock, [this](void) { return _scale.load(std::memory_order_acquire) != 0; });
+            scale = _scale.load(std::memory_order_acquire);
+        }
+        // Readings from before the clock was created are at time 0.
+        const rep elapsed = (ticks > _base_ticks) ? (ticks - _base_ticks) : 0;
+        const auto time = mul_shift32(elapsed, scale);
+        return top::time_base(static_cast<top::time_base::rep>(time));
+    }
+
+    double tsc_clock::ticks_per_second(void) const {
+        const auto scale = _scale.load(std::memory_order_acquire);
+        if (scale == 0) {
+            return 0.0;
+        }
+        const double per_second = static_cast<double>(std::chrono::duration_cast<top::time_base>(std::chrono::seconds(1)).count());
+        return per_second * 4294967296.0 / static_cast<double>(scale);
+    }
+
+    bool tsc_clock::counter_is_invariant(void) {
+#if defined(__x86_64__) || defined(__i386__)
+        // CPUID 0x80000007 EDX bit 8, the TSC runs at a constant rate in every P, C and T state.
+        unsigned int eax = 0;
+        unsigned int ebx = 0;
+        unsigned int ecx = 0;
+        unsigned int edx = 0;
+        if ((__get_cpuid_max(0x80000000U, nullptr) < 0x80000007U) || (__get_cpuid(0x80000007U, &eax, &ebx, &ecx, &edx) == 0)) {
+            return false;
+        }
+        return (edx & (1U << 8U)) != 0;
+#elif defined(__aarch64__)
+        // The generic timer runs at a constant rate.
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void tsc_clock::calibrate(void) {
+        const auto counter = ticks();
+        const auto now = std::chrono::steady_clock::now();
+        const auto elapsed_ticks = counter - _base_ticks;
+        const auto elapsed_time = std::chrono::duration_cast<top::time_base>(now - _base_time).count();
+        if ((elapsed_ticks == 0) || (elapsed_time <= 0)) {
+            return;
+        }
+        const auto scale = shift32_div(static_cast<std::uint64_t>(elapsed_time), elapsed_ticks);
+        {
+            const std::lock_guard<std::mutex> lock(_mutex);
+            _scale.store(scale, std::memory_order_release);
+        }
+        _changed.notify_all();
+    }
+
+    void tsc_clock::run(void) {
+        auto wait = _options.first_calibration;
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_changed.wait_for(lock, wait, [this](void) { return _stop; })) {
+            lock.unlock();
+            calibrate();
+            lock.lock();
+            wait = _options.calibration_interval;
+        }
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,134 @@
+/*
+ *  C++ VCD Tracer Library - Cycle Counter Timestamps
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_TSC_HPP
+#define VCD_TSC_HPP
+
+namespace vcd_tracer {
+
+    /** Options to control a tsc_clock.
+     */
+    struct tsc_options {
+        //! Use the cycle counter if the CPU has one that runs at a constant rate, else steady_clock.
+        bool hardware{ true };
+        //! The time to the first calibration, conversions wait for it.
+        std::chrono::milliseconds first_calibration{ 10 };
+        //! The time between later calibrations, each over the whole time since the clock was created.
+        std::chrono::milliseconds calibration_interval{ 1000 };
+    };
+
+    /** A timestamp source that reads the CPU cycle counter, for tracing software events.
+
+        @code
+        vcd_tracer::tsc_clock clock;
+        ...
+        const auto ticks = clock.ticks();
+        event.set(id);
+        dumper.time_update_abs(out, clock.to_time(ticks));
+        @endcode
+
+        ticks() is rdtsc on x86 with an invariant TSC, and the virtual
+        counter on AArch64. Elsewhere, or if the counter may change rate, it
+        is steady_clock in nanoseconds. Reading it is a few cycles with no
+        system call.
+
+        The rate of the counter is calibrated against steady_clock by a
+        background thread, first after first_calibration and then every
+        calibration_interval over a longer baseline. to_time() converts ticks
+        to the time base of the trace with the latest calibration, a
+        multiply and a shift, so it is done when the time is formatted
+        rather than where the event happened. The first conversion waits for
+        the first calibration.
+
+        Times are relative to when the clock was created. As the calibration
+        is refined a later time can convert a little before an earlier one,
+        top ignores a time that goes backwards.
+     */
+    class tsc_clock {
+      public:
+        //! A reading of the counter.
+        using rep = std::uint64_t;
+
+        explicit tsc_clock(tsc_options options = {});
+        tsc_clock(const tsc_clock &) = delete;
+        tsc_clock(tsc_clock &&) = delete;
+        tsc_clock &operator=(const tsc_clock &) = delete;
+        tsc_clock &operator=(tsc_clock &&) = delete;
+        ~tsc_clock(void);
+
+        /** Read the counter.
+         */
+        [[nodiscard]] rep ticks(void) const noexcept {
+            return _hardware ? read_counter() : steady_ticks();
+        }
+
+        /** Convert a reading of the counter to the time since the clock was created.
+            @param ticks A value returned by ticks().
+         */
+        [[nodiscard]] top::time_base to_time(rep ticks) const;
+
+        //! True if the cycle counter is used, rather than steady_clock.
+        [[nodiscard]] bool hardware(void) const { return _hardware; }
+        //! True once the rate of the counter has been calibrated.
+        [[nodiscard]] bool calibrated(void) const { return _scale.load(std::memory_order_acquire) != 0; }
+        //! The calibrated rate of the counter, 0 until it is calibrated.
+        [[nodiscard]] double ticks_per_second(void) const;
+
+      private:
+        static rep read_counter(void) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#elif defined(__aarch64__)
+            rep counter;
+            asm volatile("mrs %0, cntvct_el0" : "=r"(counter));
+            return counter;
+#else
+            return steady_ticks();
+#endif
+        }
+        static rep steady_ticks(void) noexcept {
+            return static_cast<rep>(std::chrono::duration_cast<top::time_base>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+        static bool counter_is_invariant(void);
+        void calibrate(void);
+        void run(void);
+
+        tsc_options _options;
+        bool _hardware;
+        // The counter and steady_clock when the clock was created.
+        rep _base_ticks;
+        std::chrono::steady_clock::time_point _base_time;
+        // Time base units per tick, as a 32.32 fixed point value, 0 until calibrated.
+        std::atomic<std::uint64_t> _scale{ 0 };
+        mutable std::mutex _mutex;
+        mutable std::condition_variable _changed;
+        bool _stop{ false };
+        std::thread _thread;
+    };
+
+}// namespace vcd_tracer
+
+#endif
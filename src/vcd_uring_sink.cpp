@@ -0,0 +1,322 @@
+/*
+ *  C++ VCD Tracer Library - io_uring File Sink
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "vcd_bytes.hpp"
+#include "vcd_uring_sink.hpp"
+
+namespace vcd_tracer {
+
+    namespace {
+        using detail::throw_errno;
+
+        // There is no liburing dependency, the ring is driven with the raw system calls.
+        int ring_enter(int ring_fd, unsigned submit, unsigned complete, unsigned flags) {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, submit, complete, flags, nullptr, 0));
+        }
+
+        void *map_ring(int ring_fd, std::size_t size, std::uint64_t offset) {
+            void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, static_cast<off_t>(offset));
+            return (p == MAP_FAILED) ? nullptr : p;
+        }
+    }// namespace
+
+    uring_sink::uring_sink(const std::string &path, uring_sink_options options)
+        : _options(options), _page(static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))) {
+        _options.buffer_size = ((std::max(_options.buffer_size, _page) + _page - 1) / _page) * _page;
+        _options.buffers = std::max<std::size_t>(2, _options.buffers);
+
+        const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        if (_options.direct) {
+            _fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+            if ((_fd < 0) && (errno == EINVAL)) {
+                _options.direct = false;
+            }
+        }
+        if (_fd < 0) {
+            _fd = ::open(path.c_str(), flags, 0644);
+        }
+        if (_fd < 0) {
+            throw_errno("uring_sink open");
+        }
+
+        // Page aligned, as O_DIRECT needs aligned buffers.
+        const std::size_t total = _options.buffer_size * _options.buffers;
+        void *pages = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pages == MAP_FAILED) {
+            const int error = errno;
+            ::close(_fd);
+            throw std::system_error(error, std::system_category(), "uring_sink mmap");
+        }
+        for (std::size_t i = 0; i < _options.buffers; i++) {
+            _buffers.push_back({ static_cast<char *>(pages) + (i * _options.buffer_size), 0, 0, false });
+        }
+        if (_options.uring) {
+            setup_ring();
+        }
+        setp(_buffers[0].data, _buffers[0].data + _options.buffer_size);
+    }
+
+    uring_sink::~uring_sink(void) {
+        try {
+            close();
+        }
+        catch (const std::system_error &) {
+            // Call close() to see errors.
+        }
+        if (_fd >= 0) {
+            ::close(_fd);
+        }
+        release_ring();
+        ::munmap(_buffers[0].data, _options.buffer_size * _options.buffers);
+    }
+
+    void uring_sink::setup_ring(void) {
+        io_uring_params params{};
+        const auto ring_fd = ::syscall(__NR_io_uring_setup, static_cast<unsigned>(_buffers.size()), &params);
+        if (ring_fd < 0) {
+            // Not built into the kernel, or disabled with kernel.io_uring_disabled.
+            return;
+        }
+        _ring_fd = static_cast<int>(ring_fd);
+        _sq_ring_size = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+        _cq_ring_size = params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe));
+        const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            _sq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+            _cq_ring_size = _sq_ring_size;
+        }
+        _sq_ring = map_ring(_ring_fd, _sq_ring_size, IORING_OFF_SQ_RING);
+        _cq_ring = single ? _sq_ring : map_ring(_ring_fd, _cq_ring_size, IORING_OFF_CQ_RING);
+        _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe *>(map_ring(_ring_fd, _sqes_size, IORING_OFF_SQES));
+        if ((_sq_ring == nullptr) || (_cq_ring == nullptr) || (_sqes == nullptr)) {
+            release_ring();
+            return;
+        }
+        auto *sq = static_cast<char *>(_sq_ring);
+        auto *cq = static_cast<char *>(_cq_ring);
+        _sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        _sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        _sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        _cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        _cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        // Registered buffers are pinned once, rather than on every write.
+        std::vector<iovec> iov;
+        for (const auto &buf : _buffers) {
+            iov.push_back({ buf.data, _options.buffer_size });
+        }
+        _registered = (::syscall(__NR_io_uring_register, _ring_fd, IORING_REGISTER_BUFFERS, iov.data(), static_cast<unsigned>(iov.size())) == 0);
+    }
+
+    void uring_sink::release_ring(void) {
+        if (_sqes != nullptr) {
+            ::munmap(_sqes, _sqes_size);
+        }
+        if ((_cq_ring != nullptr) && (_cq_ring != _sq_ring)) {
+            ::munmap(_cq_ring, _cq_ring_size);
+        }
+        if (_sq_ring != nullptr) {
+            ::munmap(_sq_ring, _sq_ring_size);
+        }
+        if (_ring_fd >= 0) {
+            ::close(_ring_fd);
+        }
+        _sqes = nullptr;
+        _cq_ring = nullptr;
+        _sq_ring = nullptr;
+        _ring_fd = -1;
+        _registered = false;
+    }
+
+    uring_sink::int_type uring_sink::overflow(int_type ch) {
+        if (_fd < 0) {
+            return traits_type::eof();
+        }
+        flush_buffer(false);
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int uring_sink::sync(void) {
+        if (_fd < 0) {
+            return -1;
+        }
+        flush_buffer(false);
+        wait_all();
+        return 0;
+    }
+
+    uring_sink::pos_type uring_sink::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+        // Only tellp() is supported, for the sidecar writers.
+        if ((off != 0) || (dir != std::ios_base::cur) || ((which & std::ios_base::out) == 0)) {
+            return pos_type(off_type(-1));
+        }
+        return pos_type(static_cast<off_type>(_offset) + (pptr() - pbase()));
+    }
+
+    void uring_sink::close(void) {
+        if (_fd < 0) {
+            return;
+        }
+        const auto end = _offset + static_cast<std::uint64_t>(pptr() - pbase());
+        flush_buffer(true);
+        wait_all();
+        setp(nullptr, nullptr);
+        if (_options.direct && (::ftruncate(_fd, static_cast<off_t>(end)) != 0)) {
+            throw_errno("uring_sink ftruncate");
+        }
+        const int fd = std::exchange(_fd, -1);
+        release_ring();
+        if (::close(fd) != 0) {
+            throw_errno("uring_sink close");
+        }
+    }
+
+    void uring_sink::flush_buffer(bool last) {
+        const auto size = static_cast<std::size_t>(pptr() - pbase());
+        auto &buf = _buffers[_current];
+        std::size_t length = size;
+        if (_options.direct) {
+            // O_DIRECT writes whole blocks, keep the partial block for later or pad the last one.
+            length = last ? (((size + _page - 1) / _page) * _page) : (size & ~(_page - 1));
+            if (last) {
+                std::memset(buf.data + size, 0, length - size);
+            }
+        }
+        if (length == 0) {
+            return;
+        }
+        submit(_current, length);
+        _current = (_current + 1) % _buffers.size();
+        const auto &next = _buffers[_current];
+        while (next.busy) {
+            reap(true);
+        }
+        const std::size_t tail = (size > length) ? (size - length) : 0;
+        std::memcpy(next.data, buf.data + length, tail);
+        setp(next.data, next.data + _options.buffer_size);
+        pbump(static_cast<int>(tail));
+    }
+
+    void uring_sink::submit(std::size_t index, std::size_t size) {
+        auto &buf = _buffers[index];
+        buf.size = size;
+        buf.offset = _offset;
+        _offset += size;
+        if (_ring_fd < 0) {
+            write_sync(buf, 0);
+            return;
+        }
+        // Only this thread adds entries, and there are never more in flight than entries.
+        const unsigned tail = *_sq_tail;
+        io_uring_sqe &sqe = _sqes[tail & _sq_mask];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = _registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd = _fd;
+        sqe.off = buf.offset;
+        sqe.addr = reinterpret_cast<std::uint64_t>(buf.data);
+        sqe.len = static_cast<std::uint32_t>(size);
+        sqe.buf_index = static_cast<std::uint16_t>(index);
+        sqe.user_data = index;
+        _sq_array[tail & _sq_mask] = tail & _sq_mask;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        buf.busy = true;
+        _in_flight++;
+        while (ring_enter(_ring_fd, 1, 0, 0) < 0) {
+            if ((errno == EAGAIN) || (errno == EBUSY)) {
+                reap(true);
+            }
+            else if (errno != EINTR) {
+                throw_errno("uring_sink io_uring_enter");
+            }
+        }
+    }
+
+    void uring_sink::write_sync(const buffer &buf, std::size_t done) {
+        while (done < buf.size) {
+            const auto n = ::pwrite(_fd, buf.data + done, buf.size - done, static_cast<off_t>(buf.offset + done));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw_errno("uring_sink pwrite");
+            }
+            if (n == 0) {
+                throw std::system_error(std::make_error_code(std::errc::no_space_on_device), "uring_sink pwrite");
+            }
+            done += static_cast<std::size_t>(n);
+        }
+    }
+
+    void uring_sink::reap(bool wait) {
+        for (;;) {
+            unsigned head = *_cq_head;
+            const unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+            const bool reaped = (head != tail);
+            int error = 0;
+            std::vector<std::pair<std::size_t, std::size_t>> short_writes;
+            for (; head != tail; head++) {
+                const io_uring_cqe &cqe = _cqes[head & _cq_mask];
+                const auto index = static_cast<std::size_t>(cqe.user_data);
+                auto &buf = _buffers[index];
+                buf.busy = false;
+                _in_flight--;
+                if (cqe.res < 0) {
+                    error = -cqe.res;
+                }
+                else if (static_cast<std::size_t>(cqe.res) < buf.size) {
+                    short_writes.emplace_back(index, static_cast<std::size_t>(cqe.res));
+                }
+            }
+            __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+            if (error != 0) {
+                throw std::system_error(error, std::system_category(), "uring_sink write");
+            }
+            for (const auto &[index, done] : short_writes) {
+                write_sync(_buffers[index], done);
+            }
+            if (reaped || !wait) {
+                return;
+            }
+            if ((ring_enter(_ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0) && (errno != EINTR)) {
+                throw_errno("uring_sink io_uring_enter");
+            }
+        }
+    }
+
+    void uring_sink::wait_all(void) {
+        while (_in_flight > 0) {
+            reap(true);
+        }
+    }
+
+}// namespace vcd_tracer
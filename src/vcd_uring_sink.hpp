@@ -0,0 +1,136 @@
+/*
+ *  C++ VCD Tracer Library - io_uring File Sink
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#ifndef VCD_URING_SINK_HPP
+#define VCD_URING_SINK_HPP
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace vcd_tracer {
+
+    /** Options to control the buffering of a uring_sink.
+     */
+    struct uring_sink_options {
+        //! Bytes per buffer, rounded up to a whole number of pages.
+        std::size_t buffer_size{ 1024 * 1024 };
+        //! The number of buffers, all but the one being filled can be written at once.
+        std::size_t buffers{ 4 };
+        //! Open the file with O_DIRECT, bypassing the page cache.
+        bool direct{ false };
+        //! Use io_uring if the kernel allows it, false for the pwrite() fallback.
+        bool uring{ true };
+    };
+
+    /** A stream buffer that writes a trace to a file with io_uring.
+
+        @code
+        vcd_tracer::uring_sink sink("trace.vcd");
+        std::ostream out(&sink);
+        dumper.finalize_header(out, std::chrono::system_clock::now());
+        ...
+        dumper.finalize_trace(out);
+        sink.close();
+        @endcode
+
+        The trace is formatted into page aligned buffers that are registered
+        with the ring. A full buffer is submitted as a fixed buffer write and
+        filling continues in the next buffer, so the tracer only waits when
+        every buffer is in flight. A flush waits for the writes to complete.
+
+        With O_DIRECT only whole blocks are written before close(), which
+        pads the last block and truncates the file to the traced size. If the
+        file system refuses O_DIRECT the file is opened without it, and if
+        io_uring is not available the buffers are written with pwrite().
+        Errors throw std::system_error, which the std::ostream turns into
+        badbit.
+     */
+    class uring_sink : public std::streambuf {
+      public:
+        /** @param path    The file to create or truncate.
+            @param options Controls the buffering.
+        */
+        explicit uring_sink(const std::string &path, uring_sink_options options = {});
+        uring_sink(const uring_sink &) = delete;
+        uring_sink(uring_sink &&) = delete;
+        uring_sink &operator=(const uring_sink &) = delete;
+        uring_sink &operator=(uring_sink &&) = delete;
+        ~uring_sink(void) override;
+
+        /** Write what is left, wait for every write and close the file.
+         */
+        void close(void);
+
+        //! True if the writes are submitted to an io_uring.
+        [[nodiscard]] bool uring(void) const { return _ring_fd >= 0; }
+        //! True if the buffers are registered with the ring.
+        [[nodiscard]] bool registered(void) const { return _registered; }
+        //! True if the file is open with O_DIRECT.
+        [[nodiscard]] bool direct(void) const { return _options.direct; }
+
+      protected:
+        int_type overflow(int_type ch) override;
+        int sync(void) override;
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+      private:
+        struct buffer {
+            char *data;
+            std::size_t size;
+            std::uint64_t offset;
+            bool busy;
+        };
+
+        void setup_ring(void);
+        void release_ring(void);
+        void flush_buffer(bool last);
+        void submit(std::size_t index, std::size_t size);
+        void write_sync(const buffer &buf, std::size_t done);
+        void reap(bool wait);
+        void wait_all(void);
+
+        int _fd{ -1 };
+        uring_sink_options _options;
+        std::size_t _page{ 0 };
+        std::vector<buffer> _buffers;
+        std::size_t _current{ 0 };
+        std::size_t _in_flight{ 0 };
+        // The file offset of the next write.
+        std::uint64_t _offset{ 0 };
+
+        int _ring_fd{ -1 };
+        bool _registered{ false };
+        void *_sq_ring{ nullptr };
+        std::size_t _sq_ring_size{ 0 };
+        void *_cq_ring{ nullptr };
+        std::size_t _cq_ring_size{ 0 };
+        io_uring_sqe *_sqes{ nullptr };
+        std::size_t _sqes_size{ 0 };
+        unsigned *_sq_tail{ nullptr };
+        unsigned *_sq_array{ nullptr };
+        unsigned _sq_mask{ 0 };
+        unsigned *_cq_head{ nullptr };
+        unsigned *_cq_tail{ nullptr };
+        unsigned _cq_mask{ 0 };
+        io_uring_cqe *_cqes{ nullptr };
+    };
+
+}// namespace vcd_tracer
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Value Index
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "vcd_bytes.hpp"
+#include "vcd_index.hpp"
+#include "vcd_value_index.hpp"
+
+namespace vcd_tracer {
+
+    value_index_writer::value_index_writer(std::ostream &index, value_index_options options)
+        : _index(index), _options(options) {
+        _options.chunk_changes = std::max<std::uint64_t>(1, _options.chunk_changes);
+    }
+
+    trace_observer value_index_writer::observer(void) {
+        trace_observer o;
+        o.on_header = [this](std::ostream &, const std::vector<std::string> &identifiers, const std::vector<std::string> &) {
+            on_header(identifiers);
+        };
+        o.on_time = [this](std::ostream &out, scope_fn::sequence_t time) { on_time(out, time); };
+        o.on_change = [this](const raw_change &change) { on_change(change); };
+        o.on_finalize = [this](std::ostream &) { on_finalize(); };
+        o.uses_offsets = true;
+        return o;
+    }
+
+    void value_index_writer::put_bytes(const char *data, std::size_t size) {
+        _index.write(data, static_cast<std::streamsize>(size));
+        _written += size;
+    }
+
+    void value_index_writer::put_u64(std::uint64_t v) {
+        const auto bytes = detail::le_u64(v);
+        put_bytes(bytes.data(), bytes.size());
+    }
+
+    void value_index_writer::on_header(const std::vector<std::string> &identifiers) {
+        put_bytes(value_index_format::header_magic.data(), value_index_format::header_magic.size());
+        put_u64(identifiers.size());
+        for (const auto &identifier : identifiers) {
+            const auto length = detail::le_u32(static_cast<std::uint32_t>(identifier.size()));
+            put_bytes(length.data(), length.size());
+            put_bytes(identifier.data(), identifier.size());
+        }
+        _zones.assign(identifiers.size(), zone{});
+    }
+
+    void value_index_writer::close_chunk(void) {
+        if (!_open) {
+            return;
+        }
+        _chunks.push_back(_written);
+        put_u64(_chunk_time);
+        put_u64(_chunk_offset);
+        put_u64(_touched.size());
+        std::sort(_touched.begin(), _touched.end());
+        for (const auto signal : _touched) {
+            auto &z = _zones[signal];
+            std::array<char, value_index_format::zone_size> buf{};
+            auto pack = [&buf](std::size_t at, std::uint64_t v, std::size_t bytes) {
+                detail::store_le(buf.data() + at, v, bytes);
+            };
+            pack(0, signal, 4);
+            buf[4] = static_cast<char>(z.flags);
+            pack(8, z.min, 8);
+            pack(16, z.max, 8);
+            pack(24, z.bloom[0], 8);
+            pack(32, z.bloom[1], 8);
+            put_bytes(buf.data(), buf.size());
+            z = zone{};
+        }
+        _touched.clear();
+        _changes = 0;
+        _open = false;
+    }
+
+    void value_index_writer::on_time(std::ostream &out, scope_fn::sequence_t time) {
+        if (_open && (_changes < _options.chunk_changes)) {
+            return;
+        }
+        const auto pos = out.tellp();
+        if (pos < 0) {
+            throw std::runtime_error("vcd_tracer::value_index_writer: the trace output does not report it's position");
+        }
+        close_chunk();
+        _chunk_time = time;
+        _chunk_offset = static_cast<std::uint64_t>(pos);
+        _open = true;
+    }
+
+    void value_index_writer::on_change(const raw_change &change) {
+        auto &z = _zones[change.index];
+        if (z.flags == 0) {
+            _touched.push_back(change.index);
+        }
+        _changes++;
+        const auto value = index_format::encode_change(change);
+        std::uint64_t bits = value.bits;
+        double real = change.real;
+        if (change.is_real) {
+            // Reals are traced with 16 digits that do not always give back the same double.
+            // The zone holds the value as traced, which is what a search of the trace text decodes.
+            z.flags |= value_index_format::is_real;
+            std::array<char, 32> text;
+            ::snprintf(text.data(), text.size(), "%.16g", real);
+            real = std::strtod(text.data(), nullptr);
+            std::memcpy(&bits, &real, sizeof(bits));
+        }
+        else if (value.state != index_format::state_known) {
+            z.flags |= (value.state == index_format::state_z) ? value_index_format::has_z : value_index_format::has_x;
+            return;
+        }
+        if ((z.flags & value_index_format::has_range) == 0) {
+            z.flags |= value_index_format::has_range;
+            z.min = bits;
+            z.max = bits;
+        }
+        else if (change.is_real) {
+            double min = 0;
+            double max = 0;
+            std::memcpy(&min, &z.min, sizeof(min));
+            std::memcpy(&max, &z.max, sizeof(max));
+            z.min = (real < min) ? bits : z.min;
+            z.max = (real > max) ? bits : z.max;
+        }
+        else {
+            z.min = std::min(z.min, bits);
+            z.max = std::max(z.max, bits);
+        }
+        for (const auto p : value_index_format::bloom_positions(bits)) {
+            z.bloom[p / 64] |= std::uint64_t{ 1 } << (p % 64);
+        }
+    }
+
+    void value_index_writer::on_finalize(void) {
+        close_chunk();
+        const auto directory = _written;
+        for (const auto offset : _chunks) {
+            put_u64(offset);
+        }
+        put_u64(directory);
+        put_u64(_chunks.size());
+        put_bytes(value_index_format::footer_magic.data(), value_index_format::footer_magic.size());
+        _index.flush();
+    }
+
+}// namespace vcd_tracer
@@ -0,0 +1,153 @@
+/*
+ *  C++ VCD Tracer Library - Sidecar Value Index
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "vcd_tracer.hpp"
+
+#ifndef VCD_VALUE_INDEX_HPP
+#define VCD_VALUE_INDEX_HPP
+
+/**
+   Sidecar value index:
+
+   A value index is written alongside a trace, so that a search for the
+   times a signal takes a value only reads the parts of the trace that can
+   hold it. The trace is split into chunks that start at a timestamp, and
+   for each signal that changes in a chunk there is a zone map: the range
+   of the known values, whether it was 'x' or 'z', and a small bloom filter
+   of the known values.
+
+   File layout, all integers are little endian:
+
+   - Header: "VCDVIDX1", u64 signal count, then per signal a u32 length and the identifier.
+   - Chunks: u64 time, u64 trace offset of the "#time" line, u64 zone count, then
+             per signal with changes, in header order, a 40 byte zone:
+             u32 signal, u8 flags, 3 bytes padding, u64 min, u64 max, 2 u64 bloom filter words.
+             Values are bits or a double.
+   - Directory: per chunk the u64 index file offset of the chunk.
+   - Footer: u64 directory offset, u64 chunk count, "VCDVIDXE".
+ */
+namespace vcd_tracer::value_index_format {
+    //! Magic at the start of a value index file.
+    constexpr std::array<char, 8> header_magic{ 'V', 'C', 'D', 'V', 'I', 'D', 'X', '1' };
+    //! Magic at the end of a complete value index file.
+    constexpr std::array<char, 8> footer_magic{ 'V', 'C', 'D', 'V', 'I', 'D', 'X', 'E' };
+    //! Bytes before the zones of a chunk.
+    constexpr std::size_t chunk_header_size = 24;
+    //! Bytes per zone.
+    constexpr std::size_t zone_size = 40;
+    //! Bytes in the footer.
+    constexpr std::size_t footer_size = 24;
+    //! Zone flag, min and max hold the range of known values.
+    constexpr std::uint8_t has_range = 1;
+    //! Zone flag, the values are reals.
+    constexpr std::uint8_t is_real = 2;
+    //! Zone flag, the signal was 'x' in the chunk.
+    constexpr std::uint8_t has_x = 4;
+    //! Zone flag, the signal was 'z' in the chunk.
+    constexpr std::uint8_t has_z = 8;
+    //! Bits in the bloom filter.
+    constexpr std::uint64_t bloom_bits = 128;
+
+    //! The bloom filter bits of a known value, three bits of one hash.
+    constexpr std::array<std::uint64_t, 3> bloom_positions(std::uint64_t bits) {
+        // MurmurHash3 finalizer.
+        bits ^= bits >> 33;
+        bits *= 0xff51afd7ed558ccdULL;
+        bits ^= bits >> 33;
+        bits *= 0xc4ceb9fe1a85ec53ULL;
+        bits ^= bits >> 33;
+        return { bits % bloom_bits, (bits >> 16) % bloom_bits, (bits >> 32) % bloom_bits };
+    }
+}// namespace vcd_tracer::value_index_format
+
+namespace vcd_tracer {
+
+    /** Options to control the size of a value index.
+     */
+    struct value_index_options {
+        //! Start a new chunk at the first timestamp after this many value changes.
+        std::uint64_t chunk_changes{ 4096 };
+    };
+
+    /** Write a sidecar value index of a trace as it is written.
+
+        @code
+        std::ofstream vcd("trace.vcd");
+        std::ofstream vidx("trace.vcd.vidx", std::ios::binary);
+        vcd_tracer::value_index_writer values(vidx);
+        dumper.add_observer(values.observer());
+        @endcode
+
+        The trace output must report it's position with tellp(). The value
+        index writer must outlive the tracing, the index is complete once
+        top::finalize_trace() has been called.
+     */
+    class value_index_writer {
+      public:
+        /** @param index   The value index output, opened in binary mode.
+            @param options Controls the chunk size.
+        */
+        explicit value_index_writer(std::ostream &index, value_index_options options = {});
+        value_index_writer(const value_index_writer &) = delete;
+        value_index_writer(value_index_writer &&) = delete;
+        value_index_writer &operator=(const value_index_writer &) = delete;
+        value_index_writer &operator=(value_index_writer &&) = delete;
+        ~value_index_writer(void) = default;
+
+        /** The functions to add to the top scope with top::add_observer().
+         */
+        trace_observer observer(void);
+
+        //! The number of chunks written.
+        [[nodiscard]] std::size_t chunk_count(void) const { return _chunks.size(); }
+
+      private:
+        struct zone {
+            std::uint8_t flags{ 0 };
+            std::uint64_t min{ 0 };
+            std::uint64_t max{ 0 };
+            std::array<std::uint64_t, 2> bloom{};
+        };
+
+        void on_header(const std::vector<std::string> &identifiers);
+        void on_time(std::ostream &out, scope_fn::sequence_t time);
+        void on_change(const raw_change &change);
+        void on_finalize(void);
+        void close_chunk(void);
+        void put_u64(std::uint64_t v);
+        void put_bytes(const char *data, std::size_t size);
+
+        std::ostream &_index;
+        value_index_options _options;
+        std::uint64_t _written{ 0 };
+        // The zone of every signal in the current chunk.
+        std::vector<zone> _zones;
+        // Signals with changes in the current chunk.
+        std::vector<std::uint32_t> _touched;
+        std::uint64_t _chunk_time{ 0 };
+        std::uint64_t _chunk_offset{ 0 };
+        bool _open{ false };
+        std::uint64_t _changes{ 0 };
+        // Index file offset of each chunk.
+        std::vector<std::uint64_t> _chunks;
+    };
+
+}// namespace vcd_tracer
+
+#endif
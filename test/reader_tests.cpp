@@ -0,0 +1,1112 @@
+/*
+ *  C++ VCD Tracer Library Reader Tests
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+#include "../src/vcd_tracer.hpp"
+#include "../src/vcd_reader.hpp"
+#include "../src/vcd_hash.hpp"
+#include "../src/vcd_hash_reader.hpp"
+#include "../src/vcd_index.hpp"
+#include "../src/vcd_index_reader.hpp"
+#include "../src/vcd_query.hpp"
+#include "../src/vcd_shm_ring.hpp"
+#include "../src/vcd_ring_reader.hpp"
+#include "../src/vcd_search.hpp"
+#include "../src/vcd_slice.hpp"
+#include "../src/vcd_summary.hpp"
+#include "../src/vcd_summary_reader.hpp"
+#include "../src/vcd_value_index.hpp"
+#include "../src/vcd_merge.hpp"
+#include "../src/vcd_columns.hpp"
+#include "../src/vcd_diff.hpp"
+#include "trace_helpers.hpp"
+
+using test_traces::change_text;
+using test_traces::read_changes;
+using test_traces::write_trace;
+
+namespace {
+
+    /** Write a small trace with the tracer.
+     */
+    std::string make_trace(void) {
+        vcd_tracer::top dumper("root");
+        vcd_tracer::value<bool> clk;
+        vcd_tracer::value<std::uint16_t, 12> addr;
+        vcd_tracer::value<double> level{ 0.0 };
+        {
+            vcd_tracer::module bus(dumper.root, "bus");
+            vcd_tracer::module analog(dumper.root, "analog");
+            bus.elaborate(clk, "clk");
+            bus.elaborate(addr, "addr");
+            analog.elaborate(level, "level");
+        }
+        std::ostringstream out;
+        dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+        for (unsigned int i = 1; i <= 4; i++) {
+            clk.set((i & 1) != 0);
+            if (i == 2) {
+                addr.set(0x5A5);
+                level.set(1.5);
+            }
+            if (i == 4) {
+                addr.unknown();
+            }
+            dumper.time_update_abs(out, std::chrono::nanoseconds{ i * 10 });
+        }
+        return out.str();
+    }
+
+    /** Write a trace with a sidecar index, with entries and checkpoints close together.
+     */
+    void make_indexed_trace(std::string &data, std::string &index_data) {
+        vcd_tracer::top dumper("root");
+        std::array<vcd_tracer::value<std::uint8_t>, 6> values;
+        vcd_tracer::value<bool> flag;
+        vcd_tracer::value<float> level{ 0.0F };
+        // The top bit is set and it does not change, so it's value comes from the checkpoints.
+        vcd_tracer::value<std::uint8_t> held{ 0xF0 };
+        for (std::size_t i = 0; i < values.size(); i++) {
+            dumper.root.elaborate(values[i], "v" + std::to_string(i));
+        }
+        dumper.root.elaborate(flag, "flag");
+        dumper.root.elaborate(level, "level");
+        dumper.root.elaborate(held, "held");
+
+        std::ostringstream out;
+        std::ostringstream idx;
+        vcd_tracer::index_options options;
+        options.entry_changes = 8;
+        options.checkpoint_changes = 40;
+        vcd_tracer::index_writer writer(idx, options);
+        dumper.add_observer(writer.observer());
+
+        dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+        for (unsigned int t = 1; t < 300; t++) {
+            for (std::size_t i = 0; i < values.size(); i++) {
+                values[i].set(static_cast<std::uint8_t>((t * (i + 3)) / (i + 1)));
+            }
+            if ((t % 7) == 0) {
+                values[2].undriven();
+                flag.unknown();
+            }
+            else {
+                flag.set((t % 3) == 0);
+            }
+            level.set(static_cast<float>(t) * 0.25F);
+            dumper.time_update_abs(out, std::chrono::nanoseconds{ t * 10 });
+        }
+        dumper.finalize_trace(out);
+        data = out.str();
+        index_data = idx.str();
+    }
+
+}// namespace
+
+
+TEST_CASE("VCD Reader Scan", "VcdReaderScan") {
+    const std::string text = "abcdefghijklmnopqrstuvwxyz0123456789 tail\nnext";
+    const char *begin = text.data();
+    const char *end = text.data() + text.size();
+
+    REQUIRE(vcd_tracer::reader::scan::find_space(begin, end) == begin + 36);
+    REQUIRE(vcd_tracer::reader::scan::find_char(begin, end, '\n') == begin + 41);
+    REQUIRE(vcd_tracer::reader::scan::find_char(begin, end, '@') == end);
+    REQUIRE(vcd_tracer::reader::scan::skip_space(begin + 36, end) == begin + 37);
+    REQUIRE(vcd_tracer::reader::scan::find_space(begin + 42, end) == end);
+}
+
+
+TEST_CASE("VCD Reader Decode", "VcdReaderDecode") {
+    std::uint64_t bits = 0;
+    double real = 0;
+
+    REQUIRE(vcd_tracer::reader::decode_bits("1", bits));
+    REQUIRE(bits == 1);
+    REQUIRE(vcd_tracer::reader::decode_bits("b010110100101", bits));
+    REQUIRE(bits == 0x5A5);
+    REQUIRE_FALSE(vcd_tracer::reader::decode_bits("x", bits));
+    REQUIRE_FALSE(vcd_tracer::reader::decode_bits("b01z", bits));
+    REQUIRE_FALSE(vcd_tracer::reader::decode_bits("r1.5", bits));
+    REQUIRE(vcd_tracer::reader::decode_real("r1.5", real));
+    REQUIRE(real == 1.5);
+    REQUIRE_FALSE(vcd_tracer::reader::decode_real("b01", real));
+}
+
+
+TEST_CASE("VCD Reader Header", "VcdReaderHeader") {
+    const std::string data = make_trace();
+    const vcd_tracer::reader::trace t(data);
+    const auto &hdr = t.get_header();
+
+    REQUIRE(hdr.timescale == "1ns");
+    REQUIRE(hdr.version == "C++ Simple VCD Logger");
+    REQUIRE(hdr.scopes.size() == 3);
+    REQUIRE(hdr.scopes[0].name == "root");
+    REQUIRE(hdr.scopes[0].children.size() == 2);
+    REQUIRE(hdr.vars.size() == 3);
+    REQUIRE(hdr.signals.size() == 3);
+
+    const auto addr = hdr.find_var("root.bus.addr");
+    REQUIRE(addr != vcd_tracer::reader::npos);
+    REQUIRE(hdr.path(addr) == "root.bus.addr");
+    REQUIRE(hdr.signals[hdr.vars[addr].signal].bit_size == 12);
+    REQUIRE(hdr.signals[hdr.vars[addr].signal].identifier == "\"");
+
+    const auto level = hdr.find_var("root.analog.level");
+    REQUIRE(level != vcd_tracer::reader::npos);
+    REQUIRE(hdr.signals[hdr.vars[level].signal].real);
+    REQUIRE(hdr.find_var("root.bus.missing") == vcd_tracer::reader::npos);
+    REQUIRE(hdr.find_signal("#") == hdr.vars[level].signal);
+    REQUIRE(hdr.find_signal("$") == vcd_tracer::reader::npos);
+}
+
+
+TEST_CASE("VCD Reader Changes", "VcdReaderChanges") {
+    const std::string data = make_trace();
+    const vcd_tracer::reader::trace t(data);
+
+    const std::vector<change_text> expected{
+        { 0, "!", "x" },
+        { 0, "\"", "bx" },
+        { 0, "#", "r0" },
+        { 0, "!", "1" },
+        { 10, "!", "0" },
+        { 10, "\"", "b010110100101" },
+        { 10, "#", "r1.5" },
+        { 20, "!", "1" },
+        { 30, "!", "0" },
+        { 30, "\"", "bx" },
+    };
+    const auto changes = read_changes(t);
+    REQUIRE(changes.size() == expected.size());
+    for (std::size_t i = 0; i < expected.size(); i++) {
+        REQUIRE(changes[i] == expected[i]);
+    }
+}
+
+
+TEST_CASE("VCD Reader Mapped File", "VcdReaderMappedFile") {
+    const std::string data = make_trace();
+    const std::string path = "reader_tests_mapped.vcd";
+    {
+        std::ofstream out(path);
+        out << data;
+    }
+    {
+        vcd_tracer::reader::trace t(vcd_tracer::reader::mapped_file{ path });
+        REQUIRE(t.data() == data);
+        REQUIRE(read_changes(t) == read_changes(vcd_tracer::reader::trace(data)));
+    }
+    std::remove(path.c_str());
+
+    REQUIRE_THROWS_AS(vcd_tracer::reader::mapped_file("reader_tests_missing.vcd"), std::system_error);
+}
+
+
+TEST_CASE("VCD Reader Foreign Trace", "VcdReaderForeign") {
+    // Identifiers that are not from the generator, shared identifiers,
+    // comments and dump sections.
+    const std::string data =
+        "$timescale 10 ps $end\n"
+        "$scope module top $end\n"
+        "$var wire 8 <0> data [7:0] $end\n"
+        "$scope module sub $end\n"
+        "$var wire 8 <0> alias $end\n"
+        "$var wire 1 ~~ en $end\n"
+        "$upscope $end\n"
+        "$upscope $end\n"
+        "$enddefinitions $end\n"
+        "$comment ignore 1~~ $end\n"
+        "#0 $dumpvars bx <0> 0~~ $end\n"
+        "#5 b101 <0> 1~~\n";
+    const vcd_tracer::reader::trace t(data);
+    const auto &hdr = t.get_header();
+
+    REQUIRE(hdr.timescale == "10ps");
+    REQUIRE(hdr.vars.size() == 3);
+    REQUIRE(hdr.signals.size() == 2);
+    REQUIRE(hdr.vars[0].name == "data [7:0]");
+    REQUIRE(hdr.vars[0].signal == hdr.vars[1].signal);
+    REQUIRE(hdr.find_var("top.sub.alias") == 1);
+
+    const std::vector<change_text> expected{
+        { 0, "<0>", "bx" },
+        { 0, "~~", "0" },
+        { 5, "<0>", "b101" },
+        { 5, "~~", "1" },
+    };
+    REQUIRE(read_changes(t) == expected);
+
+    REQUIRE_THROWS_AS(vcd_tracer::reader::trace("$scope module a $end\n"), vcd_tracer::reader::parse_error);
+    const vcd_tracer::reader::trace bad("$enddefinitions $end\n1!\n");
+    REQUIRE_THROWS_AS(read_changes(bad), vcd_tracer::reader::parse_error);
+}
+
+
+TEST_CASE("VCD Reader Parallel Histories", "VcdReaderParallel") {
+    // A trace with enough timestamps to be split into many chunks.
+    vcd_tracer::top dumper("root");
+    std::array<vcd_tracer::value<std::uint8_t>, 8> values;
+    for (std::size_t i = 0; i < values.size(); i++) {
+        dumper.root.elaborate(values[i], "v" + std::to_string(i));
+    }
+    std::ostringstream out;
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    for (unsigned int t = 1; t < 500; t++) {
+        for (std::size_t i = 0; i < values.size(); i++) {
+            // Values change at different rates, so some are constant over a chunk.
+            values[i].set(static_cast<std::uint8_t>(t / (i + 1)));
+        }
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+    }
+    // Repeat every value, as a checkpoint would, these are not changes.
+    // Known vectors are written with a leading zero, as another writer might.
+    {
+        const std::string before = out.str();
+        const vcd_tracer::reader::trace t(before);
+        const auto last = vcd_tracer::reader::load_histories(t, 1);
+        out << "#600\n$dumpall\n";
+        for (std::size_t s = 0; s < last.size(); s++) {
+            const std::string value(last[s].back().value);
+            const bool known = (value[0] == 'b') && (value.find_first_of("xXzZ") == std::string::npos);
+            out << (known ? ("b0" + value.substr(1)) : value) << " " << t.get_header().signals[s].identifier << "\n";
+        }
+        out << "$end\n";
+    }
+    const std::string data = out.str();
+    const vcd_tracer::reader::trace t(data);
+
+    const auto chunks = vcd_tracer::reader::split_body(t, 16);
+    REQUIRE(chunks.size() > 8);
+    std::size_t total = 0;
+    for (std::size_t c = 0; c < chunks.size(); c++) {
+        if (c > 0) {
+            REQUIRE(chunks[c][0] == '#');
+            REQUIRE(chunks[c - 1].data() + chunks[c - 1].size() == chunks[c].data());
+        }
+        total += chunks[c].size();
+    }
+    REQUIRE(total == t.body().size());
+
+    const auto sequential = vcd_tracer::reader::load_histories(t, 1);
+    REQUIRE(sequential.size() == values.size());
+    // The fastest signal changes at every timestamp, plus the initial x.
+    // Values set before time_update_abs(t) are traced at the previous timestamp.
+    REQUIRE(sequential[0].size() == 500);
+    REQUIRE(sequential[0].front().value == "bx");
+    REQUIRE(sequential[0].back().time == 498);
+    for (const unsigned int threads : { 2U, 3U, 5U }) {
+        const auto parallel = vcd_tracer::reader::load_histories(t, threads);
+        REQUIRE(parallel.size() == sequential.size());
+        for (std::size_t s = 0; s < sequential.size(); s++) {
+            REQUIRE(parallel[s].size() == sequential[s].size());
+            for (std::size_t i = 0; i < sequential[s].size(); i++) {
+                REQUIRE(parallel[s][i].time == sequential[s][i].time);
+                REQUIRE(parallel[s][i].value == sequential[s][i].value);
+            }
+        }
+    }
+}
+
+
+TEST_CASE("VCD Reader Index Seek", "VcdReaderIndex") {
+    std::string data;
+    std::string index_data;
+    make_indexed_trace(data, index_data);
+    const vcd_tracer::reader::trace t(data);
+    const vcd_tracer::reader::trace_index index(index_data);
+    const auto &hdr = t.get_header();
+    REQUIRE(index.identifiers().size() == hdr.signals.size());
+    REQUIRE(index.entry_count() > 10);
+    std::set<std::uint64_t> checkpoints;
+    for (std::size_t e = 0; e < index.entry_count(); e++) {
+        checkpoints.insert(index.entry(e).checkpoint);
+    }
+    REQUIRE(checkpoints.size() > 2);
+    REQUIRE(checkpoints.size() < index.entry_count());
+    for (const auto checkpoint : checkpoints) {
+        REQUIRE(index.checkpoint_offset(checkpoint) == index.read_checkpoint(checkpoint, hdr).offset);
+    }
+    REQUIRE(index.find(0) == 0);
+    for (std::size_t e = 0; e < index.entry_count(); e++) {
+        const auto entry = index.entry(e);
+        REQUIRE(data.substr(entry.offset, 1 + std::to_string(entry.time).size()) == "#" + std::to_string(entry.time));
+        REQUIRE(index.find(entry.time) == e);
+    }
+
+    // Compare the values of a sequential read with a seek at every time.
+    std::vector<std::string> expected(hdr.signals.size());
+    auto cursor = t.changes();
+    vcd_tracer::reader::value_change change;
+    bool more = cursor.next(change);
+    for (std::uint64_t time = 0; time < 3020; time += 5) {
+        while (more && (change.time <= time)) {
+            expected[change.signal] = std::string(change.value);
+            more = cursor.next(change);
+        }
+        const auto cp = vcd_tracer::reader::seek(t, index, time);
+        REQUIRE(cp.time == time);
+        // The checkpoint values are as traced, byte for byte.
+        REQUIRE(cp.values == expected);
+        if (cp.offset < data.size()) {
+            // The next timestamp, it may have no changes.
+            REQUIRE(data[cp.offset] == '#');
+            const auto stamp = std::stoull(data.substr(cp.offset + 1, data.find('\n', cp.offset) - cp.offset - 1));
+            REQUIRE(stamp > time);
+            REQUIRE((!more || (stamp <= change.time)));
+        }
+        else {
+            REQUIRE_FALSE(more);
+        }
+    }
+
+    REQUIRE_THROWS_AS(vcd_tracer::reader::trace_index(std::string_view("VCDINDX1")), vcd_tracer::reader::parse_error);
+    REQUIRE_THROWS_AS(vcd_tracer::reader::trace_index(std::string_view(index_data).substr(0, index_data.size() - 1)),
+                      vcd_tracer::reader::parse_error);
+}
+
+
+TEST_CASE("VCD Reader Query", "VcdReaderQuery") {
+    std::string data;
+    std::string index_data;
+    make_indexed_trace(data, index_data);
+    const vcd_tracer::reader::trace t(data);
+    const vcd_tracer::reader::trace_index index(index_data);
+    const vcd_tracer::reader::query indexed(t, &index);
+    const vcd_tracer::reader::query unindexed(t);
+
+    const auto signals = indexed.signals({ "root.v0", "root.v2", "root.flag", "root.level", "root.v0" });
+    REQUIRE(signals.size() == 5);
+    REQUIRE_THROWS_AS(indexed.signals({ "root.missing" }), std::out_of_range);
+    REQUIRE_THROWS_AS(indexed.value_at(1000, 0), std::out_of_range);
+
+    // Full histories to check against.
+    const auto histories = vcd_tracer::reader::load_histories(t, 1);
+    const auto expected_at = [&histories](std::size_t signal, std::uint64_t time) {
+        std::string value;
+        for (const auto &change : histories[signal]) {
+            if (change.time <= time) {
+                value = std::string(change.value);
+            }
+        }
+        return value;
+    };
+    const auto same = [](const std::string &a, const std::string &b) {
+        std::uint64_t a_bits = 0;
+        std::uint64_t b_bits = 0;
+        if (vcd_tracer::reader::decode_bits(a, a_bits)) {
+            return vcd_tracer::reader::decode_bits(b, b_bits) && (a_bits == b_bits);
+        }
+        return a == b;
+    };
+
+    // Point in time, at and between timestamps.
+    std::vector<std::uint64_t> times;
+    for (std::uint64_t time = 0; time < 3020; time += 35) {
+        times.push_back(time);
+    }
+    // Out of order, to check the batch is sorted.
+    std::reverse(times.begin(), times.end());
+    const auto batch = indexed.values_at(signals, times);
+    const auto unindexed_batch = unindexed.values_at(signals, times);
+    REQUIRE(batch.size() == times.size());
+    for (std::size_t i = 0; i < times.size(); i++) {
+        const auto single = indexed.values_at(signals, times[i]);
+        for (std::size_t s = 0; s < signals.size(); s++) {
+            const auto expected = expected_at(signals[s], times[i]);
+            REQUIRE(same(expected, batch[i][s]));
+            REQUIRE(same(expected, unindexed_batch[i][s]));
+            REQUIRE(same(expected, single[s]));
+        }
+    }
+    REQUIRE(same(indexed.value_at(signals[0], 1000), expected_at(signals[0], 1000)));
+
+    // Windows.
+    for (const auto &[begin, end] : std::vector<std::pair<std::uint64_t, std::uint64_t>>{ { 0, 0 }, { 95, 405 }, { 1000, 1000 }, { 2500, 5000 } }) {
+        const auto w = indexed.changes(signals, begin, end);
+        REQUIRE(w.before.size() == signals.size());
+        for (std::size_t s = 0; s < signals.size(); s++) {
+            REQUIRE(same(w.before[s], (begin == 0) ? std::string() : expected_at(signals[s], begin - 1)));
+            std::vector<vcd_tracer::reader::timed_value> expected;
+            for (const auto &change : histories[signals[s]]) {
+                if ((change.time >= begin) && (change.time <= end)) {
+                    expected.push_back(change);
+                }
+            }
+            REQUIRE(w.changes[s].size() == expected.size());
+            for (std::size_t i = 0; i < expected.size(); i++) {
+                REQUIRE(w.changes[s][i].time == expected[i].time);
+                REQUIRE(w.changes[s][i].value == expected[i].value);
+            }
+        }
+    }
+}
+
+
+TEST_CASE("VCD Reader Slice", "VcdReaderSlice") {
+    REQUIRE(vcd_tracer::reader::path_matches("root.bus", "root.bus"));
+    REQUIRE(vcd_tracer::reader::path_matches("root.*.addr", "root.bus.addr"));
+    REQUIRE(vcd_tracer::reader::path_matches("root.*", "root.a.b.c"));
+    REQUIRE(vcd_tracer::reader::path_matches("root.v?", "root.v1"));
+    REQUIRE_FALSE(vcd_tracer::reader::path_matches("root.v?", "root.v10"));
+    REQUIRE_FALSE(vcd_tracer::reader::path_matches("root.bus", "root.bus.addr"));
+
+    std::string data;
+    std::string index_data;
+    make_indexed_trace(data, index_data);
+    const vcd_tracer::reader::trace t(data);
+    const vcd_tracer::reader::trace_index index(index_data);
+    const vcd_tracer::reader::query original(t, &index);
+
+    struct slice_case {
+        std::vector<std::string> filters;
+        std::uint64_t begin;
+        std::uint64_t end;
+        const vcd_tracer::reader::trace_index *index;
+        std::size_t kept;
+    };
+    const std::vector<slice_case> cases{
+        { {}, 1005, 2000, &index, 9 },
+        { {}, 1005, 2000, nullptr, 9 },
+        { { "root.v?", "root.flag" }, 0, 555, &index, 7 },
+        { { "root.v2" }, 2990, 100000, &index, 1 },
+    };
+    for (const auto &c : cases) {
+        vcd_tracer::reader::slice_options options;
+        options.filters = c.filters;
+        options.begin = c.begin;
+        options.end = c.end;
+        std::ostringstream out;
+        REQUIRE(vcd_tracer::reader::slice(t, c.index, options, out) == c.kept);
+
+        const std::string sliced_data = out.str();
+        const vcd_tracer::reader::trace sliced(sliced_data);
+        const auto &hdr = sliced.get_header();
+        REQUIRE(hdr.vars.size() == c.kept);
+        std::vector<std::string> paths;
+        for (std::size_t v = 0; v < hdr.vars.size(); v++) {
+            paths.push_back(hdr.path(v));
+        }
+        const vcd_tracer::reader::query q(sliced);
+        const auto sliced_signals = q.signals(paths);
+        const auto original_signals = original.signals(paths);
+        sliced.for_each_change([&c](const vcd_tracer::reader::value_change &change) {
+            REQUIRE(change.time >= c.begin);
+            REQUIRE(change.time <= c.end);
+        });
+        for (std::uint64_t time = c.begin; time <= std::min<std::uint64_t>(c.end, 3100); time += 5) {
+            const auto a = q.values_at(sliced_signals, time);
+            const auto b = original.values_at(original_signals, time);
+            for (std::size_t s = 0; s < a.size(); s++) {
+                REQUIRE(a[s] == b[s]);
+            }
+        }
+    }
+
+    // Variables can be declared outside any scope.
+    const std::string noscope_data =
+        "$timescale 1ns $end\n"
+        "$var wire 1 ! a $end\n"
+        "$scope module top $end\n"
+        "$var wire 1 \" b $end\n"
+        "$upscope $end\n"
+        "$enddefinitions $end\n"
+        "#0\n0!\n0\"\n#10\n1!\n1\"\n#20\n0!\n";
+    const vcd_tracer::reader::trace noscope(noscope_data);
+    for (const auto &filters : { std::vector<std::string>{ "a" }, std::vector<std::string>{} }) {
+        vcd_tracer::reader::slice_options options;
+        options.filters = filters;
+        options.begin = 5;
+        std::ostringstream out;
+        REQUIRE(vcd_tracer::reader::slice(noscope, nullptr, options, out) == (filters.empty() ? 2U : 1U));
+        const std::string sliced_data = out.str();
+        const vcd_tracer::reader::trace sliced(sliced_data);
+        const auto a = sliced.get_header().find_var("a");
+        REQUIRE(a != vcd_tracer::reader::npos);
+        REQUIRE(sliced.get_header().vars[a].scope == vcd_tracer::reader::npos);
+        std::vector<std::string> values;
+        sliced.for_each_change([&](const vcd_tracer::reader::value_change &change) {
+            if (change.signal == sliced.get_header().vars[a].signal) {
+                values.emplace_back(change.value);
+            }
+        });
+        REQUIRE(values == std::vector<std::string>{ "0", "1", "0" });
+    }
+}
+
+
+TEST_CASE("VCD Reader Merge", "VcdReaderMerge") {
+    const std::string cpu_data = make_trace();
+    const std::string analog_data =
+        "$timescale 10 ps $end\n"
+        "$scope module top $end\n"
+        "$var wire 8 ! level $end\n"
+        "$var real 64 \" wave $end\n"
+        "$upscope $end\n"
+        "$enddefinitions $end\n"
+        "#0\nb0 !\nr0 \"\n"
+        "#50\nb11 !\n"
+        "#100\nr2.5 \"\n"
+        "#2000\nb1 !\n"
+        "#5000\n";
+    const vcd_tracer::reader::trace cpu(cpu_data);
+    const vcd_tracer::reader::trace analog(analog_data);
+
+    std::ostringstream out;
+    const auto written = vcd_tracer::reader::merge({ { &cpu, "cpu" }, { &analog, "analog" } }, out);
+    const std::string merged_data = out.str();
+    const vcd_tracer::reader::trace merged(merged_data);
+    const auto &hdr = merged.get_header();
+
+    REQUIRE(hdr.timescale == "10ps");
+    REQUIRE(hdr.signals.size() == 5);
+    REQUIRE(hdr.find_var("cpu.root.bus.addr") != vcd_tracer::reader::npos);
+    REQUIRE(hdr.find_var("analog.top.wave") != vcd_tracer::reader::npos);
+
+    // Every change is kept, with the time in the new timescale.
+    std::size_t total = 0;
+    const auto merged_histories = vcd_tracer::reader::load_histories(merged, 1);
+    for (const auto &[input, scope, scale] : { std::make_tuple(&cpu, "cpu", 100U), std::make_tuple(&analog, "analog", 1U) }) {
+        const auto &in_hdr = input->get_header();
+        const auto histories = vcd_tracer::reader::load_histories(*input, 1);
+        for (std::size_t v = 0; v < in_hdr.vars.size(); v++) {
+            const auto merged_var = hdr.find_var(std::string(scope) + "." + in_hdr.path(v));
+            REQUIRE(merged_var != vcd_tracer::reader::npos);
+            const auto &expected = histories[in_hdr.vars[v].signal];
+            const auto &actual = merged_histories[hdr.vars[merged_var].signal];
+            REQUIRE(actual.size() == expected.size());
+            for (std::size_t i = 0; i < expected.size(); i++) {
+                REQUIRE(actual[i].time == expected[i].time * scale);
+                REQUIRE(actual[i].value == expected[i].value);
+            }
+            total += expected.size();
+        }
+    }
+    REQUIRE(written >= total);
+
+    // Times only increase, and the final timestamp is kept.
+    std::uint64_t time = 0;
+    merged.for_each_change([&time](const vcd_tracer::reader::value_change &change) {
+        REQUIRE(change.time >= time);
+        time = change.time;
+    });
+    REQUIRE(merged_data.substr(merged_data.size() - 6) == "#5000\n");
+}
+
+
+TEST_CASE("VCD Reader Diff", "VcdReaderDiff") {
+    // The same design elaborated in a different order, so identifiers differ.
+    const auto write = [](bool reversed, std::uint64_t glitch_time) {
+        vcd_tracer::top dumper("root");
+        std::array<vcd_tracer::value<std::uint16_t>, 20> values;
+        for (std::size_t n = 0; n < values.size(); n++) {
+            const std::size_t i = reversed ? (values.size() - 1 - n) : n;
+            dumper.root.elaborate(values[i], "v" + std::to_string(i));
+        }
+        std::ostringstream out;
+        dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+        for (unsigned int t = 1; t < 200; t++) {
+            for (std::size_t i = 0; i < values.size(); i++) {
+                values[i].set(static_cast<std::uint16_t>(t / (i + 1)));
+            }
+            if (t == glitch_time) {
+                values[3].set(0xFFF);
+            }
+            dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+        }
+        return out.str();
+    };
+    const std::string golden_data = write(false, 0);
+    const std::string same_data = write(true, 0);
+    const std::string glitch_data = write(true, 120);
+    const vcd_tracer::reader::trace golden(golden_data);
+    const vcd_tracer::reader::trace same(same_data);
+    const vcd_tracer::reader::trace glitch(glitch_data);
+    const auto path_of = [](const vcd_tracer::reader::trace &t, std::string_view identifier) {
+        const auto &hdr = t.get_header();
+        return hdr.path(hdr.signals[hdr.find_signal(identifier)].vars.front());
+    };
+    REQUIRE(path_of(golden, "!") != path_of(same, "!"));
+
+    for (const unsigned int threads : { 1U, 3U }) {
+        const auto equal = vcd_tracer::reader::diff(golden, same, threads);
+        REQUIRE(equal.same());
+        REQUIRE(equal.compared == 20);
+
+        const auto differ = vcd_tracer::reader::diff(golden, glitch, threads);
+        REQUIRE_FALSE(differ.same());
+        REQUIRE(differ.divergences.size() == 1);
+        REQUIRE(differ.divergences[0].path == "root.v3");
+        // Values set before time_update_abs(t) are traced at the previous timestamp.
+        REQUIRE(differ.divergences[0].time == 119);
+        REQUIRE(vcd_tracer::reader::same_value(differ.divergences[0].b, "b111111111111"));
+    }
+
+    // Order within a timestamp, repeated values, formatting and unmatched variables.
+    const std::string a_data =
+        "$timescale 1ns $end\n"
+        "$scope module top $end\n"
+        "$var wire 4 ! a $end\n"
+        "$var wire 1 \" b $end\n"
+        "$var wire 1 # only_a $end\n"
+        "$upscope $end\n"
+        "$enddefinitions $end\n"
+        "#0\nbx !\n0\"\n"
+        "#5\nb1 !\n1\"\n"
+        "#7\nb1 !\n"
+        "#9\n0\"\n";
+    const std::string b_data =
+        "$timescale 1 ns $end\n"
+        "$scope module top $end\n"
+        "$var wire 1 B b $end\n"
+        "$var wire 4 A a $end\n"
+        "$var wire 1 C only_b $end\n"
+        "$upscope $end\n"
+        "$enddefinitions $end\n"
+        "#0\n0B\nbxxxx A\n"
+        "#5\n0B\n1B\nb1111 A\nb0001 A\n"
+        "#10\n0B\n";
+    const vcd_tracer::reader::trace a(a_data);
+    const vcd_tracer::reader::trace b(b_data);
+    for (const unsigned int threads : { 1U, 2U }) {
+        const auto result = vcd_tracer::reader::diff(a, b, threads);
+        REQUIRE(result.compared == 2);
+        REQUIRE(result.only_a == std::vector<std::string>{ "top.only_a" });
+        REQUIRE(result.only_b == std::vector<std::string>{ "top.only_b" });
+        REQUIRE(result.divergences.size() == 1);
+        REQUIRE(result.divergences[0].path == "top.b");
+        REQUIRE(result.divergences[0].time == 9);
+        REQUIRE(result.divergences[0].a == "0");
+        REQUIRE(result.divergences[0].b == "1");
+    }
+}
+
+TEST_CASE("VCD Reader Window Hashes", "VcdReaderHash") {
+    struct run {
+        std::string data;
+        std::string index_data;
+        std::string hash_data;
+    };
+    // Two scopes, elaborated in either order so identifiers differ.
+    const auto write = [](bool reversed, std::uint64_t glitch_time) {
+        vcd_tracer::top dumper("root");
+        vcd_tracer::module cpu(dumper.root, "cpu");
+        vcd_tracer::module bus(dumper.root, "bus");
+        std::array<vcd_tracer::value<std::uint16_t>, 4> regs;
+        std::array<vcd_tracer::value<std::uint16_t>, 4> lines;
+        for (std::size_t n = 0; n < regs.size(); n++) {
+            const std::size_t i = reversed ? (regs.size() - 1 - n) : n;
+            if (reversed) {
+                bus.elaborate(lines[i], "l" + std::to_string(i));
+                cpu.elaborate(regs[i], "r" + std::to_string(i));
+            }
+            else {
+                cpu.elaborate(regs[i], "r" + std::to_string(i));
+                bus.elaborate(lines[i], "l" + std::to_string(i));
+            }
+        }
+        std::ostringstream out;
+        std::ostringstream idx;
+        std::ostringstream hash;
+        vcd_tracer::index_options index_options;
+        index_options.entry_changes = 16;
+        vcd_tracer::index_writer index(idx, index_options);
+        vcd_tracer::hash_options hash_options;
+        hash_options.window = 100;
+        vcd_tracer::hash_writer hashes(hash, hash_options);
+        dumper.add_observer(index.observer());
+        dumper.add_observer(hashes.observer());
+        dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+        for (unsigned int t = 1; t < 1000; t++) {
+            for (std::size_t i = 0; i < regs.size(); i++) {
+                regs[i].set(static_cast<std::uint16_t>(t / (i + 1)));
+                lines[i].set(static_cast<std::uint16_t>(t / (i + 3)));
+            }
+            if (t == glitch_time) {
+                lines[2].set(0xFFF);
+            }
+            dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+        }
+        dumper.finalize_trace(out);
+        return run{ out.str(), idx.str(), hash.str() };
+    };
+    const auto golden_run = write(false, 0);
+    const auto same_run = write(true, 0);
+    const auto glitch_run = write(true, 420);
+
+    const vcd_tracer::reader::trace_hashes golden_hashes(golden_run.hash_data);
+    const vcd_tracer::reader::trace_hashes same_hashes(same_run.hash_data);
+    const vcd_tracer::reader::trace_hashes glitch_hashes(glitch_run.hash_data);
+    REQUIRE(golden_hashes.window() == 100);
+    REQUIRE(golden_hashes.groups() == std::vector<std::string>{ "root.bus", "root.cpu" });
+    REQUIRE(golden_hashes.record_count() == 10);
+    REQUIRE(vcd_tracer::reader::compare_hashes(golden_hashes, same_hashes).empty());
+
+    // Only the bus scope differs, in the window of the glitch.
+    const auto differences = vcd_tracer::reader::compare_hashes(golden_hashes, glitch_hashes);
+    REQUIRE(differences.size() == 1);
+    REQUIRE(differences[0].group == "root.bus");
+    REQUIRE(differences[0].begin == 400);
+    REQUIRE(differences[0].end == 500);
+
+    const vcd_tracer::reader::trace golden(golden_run.data);
+    const vcd_tracer::reader::trace glitch(glitch_run.data);
+    const vcd_tracer::reader::trace_index golden_index(golden_run.index_data);
+    const vcd_tracer::reader::trace_index glitch_index(glitch_run.index_data);
+    const auto drilled = vcd_tracer::reader::diff_windows(golden, &golden_index, glitch, &glitch_index, differences);
+    const auto full = vcd_tracer::reader::diff(golden, glitch, 1);
+    REQUIRE(drilled.divergences.size() == 1);
+    REQUIRE(drilled.divergences[0].path == "root.bus.l2");
+    REQUIRE(drilled.divergences[0].time == full.divergences[0].time);
+    REQUIRE(drilled.divergences[0].b == full.divergences[0].b);
+    REQUIRE(drilled.compared == 8);
+    REQUIRE(vcd_tracer::reader::diff_windows(golden, nullptr, glitch, nullptr, differences).divergences.size() == 1);
+
+    REQUIRE_THROWS_AS(vcd_tracer::reader::trace_hashes(std::string_view("VCDHASH1")), vcd_tracer::reader::parse_error);
+}
+
+TEST_CASE("VCD Reader Summary", "VcdReaderSummary") {
+    vcd_tracer::top dumper("root");
+    vcd_tracer::value<std::uint8_t> count;
+    vcd_tracer::value<bool> flag;
+    vcd_tracer::value<double> level{ 0.0 };
+    dumper.root.elaborate(count, "count");
+    dumper.root.elaborate(flag, "flag");
+    dumper.root.elaborate(level, "level");
+
+    std::ostringstream out;
+    std::ostringstream sum;
+    vcd_tracer::summary_options options;
+    options.bucket = 10;
+    options.factor = 4;
+    options.levels = 3;
+    vcd_tracer::summary_writer writer(sum, options);
+    dumper.add_observer(writer.observer());
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    for (unsigned int t = 1; t < 500; t++) {
+        count.set(static_cast<std::uint8_t>(t / 3));
+        if ((t % 50) == 0) {
+            flag.unknown();
+        }
+        else {
+            flag.set((t % 4) == 0);
+        }
+        level.set(static_cast<double>(t % 37) - 10.0);
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+    }
+    dumper.finalize_trace(out);
+    const std::string data = out.str();
+    const std::string sum_data = sum.str();
+
+    const vcd_tracer::reader::trace t(data);
+    const vcd_tracer::reader::trace_summary summary(sum_data);
+    const auto &hdr = t.get_header();
+    REQUIRE(summary.level_count() == 3);
+    REQUIRE(summary.bucket_length(0) == 10);
+    REQUIRE(summary.bucket_length(2) == 160);
+    REQUIRE(summary.level_for(1000, 200) == 0);
+    REQUIRE(summary.level_for(1000, 20) == 2);
+
+    // The changes of every signal per bucket, from the trace.
+    std::map<std::pair<std::uint64_t, std::size_t>, std::uint64_t> expected;
+    auto cursor = t.changes();
+    vcd_tracer::reader::value_change change;
+    std::uint64_t total = 0;
+    while (cursor.next(change)) {
+        expected[{ change.time / 10, change.signal }]++;
+        total++;
+    }
+    const auto fine = summary.buckets(0, 0, 1000, hdr);
+    REQUIRE(fine.size() == expected.size());
+    for (const auto &b : fine) {
+        REQUIRE(b.end == b.begin + 10);
+        REQUIRE(b.changes == expected.at({ b.begin / 10, b.signal }));
+    }
+
+    // Every level holds every change.
+    for (std::size_t n = 0; n < summary.level_count(); n++) {
+        std::uint64_t level_total = 0;
+        for (const auto &a : summary.activity(n, 0, 1000)) {
+            level_total += a.second;
+        }
+        REQUIRE(level_total == total);
+    }
+
+    // Values and ranges of the coarsest bucket [160, 320).
+    const auto count_signal = hdr.vars[hdr.find_var("root.count")].signal;
+    const auto level_signal = hdr.vars[hdr.find_var("root.level")].signal;
+    const auto flag_signal = hdr.vars[hdr.find_var("root.flag")].signal;
+    const auto coarse = summary.buckets(2, 200, 201, hdr);
+    REQUIRE(coarse.size() == 3);
+    for (const auto &b : coarse) {
+        REQUIRE(b.begin == 160);
+        if (b.signal == count_signal) {
+            // Values set before time_update_abs(t) are traced at the previous timestamp.
+            REQUIRE(vcd_tracer::reader::same_value(b.first, "b110110"));
+            REQUIRE(vcd_tracer::reader::same_value(b.last, "b1101010"));
+            REQUIRE(vcd_tracer::reader::same_value(b.min, b.first));
+            REQUIRE(vcd_tracer::reader::same_value(b.max, b.last));
+        }
+        else if (b.signal == level_signal) {
+            REQUIRE(b.min == "r-10");
+            REQUIRE(b.max == "r26");
+        }
+        else {
+            REQUIRE(b.signal == flag_signal);
+            REQUIRE(b.min == "0");
+            REQUIRE(b.max == "1");
+        }
+    }
+    REQUIRE(summary.buckets(1, 100, 100, hdr).empty());
+    REQUIRE_THROWS_AS(vcd_tracer::reader::trace_summary(std::string_view("VCDSUMM1")), vcd_tracer::reader::parse_error);
+}
+
+TEST_CASE("VCD Reader Value Search", "VcdReaderSearch") {
+    vcd_tracer::top dumper("root");
+    vcd_tracer::value<std::uint16_t> addr;
+    vcd_tracer::value<std::uint8_t> other;
+    vcd_tracer::value<double> level{ 0.0 };
+    vcd_tracer::value<std::uint8_t> status;
+    vcd_tracer::value<double> ratio{ 0.0 };
+    dumper.root.elaborate(addr, "addr");
+    dumper.root.elaborate(other, "other");
+    dumper.root.elaborate(level, "level");
+    dumper.root.elaborate(status, "status");
+    dumper.root.elaborate(ratio, "ratio");
+
+    std::ostringstream out;
+    std::ostringstream vidx;
+    vcd_tracer::value_index_options options;
+    options.chunk_changes = 30;
+    vcd_tracer::value_index_writer writer(vidx, options);
+    dumper.add_observer(writer.observer());
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    for (unsigned int t = 1; t < 1000; t++) {
+        // Addresses walk upwards, with 0x1F40 visited twice.
+        if ((t == 400) || (t == 700)) {
+            addr.set(0x1F40);
+        }
+        else if ((t % 97) == 0) {
+            addr.unknown();
+        }
+        else {
+            addr.set(static_cast<std::uint16_t>(t * 3));
+        }
+        other.set(static_cast<std::uint8_t>(t & 0x3F));
+        level.set(static_cast<double>(t / 10) * 0.5);
+        // The top bit is set in every other value, 0xF0 only once.
+        status.set(static_cast<std::uint8_t>((t == 500) ? 0xF0 : (((t % 2) != 0) ? 0x80 : 0) | (t & 0x1F)));
+        // 0.1 + 0.2 is traced as 0.3, which is a different double.
+        ratio.set((t == 600) ? (0.1 + 0.2) : static_cast<double>(t));
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+    }
+    dumper.finalize_trace(out);
+    const std::string data = out.str();
+    const std::string vidx_data = vidx.str();
+
+    const vcd_tracer::reader::trace t(data);
+    const vcd_tracer::reader::trace_value_index index(vidx_data);
+    const auto &hdr = t.get_header();
+    REQUIRE(index.chunk_count() == writer.chunk_count());
+    REQUIRE(index.chunk_count() > 20);
+    const auto addr_signal = hdr.vars[hdr.find_var("root.addr")].signal;
+    const auto level_signal = hdr.vars[hdr.find_var("root.level")].signal;
+
+    // Values set before time_update_abs(t) are traced at the previous timestamp.
+    const std::vector<std::uint64_t> expected{ 399, 699 };
+    const auto candidates = index.candidates(hdr.signals[addr_signal], "b1111101000000");
+    REQUIRE(candidates.size() < (index.chunk_count() / 2));
+    for (const unsigned int threads : { 1U, 3U }) {
+        REQUIRE(vcd_tracer::reader::find_value(t, index, addr_signal, "b1111101000000", threads) == expected);
+        REQUIRE(vcd_tracer::reader::find_value(t, nullptr, addr_signal, "b1111101000000", threads) == expected);
+        REQUIRE(vcd_tracer::reader::find_value(t, index, addr_signal, "bx", threads)
+                == vcd_tracer::reader::find_value(t, nullptr, addr_signal, "x", threads));
+        REQUIRE(vcd_tracer::reader::find_value(t, index, level_signal, "r12.5", threads)
+                == vcd_tracer::reader::find_value(t, nullptr, level_signal, "r12.5", threads));
+    }
+    // The initial value and every 97th step.
+    REQUIRE(vcd_tracer::reader::find_value(t, index, addr_signal, "bx").size() == 11);
+    REQUIRE(vcd_tracer::reader::find_value(t, index, level_signal, "r12.5") == std::vector<std::uint64_t>{ 249 });
+    // Values with the top bit set give the same hits with and without the index.
+    const auto status_signal = hdr.vars[hdr.find_var("root.status")].signal;
+    REQUIRE(vcd_tracer::reader::find_value(t, index, status_signal, "b11110000") == std::vector<std::uint64_t>{ 499 });
+    REQUIRE(vcd_tracer::reader::find_value(t, nullptr, status_signal, "b11110000") == std::vector<std::uint64_t>{ 499 });
+    const auto ratio_signal = hdr.vars[hdr.find_var("root.ratio")].signal;
+    REQUIRE(vcd_tracer::reader::find_value(t, index, ratio_signal, "r0.3") == std::vector<std::uint64_t>{ 599 });
+    for (const char *value : { "b10000101", "b10000", "b0100", "b10011111" }) {
+        const auto indexed = vcd_tracer::reader::find_value(t, index, status_signal, value);
+        REQUIRE(indexed == vcd_tracer::reader::find_value(t, nullptr, status_signal, value));
+        REQUIRE(!indexed.empty());
+    }
+    REQUIRE(index.candidates(hdr.signals[addr_signal], "b1111111111111111").empty());
+    REQUIRE_THROWS_AS(vcd_tracer::reader::trace_value_index(std::string_view("VCDVIDX1")), vcd_tracer::reader::parse_error);
+}
+
+TEST_CASE("VCD Reader Columns", "VcdReaderColumns") {
+    const std::string text =
+        "$timescale 10ps $end\n"
+        "$scope module top $end\n"
+        "$var wire 8 ! bus $end\n"
+        "$var wire 1 \" clk $end\n"
+        "$var real 64 # level $end\n"
+        "$scope module sub $end\n"
+        "$var wire 8 ! bus_alias $end\n"
+        "$upscope $end\n"
+        "$upscope $end\n"
+        "$enddefinitions $end\n"
+        "#0\nbx !\n0\"\nr0 #\n"
+        "#5\nb101 !\n1\"\n"
+        "#10\nbz !\n0\"\nr-2.5 #\n"
+        "#15\nb11111111 !\n1\"\n";
+    const vcd_tracer::reader::trace t(text);
+    std::ostringstream out;
+    REQUIRE(vcd_tracer::reader::export_columns(t, out, 2) == 4);
+    // Columns are used in place, so they need an aligned buffer.
+    const std::string bytes = out.str();
+    REQUIRE((bytes.size() % vcd_tracer::reader::columns_format::alignment) == 0);
+    std::vector<std::uint64_t> aligned(bytes.size() / sizeof(std::uint64_t));
+    std::memcpy(aligned.data(), bytes.data(), bytes.size());
+    const vcd_tracer::reader::trace_columns columns(std::string_view(reinterpret_cast<const char *>(aligned.data()), bytes.size()));
+
+    REQUIRE(columns.timescale() == "10ps");
+    REQUIRE(columns.columns().size() == 4);
+    const auto *bus = columns.find("top.bus");
+    REQUIRE(bus != nullptr);
+    REQUIRE(bus->bit_size == 8);
+    REQUIRE(bus->count == 4);
+    REQUIRE(std::vector<std::uint64_t>(bus->times, bus->times + bus->count) == std::vector<std::uint64_t>{ 0, 5, 10, 15 });
+    REQUIRE(std::vector<std::uint8_t>(bus->states, bus->states + bus->count)
+            == std::vector<std::uint8_t>{ vcd_tracer::reader::columns_format::state_x,
+                                          vcd_tracer::reader::columns_format::state_known,
+                                          vcd_tracer::reader::columns_format::state_z,
+                                          vcd_tracer::reader::columns_format::state_known });
+    REQUIRE(bus->bits[1] == 5);
+    REQUIRE(bus->bits[3] == 0xFF);
+    // Variables of one signal share the arrays.
+    REQUIRE(columns.find("top.sub.bus_alias")->times == bus->times);
+
+    const auto *level = columns.find("top.level");
+    REQUIRE(level->real);
+    REQUIRE(level->count == 2);
+    REQUIRE(level->reals[1] == -2.5);
+    REQUIRE(level->states == nullptr);
+    const auto *clk = columns.find("top.clk");
+    REQUIRE(clk->count == 4);
+    REQUIRE(clk->bits[0] + clk->bits[1] + clk->bits[2] + clk->bits[3] == 2);
+    REQUIRE(columns.find("top.missing") == nullptr);
+    REQUIRE_THROWS_AS(vcd_tracer::reader::trace_columns(std::string_view("VCDCOLS1")), vcd_tracer::reader::parse_error);
+}
+
+TEST_CASE("VCD Reader Shared Memory Ring", "VcdReaderRing") {
+    const std::string name = "/vcd_tracer_test_" + std::to_string(::getpid());
+    vcd_tracer::top dumper("root");
+    vcd_tracer::value<std::uint16_t> count;
+    vcd_tracer::value<bool> flag;
+    vcd_tracer::value<double> level{ 0.0 };
+    dumper.root.elaborate(count, "count");
+    dumper.root.elaborate(flag, "flag");
+    dumper.root.elaborate(level, "level");
+    vcd_tracer::shm_ring_options options;
+    options.capacity = 64;
+    vcd_tracer::shm_ring_writer writer(name, options);
+    dumper.add_observer(writer.observer());
+    std::ostringstream out;
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+
+    vcd_tracer::reader::ring_reader ring(name);
+    REQUIRE(ring.paths() == std::vector<std::string>{ "root.count", "root.flag", "root.level" });
+    unsigned int t = 1;
+    const auto step = [&](void) {
+        count.set(static_cast<std::uint16_t>(t));
+        flag.set((t % 2) == 0);
+        level.set(static_cast<double>(t) * 0.5);
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+        t++;
+    };
+    const auto check_values = [&](void) {
+        const auto &v = ring.values();
+        REQUIRE(v[0].state == vcd_tracer::index_format::state_known);
+        REQUIRE(v[0].bits == (t - 1));
+        REQUIRE(v[1].bits == (((t - 1) % 2) == 0 ? 1U : 0U));
+        REQUIRE(v[2].is_real);
+        REQUIRE(v[2].real() == static_cast<double>(t - 1) * 0.5);
+    };
+
+    // A reader that keeps up sees every change in order.
+    std::vector<vcd_tracer::reader::ring_change> changes;
+    for (int i = 0; i < 10; i++) {
+        step();
+    }
+    REQUIRE(ring.read(changes) == writer.record_count());
+    REQUIRE(ring.resync_count() == 0);
+    for (std::size_t i = 1; i < changes.size(); i++) {
+        REQUIRE(changes[i - 1].time <= changes[i].time);
+    }
+    // Values set before time_update_abs(t) are traced at the previous timestamp.
+    REQUIRE(changes.back().time == (t - 2));
+    check_values();
+
+    // A reader that falls behind resyncs from a checkpoint, the writer does not wait.
+    for (int i = 0; i < 200; i++) {
+        step();
+    }
+    changes.clear();
+    ring.read(changes);
+    REQUIRE(ring.resync_count() == 1);
+    REQUIRE(changes.size() < options.capacity);
+    check_values();
+    REQUIRE_FALSE(ring.finished());
+
+    // A reader following a live writer.
+    std::atomic<bool> done{ false };
+    std::thread producer([&](void) {
+        for (int i = 0; i < 5000; i++) {
+            step();
+        }
+        dumper.finalize_trace(out);
+        done = true;
+    });
+    // However the threads are scheduled, the reader ends with the final values.
+    while (!ring.finished()) {
+        changes.clear();
+        ring.read(changes, 16);
+    }
+    producer.join();
+    REQUIRE(done);
+    check_values();
+
+    // A late reader starts from the final checkpoint.
+    vcd_tracer::reader::ring_reader late(name);
+    REQUIRE(late.finished());
+    REQUIRE(late.values()[0].bits == ring.values()[0].bits);
+    REQUIRE_THROWS_AS(vcd_tracer::reader::ring_reader("/vcd_tracer_test_missing"), std::system_error);
+}
@@ -0,0 +1,277 @@
+/*
+ *  C++ VCD Tracer Library Output Sink Tests
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+#include "../src/vcd_tracer.hpp"
+#include "../src/vcd_deferred.hpp"
+#include "../src/vcd_index.hpp"
+#include "../src/vcd_mmap_sink.hpp"
+#include "../src/vcd_pipe_sink.hpp"
+#include "../src/vcd_uring_sink.hpp"
+#include "../src/vcd_reader.hpp"
+#include "trace_helpers.hpp"
+
+using test_traces::write_trace;
+
+TEST_CASE("VCD Pipe Sink", "VcdPipeSink") {
+    std::ostringstream expected;
+    write_trace(expected);
+
+    // The test acts as the other end, reading until the sink end is closed.
+    const auto stream = [&](const std::array<int, 2> &fds, vcd_tracer::pipe_sink_options options, bool slow) {
+        std::string received;
+        std::thread consumer([&](void) {
+            if (slow) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            std::array<char, 1024> buf{};
+            for (;;) {
+                const auto n = ::read(fds[0], buf.data(), buf.size());
+                if (n <= 0) {
+                    break;
+                }
+                received.append(buf.data(), static_cast<std::size_t>(n));
+            }
+        });
+        std::uint64_t spliced = 0;
+        std::uint64_t stalls = 0;
+        {
+            vcd_tracer::pipe_sink sink(fds[1], options);
+            std::ostream out(&sink);
+            write_trace(out);
+            out.flush();
+            REQUIRE(out.good());
+            REQUIRE(static_cast<std::size_t>(out.tellp()) == expected.str().size());
+            REQUIRE(sink.bytes_sent() == expected.str().size());
+            spliced = sink.spliced_bytes();
+            stalls = sink.stall_count();
+        }
+        ::close(fds[1]);
+        consumer.join();
+        ::close(fds[0]);
+        REQUIRE(received == expected.str());
+        return std::make_pair(spliced, stalls);
+    };
+
+    vcd_tracer::pipe_sink_options options;
+    options.buffer_size = 4096;
+    options.buffers = 2;
+    std::array<int, 2> fds{};
+
+    SECTION("pipe") {
+        REQUIRE(::pipe(fds.data()) == 0);
+        REQUIRE(stream(fds, options, false).first > 0);
+    }
+    SECTION("socket") {
+        REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) == 0);
+        REQUIRE(stream(fds, options, false).first > 0);
+    }
+    SECTION("backpressure") {
+        // A one page non blocking pipe with a late reader fills straight away.
+        REQUIRE(::pipe(fds.data()) == 0);
+        ::fcntl(fds[1], F_SETPIPE_SZ, 4096);
+        REQUIRE(::fcntl(fds[1], F_SETFL, O_NONBLOCK) == 0);
+        options.timeout_ms = 10000;
+        REQUIRE(stream(fds, options, true).second > 0);
+    }
+    SECTION("copy") {
+        REQUIRE(::pipe(fds.data()) == 0);
+        options.zero_copy = false;
+        REQUIRE(stream(fds, options, false).first == 0);
+    }
+}
+
+TEST_CASE("VCD Uring Sink", "VcdUringSink") {
+    std::ostringstream expected;
+    write_trace(expected);
+    const std::string path = "sink_tests_uring.vcd";
+    vcd_tracer::uring_sink_options options;
+    options.buffer_size = 4096;
+    options.buffers = 3;
+
+    const std::string comment = "$comment flush $end\n";
+    const auto check = [&](void) {
+        bool uring = false;
+        {
+            vcd_tracer::uring_sink sink(path, options);
+            std::ostream out(&sink);
+            write_trace(out);
+            // A flush part way through a block is kept back with O_DIRECT.
+            out << comment;
+            out.flush();
+            REQUIRE(out.good());
+            REQUIRE(static_cast<std::size_t>(out.tellp()) == expected.str().size() + comment.size());
+            uring = sink.uring();
+            sink.close();
+        }
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream data;
+        data << in.rdbuf();
+        std::remove(path.c_str());
+        REQUIRE(data.str() == expected.str() + comment);
+        return uring;
+    };
+    // The kernel may not allow io_uring, then every section is the pwrite() fallback.
+    SECTION("uring") {
+        check();
+    }
+    SECTION("direct") {
+        options.direct = true;
+        check();
+    }
+    SECTION("fallback") {
+        options.uring = false;
+        REQUIRE_FALSE(check());
+    }
+    REQUIRE_THROWS_AS(vcd_tracer::uring_sink("sink_tests_missing/trace.vcd"), std::system_error);
+}
+
+TEST_CASE("VCD Mmap Sink", "VcdMmapSink") {
+    std::ostringstream expected;
+    write_trace(expected);
+    const std::string path = "sink_tests_mmap.vcd";
+    vcd_tracer::mmap_sink_options options;
+    options.window_size = 16384;
+
+    const auto check = [&](void) {
+        {
+            vcd_tracer::mmap_sink sink(path, options);
+            std::ostream out(&sink);
+            // The top closes the sink when the trace is finalized.
+            write_trace(out, sink.observer());
+            REQUIRE(out.good());
+            REQUIRE(static_cast<std::size_t>(out.tellp()) == expected.str().size());
+            REQUIRE(sink.window_count() == ((expected.str().size() / options.window_size) + 1));
+        }
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream data;
+        data << in.rdbuf();
+        std::remove(path.c_str());
+        REQUIRE(data.str() == expected.str());
+    };
+    SECTION("none") {
+        options.writeback = vcd_tracer::mmap_writeback::none;
+        check();
+    }
+    SECTION("async") {
+        options.drop_behind = true;
+        check();
+    }
+    SECTION("sync") {
+        options.writeback = vcd_tracer::mmap_writeback::sync;
+        check();
+    }
+    SECTION("close") {
+        // Closed without the observer, by the destructor.
+        {
+            vcd_tracer::mmap_sink sink(path, options);
+            std::ostream out(&sink);
+            out << "$comment short $end\n";
+            REQUIRE(out.tellp() == 20);
+        }
+        std::ifstream in(path, std::ios::binary);
+        std::ostringstream data;
+        data << in.rdbuf();
+        std::remove(path.c_str());
+        REQUIRE(data.str() == "$comment short $end\n");
+    }
+    REQUIRE_THROWS_AS(vcd_tracer::mmap_sink("sink_tests_missing/trace.vcd"), std::system_error);
+}
+
+TEST_CASE("VCD Deferred Header", "VcdDeferredHeader") {
+    const std::string path = "sink_tests_deferred.vcd";
+    vcd_tracer::deferred_options options;
+    SECTION("default") {
+    }
+    SECTION("copy") {
+        options.reflink = false;
+        options.copy_file_range = false;
+    }
+    vcd_tracer::stitch_method method = vcd_tracer::stitch_method::none;
+    {
+        vcd_tracer::top dumper("root");
+        vcd_tracer::value<std::uint8_t> count;
+        dumper.root.elaborate(count, "count");
+        vcd_tracer::deferred_file file(dumper, path, options);
+        dumper.add_observer(file.observer());
+        dumper.start_deferred(file.body(), std::chrono::system_clock::from_time_t(0));
+        for (unsigned int t = 1; t <= 10; t++) {
+            count.set(static_cast<std::uint8_t>(t));
+            dumper.time_update_abs(file.body(), std::chrono::nanoseconds{ t * 10 });
+        }
+        // A core added once tracing has started.
+        vcd_tracer::module core(dumper.root, "core");
+        vcd_tracer::value<bool> busy;
+        core.elaborate(busy, "busy");
+        for (unsigned int t = 11; t <= 20; t++) {
+            count.set(static_cast<std::uint8_t>(t));
+            busy.set((t % 2) == 0);
+            dumper.time_update_abs(file.body(), std::chrono::nanoseconds{ t * 10 });
+        }
+        dumper.finalize_trace(file.body());
+        method = file.method();
+    }
+    REQUIRE(method != vcd_tracer::stitch_method::none);
+    if (!options.reflink) {
+        REQUIRE(method == vcd_tracer::stitch_method::copy);
+    }
+    REQUIRE_FALSE(std::ifstream(path + ".body").is_open());
+    {
+        // Offsets into the body would not match the file.
+        vcd_tracer::top dumper("root");
+        vcd_tracer::value<std::uint8_t> count;
+        dumper.root.elaborate(count, "count");
+        std::ostringstream body;
+        std::ostringstream idx;
+        vcd_tracer::index_writer writer(idx);
+        dumper.add_observer(writer.observer());
+        REQUIRE_THROWS_AS(dumper.start_deferred(body, std::chrono::system_clock::from_time_t(0)), std::logic_error);
+    }
+    {
+        const vcd_tracer::reader::trace t(vcd_tracer::reader::mapped_file{ path });
+        const auto &hdr = t.get_header();
+        const auto busy = hdr.vars[hdr.find_var("root.core.busy")].signal;
+        REQUIRE(hdr.find_var("root.count") != vcd_tracer::reader::npos);
+        std::vector<std::uint64_t> busy_times;
+        std::size_t count_changes = 0;
+        t.for_each_change([&](const vcd_tracer::reader::value_change &change) {
+            if (change.signal == busy) {
+                busy_times.push_back(change.time);
+            }
+            else {
+                count_changes++;
+            }
+        });
+        // Values set before time_update_abs(t) are traced at the previous timestamp.
+        REQUIRE(busy_times.size() == 10);
+        REQUIRE(busy_times.front() == 100);
+        REQUIRE(count_changes == 21);
+    }
+    std::remove(path.c_str());
+}
@@ -11,11 +11,29 @@
  * See LICENSE for license details.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <catch2/catch.hpp>
 #include "../src/vcd_tracer.hpp"
+#include "../src/vcd_fanout.hpp"
+#include "../src/vcd_tsc.hpp"
+#include "../src/vcd_reader.hpp"
+#include "trace_helpers.hpp"
+
+using test_traces::change_text;
+using test_traces::read_changes;
+using test_traces::write_trace;
 
 // See https://en.wikipedia.org/wiki/Value_change_dump
 
@@ -229,8 +247,8 @@ TEST_CASE("VCD Integer Value", "VcdValue") {
         {
             std::ostringstream dump_out;
             (void)my_dumper(dump_out, true);
-            // 2 LSB are compressed
-            REQUIRE(dump_out.str() == "b101111010101101 vv\n");
+            // Leading 1s are kept, VCD would extend a shorter vector with 0.
+            REQUIRE(dump_out.str() == "b11101111010101101 vv\n");
         }
 
         test_var.set(0x0);
@@ -321,7 +339,11 @@ TEST_CASE("VCD Module", "VcdModule") {
     };
 
     auto register_fn = [&](const std::string_view full_path,
+                           const std::string_view var_type,
+                           unsigned int bit_size,
                            vcd_tracer::scope_fn::dumper_fn fn) {
+        (void)var_type;
+        (void)bit_size;
         my_full_path = full_path;
         my_dumper = fn;
         return vcd_tracer::value_context{ std::string(full_path), update_fn };
@@ -376,7 +398,11 @@ TEST_CASE("VCD Module Elaborate", "VcdModuleElaborate") {
     };
 
     auto register_fn = [&](const std::string_view full_path,
+                           const std::string_view var_type,
+                           unsigned int bit_size,
                            vcd_tracer::scope_fn::dumper_fn fn) {
+        (void)var_type;
+        (void)bit_size;
         my_full_path = full_path;
         my_dumper = fn;
         return vcd_tracer::value_context{ std::string(full_path), update_fn };
@@ -547,3 +573,320 @@ TEST_CASE("VCD Top Trace Buf", "VcdTopTraceBuf") {
         REQUIRE(data.str() == edata.str());
     }
 }
+
+TEST_CASE("VCD Alias", "VcdAlias") {
+    vcd_tracer::top dumper("root");
+    vcd_tracer::value<std::uint16_t> addr;
+    vcd_tracer::value<double> level{ 0.0 };
+    vcd_tracer::module cpu(dumper.root, "cpu");
+    vcd_tracer::module lsu(cpu, "lsu");
+    vcd_tracer::module bus(dumper.root, "bus");
+    vcd_tracer::module master(bus, "master0");
+    lsu.elaborate(addr, "addr");
+    lsu.elaborate(level, "level");
+    master.alias(addr, "addr");
+    master.alias(addr, "address");
+    bus.alias(level, "level");
+    vcd_tracer::value<bool> unelaborated;
+    REQUIRE_THROWS_AS(bus.alias(unelaborated, "flag"), std::invalid_argument);
+
+    std::ostringstream out;
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    // An alias after the header would not be declared.
+    REQUIRE_THROWS_AS(bus.alias(addr, "late"), std::logic_error);
+    REQUIRE_THROWS_AS(dumper.root.alias(addr, "late"), std::logic_error);
+    vcd_tracer::module later(bus, "later");
+    REQUIRE_THROWS_AS(later.alias(addr, "late"), std::logic_error);
+    for (unsigned int t = 1; t <= 4; t++) {
+        addr.set(static_cast<std::uint16_t>(t * 0x111));
+        level.set(static_cast<double>(t));
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+    }
+    const std::string data = out.str();
+    const vcd_tracer::reader::trace t(data);
+    const auto &hdr = t.get_header();
+    // The aliases are declared with the same identifier, so there are still only two signals.
+    REQUIRE(hdr.vars.size() == 5);
+    REQUIRE(hdr.signals.size() == 2);
+    const auto signal = hdr.vars[hdr.find_var("root.cpu.lsu.addr")].signal;
+    REQUIRE(hdr.vars[hdr.find_var("root.bus.master0.addr")].signal == signal);
+    REQUIRE(hdr.vars[hdr.find_var("root.bus.master0.address")].signal == signal);
+    REQUIRE(hdr.signals[signal].vars.size() == 3);
+    REQUIRE(hdr.signals[signal].bit_size == 16);
+    const auto real = hdr.vars[hdr.find_var("root.bus.level")].signal;
+    REQUIRE(hdr.signals[real].real);
+    REQUIRE(hdr.vars[hdr.find_var("root.cpu.lsu.level")].signal == real);
+    // Each change is written once.
+    std::size_t changes = 0;
+    t.for_each_change([&](const vcd_tracer::reader::value_change &) { changes++; });
+    REQUIRE(changes == 10);
+}
+
+TEST_CASE("VCD Retirement", "VcdRetirement") {
+    vcd_tracer::top dumper("root");
+    vcd_tracer::value<std::uint8_t> count;
+    vcd_tracer::module txn(dumper.root, "txn");
+    dumper.root.elaborate(count, "count");
+    auto tracker = std::make_unique<vcd_tracer::value<std::uint8_t>>();
+    auto flag = std::make_unique<vcd_tracer::value<bool>>();
+    txn.elaborate(*tracker, "tracker");
+    txn.elaborate(*flag, "flag");
+    std::vector<std::uint32_t> observed;
+    vcd_tracer::trace_observer observer;
+    observer.on_change = [&](const vcd_tracer::raw_change &change) {
+        if (change.state == vcd_tracer::value_state::unknown_x) {
+            observed.push_back(change.index);
+        }
+    };
+    dumper.add_observer(observer);
+
+    std::ostringstream out;
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    unsigned int t = 1;
+    const auto step = [&](void) {
+        count.set(static_cast<std::uint8_t>(t));
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t * 10 });
+        t++;
+    };
+    step();
+    // A flag that is destroyed goes to x once, and is then left out of the trace.
+    flag->set(true);
+    step();
+    flag.reset();
+    observed.clear();
+    step();
+    REQUIRE(observed == std::vector<std::uint32_t>{ 2 });
+    // A tracker at the same path carries on with the identifier of the retired one.
+    for (unsigned int i = 0; i < 3; i++) {
+        tracker->set(static_cast<std::uint8_t>(0x10 + i));
+        step();
+        tracker = std::make_unique<vcd_tracer::value<std::uint8_t>>();
+        txn.elaborate(*tracker, "tracker");
+        step();
+    }
+    tracker->set(0x20);
+    step();
+    tracker.reset();
+    step();
+    step();
+
+    const std::string data = out.str();
+    const vcd_tracer::reader::trace trace(data);
+    const auto &hdr = trace.get_header();
+    REQUIRE(hdr.vars.size() == 3);
+    const auto tracker_signal = hdr.vars[hdr.find_var("root.txn.tracker")].signal;
+    const auto flag_signal = hdr.vars[hdr.find_var("root.txn.flag")].signal;
+    std::vector<std::string> tracker_values;
+    std::vector<std::string> flag_values;
+    trace.for_each_change([&](const vcd_tracer::reader::value_change &change) {
+        if (change.signal == tracker_signal) {
+            tracker_values.emplace_back(change.value);
+        }
+        if (change.signal == flag_signal) {
+            flag_values.emplace_back(change.value);
+        }
+    });
+    REQUIRE(flag_values == std::vector<std::string>{ "x", "1", "x" });
+    // The initial x of a new tracker is written over the final x of the retired one.
+    REQUIRE(tracker_values == std::vector<std::string>{ "bx", "b010000", "bx", "b010001", "bx", "b010010", "bx", "b0100000", "bx" });
+
+    // A retired identifier is only reused by a variable of the same type and size.
+    vcd_tracer::top other("root");
+    auto narrow = std::make_unique<vcd_tracer::value<std::uint8_t>>();
+    other.root.elaborate(*narrow, "data");
+    narrow.reset();
+    vcd_tracer::value<std::uint16_t> wide;
+    other.root.elaborate(wide, "data");
+    std::ostringstream other_out;
+    other.finalize_header(other_out, std::chrono::system_clock::from_time_t(0));
+    const std::string other_data = other_out.str();
+    const vcd_tracer::reader::trace other_trace(other_data);
+    const auto &other_hdr = other_trace.get_header();
+    REQUIRE(other_hdr.signals.size() == 2);
+    REQUIRE(other_hdr.signals[0].bit_size == 8);
+    REQUIRE(other_hdr.signals[1].bit_size == 16);
+
+    // After the header a variable that is not a retired one would be undeclared.
+    vcd_tracer::value<std::uint8_t> late;
+    REQUIRE_THROWS_AS(dumper.root.elaborate(late, "late"), std::logic_error);
+    vcd_tracer::value<std::uint16_t> wide_tracker;
+    REQUIRE_THROWS_AS(txn.elaborate(wide_tracker, "tracker"), std::logic_error);
+    vcd_tracer::module later(txn, "later");
+    REQUIRE_THROWS_AS(later.elaborate(late, "late"), std::logic_error);
+    vcd_tracer::value<std::uint8_t> tracker_again;
+    REQUIRE_NOTHROW(txn.elaborate(tracker_again, "tracker"));
+}
+
+TEST_CASE("VCD Fanout", "VcdFanout") {
+    std::ostringstream expected;
+    write_trace(expected);
+
+    std::ostringstream full;
+    std::ostringstream counts;
+    std::ostringstream slow;
+    vcd_tracer::fanout fan;
+    fan.add_output(full);
+    fan.add_output(counts, { [](std::string_view path) { return path == "root.count"; }, {} });
+    fan.add_output(slow, { {}, std::chrono::nanoseconds(1000) });
+    std::ostream out(&fan);
+    write_trace(out, fan.observer());
+    // Every output is written from the bytes formatted once.
+    REQUIRE(full.str() == expected.str());
+    REQUIRE(fan.bytes_in() == expected.str().size());
+    REQUIRE(fan.bytes_out(0) == expected.str().size());
+
+    const std::string reference_data = expected.str();
+    const vcd_tracer::reader::trace reference(reference_data);
+    const auto all = read_changes(reference);
+    const std::string count_data = counts.str();
+    const vcd_tracer::reader::trace count_trace(count_data);
+    REQUIRE(count_trace.get_header().vars.size() == 1);
+    REQUIRE(count_trace.get_header().find_var("root.count") != vcd_tracer::reader::npos);
+    std::vector<change_text> count_changes;
+    std::copy_if(all.begin(), all.end(), std::back_inserter(count_changes), [](const change_text &c) { return c.identifier == "!"; });
+    REQUIRE(read_changes(count_trace) == count_changes);
+
+    // The slow output has the state of the full trace at each of it's time points.
+    const std::string slow_data = slow.str();
+    const vcd_tracer::reader::trace slow_trace(slow_data);
+    std::map<std::string, std::string> state;
+    std::map<std::uint64_t, std::map<std::string, std::string>> state_at;
+    for (const auto &c : all) {
+        state[c.identifier] = c.value;
+        state_at[c.time] = state;
+    }
+    std::map<std::string, std::string> slow_state;
+    std::set<std::uint64_t> times;
+    const auto slow_changes = read_changes(slow_trace);
+    for (std::size_t i = 0; i < slow_changes.size(); i++) {
+        const auto &c = slow_changes[i];
+        slow_state[c.identifier] = c.value;
+        times.insert(c.time);
+        if ((i + 1 == slow_changes.size()) || (slow_changes[i + 1].time != c.time)) {
+            REQUIRE(slow_state == std::prev(state_at.upper_bound(c.time))->second);
+        }
+    }
+    REQUIRE(times.size() > 4);
+    REQUIRE(times.size() < 10);
+    for (auto it = std::next(times.begin()); it != times.end(); it++) {
+        REQUIRE(*it - *std::prev(it) >= 1000);
+    }
+}
+
+TEST_CASE("VCD Change Subscription", "VcdSubscription") {
+    vcd_tracer::top dumper("root");
+    vcd_tracer::value<std::uint16_t> count;
+    vcd_tracer::value<bool> flag;
+    vcd_tracer::value<double> level{ 0.0 };
+    dumper.root.elaborate(count, "count");
+    dumper.root.elaborate(flag, "flag");
+    dumper.root.elaborate(level, "level");
+    std::vector<vcd_tracer::change_record> all;
+    std::vector<vcd_tracer::change_record> flags;
+    std::size_t batches = 0;
+    dumper.subscribe({}, [&](const vcd_tracer::change_batch &batch) {
+        batches++;
+        all.insert(all.end(), batch.begin(), batch.end());
+    });
+    dumper.subscribe([](std::string_view path) { return path == "root.flag"; },
+                     [&](const vcd_tracer::change_batch &batch) {
+                         flags.insert(flags.end(), batch.begin(), batch.end());
+                     });
+
+    std::ostringstream out;
+    dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+    for (unsigned int t = 1; t <= 100; t++) {
+        count.set(static_cast<std::uint16_t>(t * 7));
+        if ((t % 3) == 0) {
+            flag.set((t % 2) == 0);
+        }
+        if ((t % 10) == 0) {
+            level.set(static_cast<double>(t) / 4.0);
+        }
+        dumper.time_update_abs(out, std::chrono::nanoseconds{ t * 10 });
+    }
+    dumper.finalize_trace(out);
+
+    // One batch for the initial values, then one per update.
+    REQUIRE(batches == 101);
+    const std::string data = out.str();
+    const vcd_tracer::reader::trace trace(data);
+    const auto &hdr = trace.get_header();
+    std::vector<vcd_tracer::change_record> parsed;
+    trace.for_each_change([&](const vcd_tracer::reader::value_change &change) {
+        const auto &signal = hdr.signals[change.signal];
+        vcd_tracer::change_record record{ change.time, static_cast<std::uint32_t>(change.signal), vcd_tracer::value_state::known, signal.real, 0, 0.0 };
+        if (signal.real) {
+            record.real = std::stod(std::string(change.value.substr(1)));
+        }
+        else if (!vcd_tracer::reader::decode_bits(change.value, record.bits)) {
+            record.state = vcd_tracer::value_state::unknown_x;
+        }
+        parsed.push_back(record);
+    });
+    REQUIRE(all.size() == parsed.size());
+    for (std::size_t i = 0; i < all.size(); i++) {
+        REQUIRE(all[i].time == parsed[i].time);
+        REQUIRE(all[i].index == parsed[i].index);
+        REQUIRE(all[i].state == parsed[i].state);
+        if (all[i].state == vcd_tracer::value_state::known) {
+            REQUIRE(all[i].bits == parsed[i].bits);
+            REQUIRE(all[i].real == parsed[i].real);
+        }
+    }
+    REQUIRE(flags.size() == 34);
+    for (const auto &record : flags) {
+        REQUIRE(record.index == 1);
+    }
+}
+
+TEST_CASE("VCD TSC Clock", "VcdTscClock") {
+    SECTION("steady") {
+        vcd_tracer::tsc_clock clock({ false, std::chrono::milliseconds(1), std::chrono::milliseconds(10) });
+        REQUIRE(!clock.hardware());
+        REQUIRE(clock.calibrated());
+        // steady_clock ticks convert one to one.
+        const auto start = clock.ticks();
+        REQUIRE((clock.to_time(start + 12345) - clock.to_time(start)).count() == 12345);
+    }
+    SECTION("counter") {
+        vcd_tracer::tsc_clock clock({ true, std::chrono::milliseconds(1), std::chrono::milliseconds(5) });
+        const auto start = clock.ticks();
+        const auto wall = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        const auto end = clock.ticks();
+        const auto measured = std::chrono::steady_clock::now() - wall;
+        REQUIRE(end > start);
+        const auto traced = clock.to_time(end) - clock.to_time(start);
+        REQUIRE(clock.calibrated());
+        REQUIRE(clock.ticks_per_second() > 0.0);
+        // Within a tenth of the time measured with steady_clock, allowing for the calibration so far.
+        const auto error = std::chrono::duration_cast<std::chrono::nanoseconds>(traced - measured).count();
+        REQUIRE(std::abs(error) < std::chrono::duration_cast<std::chrono::nanoseconds>(measured).count() / 10);
+    }
+    SECTION("trace") {
+        vcd_tracer::tsc_clock clock;
+        vcd_tracer::top dumper("root");
+        vcd_tracer::value<std::uint32_t> event;
+        dumper.root.elaborate(event, "event");
+        std::ostringstream out;
+        dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+        std::vector<vcd_tracer::tsc_clock::rep> ticks;
+        for (unsigned int i = 1; i <= 200; i++) {
+            ticks.push_back(clock.ticks());
+            event.set(i);
+            dumper.time_update_abs(out, clock.to_time(ticks.back()));
+        }
+        dumper.finalize_trace(out);
+        const std::string data = out.str();
+        const vcd_tracer::reader::trace trace(data);
+        std::uint64_t last = 0;
+        std::size_t changes = 0;
+        trace.for_each_change([&](const vcd_tracer::reader::value_change &change) {
+            REQUIRE(change.time >= last);
+            last = change.time;
+            changes++;
+        });
+        REQUIRE(changes == 201);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ *  C++ VCD Tracer Library Test Helpers
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/vcd_tracer.hpp"
+#include "../src/vcd_reader.hpp"
+
+#ifndef VCD_TEST_TRACE_HELPERS_HPP
+#define VCD_TEST_TRACE_HELPERS_HPP
+
+namespace test_traces {
+    /** Write a trace of a few hundred KiB, for the output sinks and the fan-out.
+     */
+    inline void write_trace(std::ostream &out, vcd_tracer::trace_observer observer = {}) {
+        vcd_tracer::top dumper("root");
+        vcd_tracer::value<std::uint32_t> count;
+        vcd_tracer::value<double> level{ 0.0 };
+        dumper.root.elaborate(count, "count");
+        dumper.root.elaborate(level, "level");
+        dumper.add_observer(std::move(observer));
+        dumper.finalize_header(out, std::chrono::system_clock::from_time_t(0));
+        for (unsigned int t = 1; t <= 5000; t++) {
+            count.set(t * 2654435761U);
+            level.set(static_cast<double>(t) / 3.0);
+            dumper.time_update_abs(out, std::chrono::nanoseconds{ t });
+        }
+        dumper.finalize_trace(out);
+    }
+
+    /** A value change, with the text of it's identifier and value.
+     */
+    struct change_text {
+        std::uint64_t time;
+        std::string identifier;
+        std::string value;
+        bool operator==(const change_text &other) const {
+            return (time == other.time) && (identifier == other.identifier) && (value == other.value);
+        }
+    };
+
+    //! Read every value change of a trace, in order.
+    inline std::vector<change_text> read_changes(const vcd_tracer::reader::trace &t) {
+        std::vector<change_text> changes;
+        t.for_each_change([&](const vcd_tracer::reader::value_change &change) {
+            changes.push_back({ change.time,
+                                t.get_header().signals[change.signal].identifier,
+                                std::string(change.value) });
+        });
+        return changes;
+    }
+
+}// namespace test_traces
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ *  C++ VCD Tracer Library Columnar Export Tool
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Convert a trace to per signal columns for analysis.
+ *
+ *    vcd_columns [--threads=N] IN.vcd OUT.col
+ *
+ * See vcd_columns.hpp for the layout of OUT.col.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/vcd_columns.hpp"
+#include "../src/vcd_reader.hpp"
+
+namespace {
+
+    void usage(const char *name) {
+        std::cerr << "usage: " << name << " [--threads=N] IN.vcd OUT.col\n";
+    }
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    unsigned int threads = 0;
+    std::vector<std::string> paths;
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg{ argv[i] };
+            if (arg.substr(0, 10) == "--threads=") {
+                threads = static_cast<unsigned int>(std::stoul(std::string(arg.substr(10))));
+            }
+            else if ((arg.size() > 1) && (arg[0] == '-')) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            else {
+                paths.emplace_back(arg);
+            }
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "invalid argument: " << e.what() << "\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (paths.size() != 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const vcd_tracer::reader::trace t(vcd_tracer::reader::mapped_file{ paths[0] });
+        std::ofstream out(paths[1], std::ios::binary);
+        if (!out) {
+            std::cerr << "can not open " << paths[1] << "\n";
+            return EXIT_FAILURE;
+        }
+        const auto columns = vcd_tracer::reader::export_columns(t, out, threads);
+        out.close();
+        std::cerr << columns << " columns written\n";
+    }
+    catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+/*
+ *  C++ VCD Tracer Library Diff Tool
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Compare a trace against a golden trace.
+ *
+ *    vcd_diff [--threads=N] [--max=N] [--no-hash] GOLDEN.vcd NEW.vcd
+ *
+ * Variables are matched by hierarchical path, and the first time each
+ * variable differs is reported, earliest first. At most --max differences
+ * are listed. The exit status is 0 if the traces are the same, 1 if they
+ * differ and 2 on an error.
+ *
+ * When both traces have window hashes, GOLDEN.vcd.hash and NEW.vcd.hash,
+ * only the windows and scopes whose hashes differ are compared, seeking
+ * with GOLDEN.vcd.idx and NEW.vcd.idx when they exist. --no-hash compares
+ * the whole traces.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/vcd_diff.hpp"
+#include "../src/vcd_hash_reader.hpp"
+#include "../src/vcd_index_reader.hpp"
+#include "../src/vcd_reader.hpp"
+
+namespace {
+
+    constexpr int EXIT_DIFFERENT = 1;
+    constexpr int EXIT_ERROR = 2;
+
+    void usage(const char *name) {
+        std::cerr << "usage: " << name << " [--threads=N] [--max=N] [--no-hash] GOLDEN.vcd NEW.vcd\n";
+    }
+
+    //! Show an empty value as it is before a first change.
+    std::string_view shown(const std::string &value) {
+        return value.empty() ? std::string_view("(none)") : std::string_view(value);
+    }
+
+    //! Load a sidecar file of a trace, if it exists.
+    template<typename SIDECAR>
+    std::unique_ptr<SIDECAR> sidecar(const std::string &path) {
+        if (!std::ifstream(path).good()) {
+            return nullptr;
+        }
+        return std::make_unique<SIDECAR>(vcd_tracer::reader::mapped_file{ path });
+    }
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    unsigned int threads = 0;
+    std::size_t max = std::numeric_limits<std::size_t>::max();
+    bool use_hash = true;
+    std::vector<std::string> paths;
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg{ argv[i] };
+            if (arg.substr(0, 10) == "--threads=") {
+                threads = static_cast<unsigned int>(std::stoul(std::string(arg.substr(10))));
+            }
+            else if (arg.substr(0, 6) == "--max=") {
+                max = std::stoull(std::string(arg.substr(6)));
+            }
+            else if (arg == "--no-hash") {
+                use_hash = false;
+            }
+            else if ((arg.size() > 1) && (arg[0] == '-')) {
+                usage(argv[0]);
+                return EXIT_ERROR;
+            }
+            else {
+                paths.emplace_back(arg);
+            }
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "invalid argument: " << e.what() << "\n";
+        usage(argv[0]);
+        return EXIT_ERROR;
+    }
+    if (paths.size() != 2) {
+        usage(argv[0]);
+        return EXIT_ERROR;
+    }
+
+    try {
+        const vcd_tracer::reader::trace a(vcd_tracer::reader::mapped_file{ paths[0] });
+        const vcd_tracer::reader::trace b(vcd_tracer::reader::mapped_file{ paths[1] });
+        const auto a_hash = use_hash ? sidecar<vcd_tracer::reader::trace_hashes>(paths[0] + ".hash") : nullptr;
+        const auto b_hash = use_hash ? sidecar<vcd_tracer::reader::trace_hashes>(paths[1] + ".hash") : nullptr;
+        vcd_tracer::reader::diff_result result;
+        if (a_hash && b_hash) {
+            const auto differences = vcd_tracer::reader::compare_hashes(*a_hash, *b_hash);
+            std::cout << differences.size() << " windows differ by hash\n";
+            const auto a_index = sidecar<vcd_tracer::reader::trace_index>(paths[0] + ".idx");
+            const auto b_index = sidecar<vcd_tracer::reader::trace_index>(paths[1] + ".idx");
+            result = vcd_tracer::reader::diff_windows(a, a_index.get(), b, b_index.get(), differences);
+        }
+        else {
+            result = vcd_tracer::reader::diff(a, b, threads);
+        }
+        for (const auto &path : result.only_a) {
+            std::cout << "only in " << paths[0] << ": " << path << "\n";
+        }
+        for (const auto &path : result.only_b) {
+            std::cout << "only in " << paths[1] << ": " << path << "\n";
+        }
+        for (std::size_t i = 0; (i < result.divergences.size()) && (i < max); i++) {
+            const auto &d = result.divergences[i];
+            std::cout << "#" << d.time << " " << d.path << " " << shown(d.a) << " != " << shown(d.b) << "\n";
+        }
+        std::cout << result.compared << " variables compared, "
+                  << result.divergences.size() << " differ, "
+                  << result.only_a.size() + result.only_b.size() << " unmatched\n";
+        return result.same() ? EXIT_SUCCESS : EXIT_DIFFERENT;
+    }
+    catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return EXIT_ERROR;
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ *  C++ VCD Tracer Library Value Search Tool
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Find the times a variable changes to a value.
+ *
+ *    vcd_find [--index=FILE] [--threads=N] IN.vcd PATH VALUE
+ *
+ * PATH is the hierarchical path of a variable, such as root.bus.addr.
+ * VALUE is a VCD value such as b1011, 1, x or r1.5, or a number such as
+ * 8000 or 0x1F40. The value index defaults to IN.vcd.vidx when it exists,
+ * without one the whole trace is read.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/vcd_reader.hpp"
+#include "../src/vcd_search.hpp"
+
+namespace {
+
+    void usage(const char *name) {
+        std::cerr << "usage: " << name << " [--index=FILE] [--threads=N] IN.vcd PATH VALUE\n";
+    }
+
+    /** Convert a number, such as "8000" or "0x1F40", to a VCD vector value.
+        Anything else is taken to be a VCD value.
+    */
+    std::string vcd_value(const std::string &text) {
+        const bool hex = (text.size() > 2) && (text[0] == '0') && ((text[1] == 'x') || (text[1] == 'X'));
+        const bool decimal = !text.empty() && (text.find_first_not_of("0123456789") == std::string::npos);
+        if (!hex && !decimal) {
+            return text;
+        }
+        auto v = std::stoull(text, nullptr, hex ? 16 : 10);
+        std::string bits;
+        do {
+            bits.insert(bits.begin(), (v & 1) ? '1' : '0');
+            v >>= 1;
+        } while (v != 0);
+        return "b" + bits;
+    }
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    std::string index_name;
+    unsigned int threads = 0;
+    std::vector<std::string> args;
+    try {
+        for (int i = 1; i < argc; i++) {
+            const std::string_view arg{ argv[i] };
+            if (arg.substr(0, 8) == "--index=") {
+                index_name = std::string(arg.substr(8));
+            }
+            else if (arg.substr(0, 10) == "--threads=") {
+                threads = static_cast<unsigned int>(std::stoul(std::string(arg.substr(10))));
+            }
+            else if ((arg.size() > 1) && (arg[0] == '-') && (arg[1] == '-')) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            else {
+                args.emplace_back(arg);
+            }
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "invalid argument: " << e.what() << "\n";
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (args.size() != 3) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const vcd_tracer::reader::trace t(vcd_tracer::reader::mapped_file{ args[0] });
+        const auto &hdr = t.get_header();
+        const auto var = hdr.find_var(args[1]);
+        if (var == vcd_tracer::reader::npos) {
+            std::cerr << "no variable " << args[1] << "\n";
+            return EXIT_FAILURE;
+        }
+        std::unique_ptr<vcd_tracer::reader::trace_value_index> index;
+        if (index_name.empty() && std::ifstream(args[0] + ".vidx").good()) {
+            index_name = args[0] + ".vidx";
+        }
+        if (!index_name.empty()) {
+            index = std::make_unique<vcd_tracer::reader::trace_value_index>(vcd_tracer::reader::mapped_file{ index_name });
+        }
+        const auto value = vcd_value(args[2]);
+        for (const auto time : vcd_tracer::reader::find_value(t, index.get(), hdr.vars[var].signal, value, threads)) {
+            std::cout << "#" << time << "\n";
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+/*
+ *  C++ VCD Tracer Library Merge Tool
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Combine the traces of several processes into one.
+ *
+ *    vcd_merge [--out=FILE] IN.vcd[=SCOPE]...
+ *
+ * The hierarchy of each input is nested in SCOPE, which defaults to the
+ * file name without the directory and extension. Without --out the merged
+ * trace is written to stdout.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "../src/vcd_merge.hpp"
+#include "../src/vcd_reader.hpp"
+
+namespace {
+
+    void usage(const char *name) {
+        std::cerr << "usage: " << name << " [--out=FILE] IN.vcd[=SCOPE]...\n";
+    }
+
+    //! The file name without the directory and extension.
+    std::string stem(const std::string &path) {
+        const auto slash = path.find_last_of('/');
+        std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+        const auto dot = name.find_last_of('.');
+        return ((dot == std::string::npos) || (dot == 0)) ? name : name.substr(0, dot);
+    }
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    std::string out_name;
+    std::vector<std::pair<std::string, std::string>> files;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg{ argv[i] };
+        if (arg.substr(0, 6) == "--out=") {
+            out_name = std::string(arg.substr(6));
+        }
+        else if ((arg.size() > 1) && (arg[0] == '-')) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else {
+            const auto eq = arg.find('=');
+            const std::string path(arg.substr(0, eq));
+            files.emplace_back(path, (eq == std::string_view::npos) ? stem(path) : std::string(arg.substr(eq + 1)));
+        }
+    }
+    if (files.empty()) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::vector<vcd_tracer::reader::trace> traces;
+        traces.reserve(files.size());
+        std::vector<vcd_tracer::reader::merge_input> inputs;
+        for (const auto &[path, scope] : files) {
+            traces.emplace_back(vcd_tracer::reader::mapped_file{ path });
+            inputs.push_back({ &traces.back(), scope });
+        }
+        std::ofstream file_out;
+        if (!out_name.empty()) {
+            file_out.open(out_name, std::ios::binary);
+            if (!file_out) {
+                std::cerr << "can not open " << out_name << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        std::ostream &out = out_name.empty() ? std::cout : file_out;
+        vcd_tracer::reader::merge(inputs, out);
+        out.flush();
+    }
+    catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+/*
+ *  C++ VCD Tracer Library Slice Tool
+ *
+ *  For more information see https://github.com/nakane1chome/cpp-vcd-tracer
+ *
+ * Copyright (c) 2022, Philip Mulholland
+ * All rights reserved.
+ *
+ * Using the  BSD 3-Clause License
+ *
+ * See LICENSE for license details.
+ *
+ * Cut a smaller VCD from a large one.
+ *
+ *    vcd_slice [--begin=T] [--end=T] [--signal=PATTERN]... [--index=FILE] IN.vcd OUT.vcd
+ *
+ * Times are in timescale units, or have a unit such as 10us. Each --signal
+ * keeps the variables, or scopes, with a matching hierarchical path, such as
+ * root.lsu or root.*.addr. The index defaults to IN.vcd.idx when it exists.
+ * OUT.vcd may be - to write to stdout.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/vcd_index_reader.hpp"
+#include "../src/vcd_reader.hpp"
+#include "../src/vcd_slice.hpp"
+
+namespace {
+
+    void usage(const char *name) {
+        std::cerr << "usage: " << name
+                  << " [--begin=T] [--end=T] [--signal=PATTERN]... [--index=FILE] IN.vcd OUT.vcd\n";
+    }
+
+    /** Powers of 10 of a unit, relative to seconds.
+     */
+    int unit_exponent(std::string_view unit) {
+        constexpr std::array<std::pair<std::string_view, int>, 6> units{ { { "s", 0 }, { "ms", -3 }, { "us", -6 }, { "ns", -9 }, { "ps", -12 }, { "fs", -15 } } };
+        for (const auto &[name, exponent] : units) {
+            if (unit == name) {
+                return exponent;
+            }
+        }
+        throw std::invalid_argument("unknown time unit '" + std::string(unit) + "'");
+    }
+
+    /** Convert a time, such as "1200" or "10us", to timescale units.
+        @param text      The time.
+        @param timescale The trace timescale, such as "1ns" or "10ps".
+    */
+    std::uint64_t parse_time(const std::string &text, const std::string &timescale) {
+        std::size_t used = 0;
+        const auto count = std::stoull(text, &used);
+        if (used == text.size()) {
+            return count;
+        }
+        std::size_t scale_used = 0;
+        const auto scale = std::stoull(timescale, &scale_used);
+        int exponent = unit_exponent(std::string_view(text).substr(used)) - unit_exponent(std::string_view(timescale).substr(scale_used));
+        // Exact integer arithmetic, in timescale units.
+        std::uint64_t numerator = count;
+        std::uint64_t denominator = scale;
+        for (; exponent > 0; exponent--) {
+            numerator *= 10;
+        }
+        for (; exponent < 0; exponent++) {
+            denominator *= 10;
+        }
+        return numerator / denominator;
+    }
+
+}// namespace
+
+int main(int argc, const char **argv) {
+    std::optional<std::string> begin;
+    std::optional<std::string> end;
+    std::string index_name;
+    std::vector<std::string> paths;
+    vcd_tracer::reader::slice_options options;
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg{ argv[i] };
+        const auto eq = arg.find('=');
+        const std::string_view key = arg.substr(0, eq);
+        const std::string val{ (eq == std::string_view::npos) ? std::string_view{} : arg.substr(eq + 1) };
+        if (key == "--begin") {
+            begin = val;
+        }
+        else if (key == "--end") {
+            end = val;
+        }
+        else if (key == "--signal") {
+            options.filters.push_back(val);
+        }
+        else if (key == "--index") {
+            index_name = val;
+        }
+        else if ((arg.size() > 1) && (arg[0] == '-') && (arg != "-")) {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        else {
+            paths.emplace_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const vcd_tracer::reader::trace t(vcd_tracer::reader::mapped_file{ paths[0] });
+        const auto &timescale = t.get_header().timescale;
+        if (begin) {
+            options.begin = parse_time(*begin, timescale);
+        }
+        if (end) {
+            options.end = parse_time(*end, timescale);
+        }
+
+        std::unique_ptr<vcd_tracer::reader::trace_index> index;
+        if (index_name.empty() && std::ifstream(paths[0] + ".idx").good()) {
+            index_name = paths[0] + ".idx";
+        }
+        if (!index_name.empty()) {
+            index = std::make_unique<vcd_tracer::reader::trace_index>(vcd_tracer::reader::mapped_file{ index_name });
+        }
+
+        std::ofstream file_out;
+        if (paths[1] != "-") {
+            file_out.open(paths[1], std::ios::binary);
+            if (!file_out) {
+                std::cerr << "can not open " << paths[1] << "\n";
+                return EXIT_FAILURE;
+            }
+        }
+        std::ostream &out = (paths[1] == "-") ? std::cout : file_out;
+        const auto kept = vcd_tracer::reader::slice(t, index.get(), options, out);
+        out.flush();
+        if (kept == 0) {
+            std::cerr << "warning: no variables matched\n";
+        }
+    }
+    catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}